@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <fstream>
 #include <string>
+#include <cstdio>
+#include <unistd.h>
 
 using namespace flowcoro;
 
@@ -268,6 +270,79 @@ void benchmark_memory_pool() {
     std::cout << std::endl;
 }
 
+// 测试对象池与new/delete的对比
+void benchmark_object_pool() {
+    std::cout << "[MEMORY] Testing CacheFriendlyMemoryPool vs new/delete...\n";
+
+    struct Payload {
+        long a, b, c;
+        explicit Payload(long v) : a(v), b(v), c(v) {}
+    };
+
+    const int num_operations = 1000000;
+
+    {
+        AccurateBenchmark bench("new/delete", num_operations);
+        bench.start();
+        long sum = 0;
+        for (int i = 0; i < num_operations; ++i) {
+            auto obj = std::make_unique<Payload>(i);
+            sum += obj->a;
+        }
+        bench.end();
+        if (sum == 42) std::cout << sum;
+    }
+
+    {
+        CacheFriendlyMemoryPool<Payload, 64, true> pool;
+        AccurateBenchmark bench("CacheFriendlyMemoryPool acquire/release", num_operations);
+        bench.start();
+        long sum = 0;
+        for (int i = 0; i < num_operations; ++i) {
+            auto obj = pool.acquire(i);
+            sum += obj->a;
+        }
+        bench.end();
+        if (sum == 42) std::cout << sum;
+    }
+}
+
+// 测试日志调用点开销：snprintf格式化 vs 二进制记录
+void benchmark_logging() {
+    std::cout << "[LOG] Testing call-site cost of binary logging...\n";
+
+    const int num_operations = 200000;
+    static constexpr LogSite site{LogLevel::LOG_INFO, __FILE__, __LINE__, "request %d from %s took %.3f ms"};
+
+    {
+        AccurateBenchmark bench("snprintf into stack buffer", num_operations);
+        char buffer[512];
+        size_t total = 0;
+        bench.start();
+        for (int i = 0; i < num_operations; ++i) {
+            total += std::snprintf(buffer, sizeof(buffer), site.format, i, "127.0.0.1", i * 0.001);
+        }
+        bench.end();
+        if (total == 42) std::cout << total;
+    }
+
+    {
+        std::string path = "/tmp/flowcoro_bench_" + std::to_string(::getpid()) + ".log";
+        Logger logger;
+        logger.set_thread_buffer_size(32 * 1024 * 1024);
+        logger.initialize(path, LogLevel::LOG_INFO, LogOutput::FILE);
+        AccurateBenchmark bench("Logger::log binary record", num_operations);
+        bench.start();
+        for (int i = 0; i < num_operations; ++i) {
+            logger.log(site, i, "127.0.0.1", i * 0.001);
+        }
+        bench.end();
+        logger.shutdown();
+        std::cout << "  Dropped: " << logger.get_stats().dropped_logs << "\n\n";
+        std::remove(path.c_str());
+    }
+}
+
 // 测试无锁队列的基本性能
 void benchmark_lockfree_queue_concurrent() {
     std::cout << "[QUEUE] Testing basic lockfree queue performance...\n";
@@ -359,6 +434,8 @@ int main() {
         
         // 5. 内存池性能对比
         benchmark_memory_pool();
+        benchmark_object_pool();
+        benchmark_logging();
         
         // 6. 无锁队列并发性能
         benchmark_lockfree_queue_concurrent();
@@ -45,6 +45,7 @@
 #include "flowcoro/memory.h"
 #include "flowcoro/network.h"
 #include "flowcoro/net.h"
+#include "flowcoro/io_uring.h"
 #include "flowcoro/http_client.h"
 #include "flowcoro/simple_db.h"
 #include "flowcoro/rpc.h"
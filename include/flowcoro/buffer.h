@@ -4,7 +4,21 @@
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdint>
 #include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <string_view>
+#include <unordered_map>
+#include <sys/uio.h>
+#include "lockfree.h"
+#include "memory_pool.h"
 
 namespace flowcoro {
 
@@ -28,378 +42,1050 @@ public:
     }
 };
 
-// 缓存友好的循环缓冲区
+// 缓存友好的循环缓冲区 - 与lockfree::RingBuffer为同一实现
 template<typename T, size_t Capacity>
-class alignas(CACHE_LINE_SIZE) CacheFriendlyRingBuffer {
+using CacheFriendlyRingBuffer = lockfree::RingBuffer<T, Capacity>;
+
+// 分层缓存友好的内存池
+// 第一层为线程本地缓存，第二层为带版本号(防ABA)的无锁空闲链表，最后按内存块扩展。
+// acquire返回的句柄只包含对象指针：删除器无状态，通过地址对齐找到内存块头部，再找回所属的池。
+// ObjectsPerChunk为每个内存块至少容纳的对象数；Dense为true时对象紧密排列，否则每个对象独占缓存行。
+template<typename T, size_t ObjectsPerChunk = 64, bool Dense = false>
+class CacheFriendlyMemoryPool {
+    static_assert(ObjectsPerChunk > 0, "ObjectsPerChunk must be positive");
+    static_assert(sizeof(void*) == 8, "tagged freelist requires 64-bit pointers");
+
 private:
-    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of 2");
-    static constexpr size_t MASK = Capacity - 1;
-    
-    // 分离读写指针到不同缓存行，避免false sharing
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> write_pos_{0};
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> read_pos_{0};
-    
-    // 数据存储区域，对齐到缓存行
-    alignas(CACHE_LINE_SIZE) T data_[Capacity];
-    
-public:
-    CacheFriendlyRingBuffer() {
-        // 初始化数据
-        for (size_t i = 0; i < Capacity; ++i) {
-            new (&data_[i]) T();
-        }
-    }
-    
-    ~CacheFriendlyRingBuffer() {
-        // 清理数据
-        for (size_t i = 0; i < Capacity; ++i) {
-            data_[i].~T();
-        }
-    }
-    
-    // 写入数据（生产者）
-    bool push(const T& item) {
-        const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
-        const size_t next_write_pos = (write_pos + 1) & MASK;
-        
-        if (next_write_pos == read_pos_.load(std::memory_order_acquire)) {
-            return false; // 缓冲区满
-        }
-        
-        data_[write_pos] = item;
-        write_pos_.store(next_write_pos, std::memory_order_release);
-        return true;
-    }
-    
-    // 移动语义版本
-    bool push(T&& item) {
-        const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
-        const size_t next_write_pos = (write_pos + 1) & MASK;
-        
-        if (next_write_pos == read_pos_.load(std::memory_order_acquire)) {
-            return false; // 缓冲区满
-        }
-        
-        data_[write_pos] = std::move(item);
-        write_pos_.store(next_write_pos, std::memory_order_release);
-        return true;
-    }
-    
-    // 读取数据（消费者）
-    bool pop(T& item) {
-        const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
-        
-        if (read_pos == write_pos_.load(std::memory_order_acquire)) {
-            return false; // 缓冲区空
-        }
-        
-        item = std::move(data_[read_pos]);
-        read_pos_.store((read_pos + 1) & MASK, std::memory_order_release);
-        return true;
-    }
-    
-    // 批量操作 - 更好的缓存局部性
-    size_t push_batch(const T* items, size_t count) {
-        const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
-        const size_t read_pos = read_pos_.load(std::memory_order_acquire);
-        
-        // 计算可用空间
-        const size_t available = (read_pos - write_pos - 1) & MASK;
-        const size_t to_push = std::min(count, available);
-        
-        if (to_push == 0) return 0;
-        
-        // 连续写入，减少缓存miss
-        for (size_t i = 0; i < to_push; ++i) {
-            data_[(write_pos + i) & MASK] = items[i];
-        }
-        
-        write_pos_.store((write_pos + to_push) & MASK, std::memory_order_release);
-        return to_push;
+    struct ChunkHeader {
+        CacheFriendlyMemoryPool* pool;
+        size_t free_count;  // 仅trim期间使用
+    };
+
+    // 空闲块中就地存放的链表节点
+    struct FreeNode {
+        std::atomic<FreeNode*> next{nullptr};
+    };
+
+    static constexpr size_t round_up(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
     }
-    
-    size_t pop_batch(T* items, size_t count) {
-        const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
-        const size_t write_pos = write_pos_.load(std::memory_order_acquire);
-        
-        // 计算可读数据量
-        const size_t available = (write_pos - read_pos) & MASK;
-        const size_t to_pop = std::min(count, available);
-        
-        if (to_pop == 0) return 0;
-        
-        // 连续读取，减少缓存miss
-        for (size_t i = 0; i < to_pop; ++i) {
-            items[i] = std::move(data_[(read_pos + i) & MASK]);
-        }
-        
-        read_pos_.store((read_pos + to_pop) & MASK, std::memory_order_release);
-        return to_pop;
+
+    static constexpr size_t BLOCK_ALIGN = Dense
+        ? std::max(alignof(T), alignof(FreeNode))
+        : std::max(alignof(T), CACHE_LINE_SIZE);
+    static constexpr size_t BLOCK_SIZE = round_up(std::max(sizeof(T), sizeof(FreeNode)), BLOCK_ALIGN);
+    static constexpr size_t HEADER_SIZE = round_up(sizeof(ChunkHeader), BLOCK_ALIGN);
+    static constexpr size_t CHUNK_BYTES = std::bit_ceil(HEADER_SIZE + ObjectsPerChunk * BLOCK_SIZE);
+    static constexpr size_t BLOCKS_PER_CHUNK = (CHUNK_BYTES - HEADER_SIZE) / BLOCK_SIZE;
+
+    // 线程缓存参数
+    static constexpr size_t CACHE_SLOTS = 4;
+    static constexpr size_t TRANSFER_BATCH = 32;
+    static constexpr size_t CACHE_LIMIT = TRANSFER_BATCH * 2;
+
+    // 空闲链表头：低48位为指针，高16位为版本号
+    static constexpr unsigned TAG_SHIFT = 48;
+    static constexpr uint64_t POINTER_MASK = (uint64_t{1} << TAG_SHIFT) - 1;
+
+    static uint64_t pack(FreeNode* node, uint64_t tag) {
+        return (tag << TAG_SHIFT) | reinterpret_cast<uintptr_t>(node);
     }
-    
-    // 查询状态
-    bool empty() const {
-        return read_pos_.load(std::memory_order_acquire) == 
-               write_pos_.load(std::memory_order_acquire);
+    static FreeNode* unpack(uint64_t word) {
+        return reinterpret_cast<FreeNode*>(word & POINTER_MASK);
     }
-    
-    bool full() const {
-        const size_t write_pos = write_pos_.load(std::memory_order_acquire);
-        const size_t read_pos = read_pos_.load(std::memory_order_acquire);
-        return ((write_pos + 1) & MASK) == read_pos;
+    static uint64_t next_tag(uint64_t word) {
+        return (word >> TAG_SHIFT) + 1;
     }
-    
-    size_t size() const {
-        const size_t write_pos = write_pos_.load(std::memory_order_acquire);
-        const size_t read_pos = read_pos_.load(std::memory_order_acquire);
-        return (write_pos - read_pos) & MASK;
+
+    static ChunkHeader* header_of(const void* block) {
+        return reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(block) & ~(CHUNK_BYTES - 1));
     }
-    
-    static constexpr size_t capacity() { return Capacity; }
-};
 
-// 分层缓存友好的内存池
-template<typename T>
-class CacheFriendlyMemoryPool {
-private:
-    struct alignas(CACHE_LINE_SIZE) Block {
-        T data;
-        std::atomic<Block*> next{nullptr};
-        
-        template<typename... Args>
-        Block(Args&&... args) : data(std::forward<Args>(args)...) {}
-    };
-    
-    // 分离到不同缓存行
-    alignas(CACHE_LINE_SIZE) std::atomic<Block*> free_head_{nullptr};
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> pool_size_{0};
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> allocated_count_{0};
-    
-    // 预分配的内存块
-    std::vector<std::unique_ptr<Block[]>> allocated_chunks_;
-    std::mutex chunks_mutex_;
-    
-    static constexpr size_t CHUNK_SIZE = 64; // 每次分配64个对象
-    
 public:
-    CacheFriendlyMemoryPool() {
-        expand_pool();
+    // 无状态删除器：析构对象并把块归还所属的池
+    struct Deleter {
+        void operator()(T* obj) const noexcept {
+            obj->~T();
+            header_of(obj)->pool->give_block(obj);
+        }
+    };
+
+    using Handle = std::unique_ptr<T, Deleter>;
+
+    CacheFriendlyMemoryPool() : id_(next_pool_id_.fetch_add(1, std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().pools[id_] = this;
     }
-    
-    ~CacheFriendlyMemoryPool() = default;
-    
+
+    ~CacheFriendlyMemoryPool() {
+        {
+            // 注销后其他线程不会再把缓存归还到本池，残留缓存按id作废
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().pools.erase(id_);
+        }
+        for (void* chunk : chunks_) {
+            std::free(chunk);
+        }
+    }
+
+    CacheFriendlyMemoryPool(const CacheFriendlyMemoryPool&) = delete;
+    CacheFriendlyMemoryPool& operator=(const CacheFriendlyMemoryPool&) = delete;
+
     // 获取对象
     template<typename... Args>
-    std::unique_ptr<T, std::function<void(T*)>> acquire(Args&&... args) {
-        Block* block = free_head_.load(std::memory_order_acquire);
-        
-        while (block) {
-            Block* next = block->next.load(std::memory_order_relaxed);
-            if (free_head_.compare_exchange_weak(block, next, std::memory_order_release)) {
-                // 成功获取到块
-                allocated_count_.fetch_add(1, std::memory_order_relaxed);
-                
-                // 构造对象
-                new (&block->data) T(std::forward<Args>(args)...);
-                
-                // 返回带自定义删除器的unique_ptr
-                return std::unique_ptr<T, std::function<void(T*)>>(
-                    &block->data,
-                    [this, block](T* ptr) {
-                        ptr->~T();
-                        release(block);
-                    }
-                );
-            }
+    Handle acquire(Args&&... args) {
+        void* block = take_block();
+        try {
+            return Handle(new (block) T(std::forward<Args>(args)...));
+        } catch (...) {
+            give_block(block);
+            throw;
         }
-        
-        // 池为空，扩展后重试
-        expand_pool();
-        return acquire(std::forward<Args>(args)...);
     }
-    
+
     // 获取池统计信息
+    // allocated_count包含各线程缓存中的块
     struct PoolStats {
         size_t pool_size;
         size_t allocated_count;
         size_t free_count;
         double utilization;
     };
-    
+
     PoolStats get_stats() const {
         size_t pool = pool_size_.load(std::memory_order_acquire);
         size_t allocated = allocated_count_.load(std::memory_order_acquire);
-        size_t free = pool - allocated;
+        size_t free = pool > allocated ? pool - allocated : 0;
         double util = pool > 0 ? (double)allocated / pool * 100.0 : 0.0;
-        
+
         return {pool, allocated, free, util};
     }
-    
+
+    // 每个对象占用的字节数（含对齐填充）
+    static constexpr size_t block_size() { return BLOCK_SIZE; }
+    static constexpr size_t objects_per_chunk() { return BLOCKS_PER_CHUNK; }
+
+    // 将当前线程缓存的块归还共享空闲链表
+    void flush_thread_cache() {
+        if (LocalCache* cache = local_cache()) {
+            flush(*cache, cache->count);
+        }
+    }
+
+    // 释放所有对象都空闲的内存块，返回释放的字节数
+    // 空闲链表被整体摘下后重新分拣，释放的块经epoch回收，确保并发弹出时不会读到已释放内存
+    // 调用线程的缓存会先归还，其他线程缓存中的块所在内存块不会被释放
+    size_t trim() {
+        flush_thread_cache();
+        std::lock_guard<std::mutex> lock(chunks_mutex_);
+
+        uint64_t old_head = free_head_.load(std::memory_order_acquire);
+        while (!free_head_.compare_exchange_weak(old_head, pack(nullptr, next_tag(old_head)),
+                                                 std::memory_order_acquire)) {
+        }
+        FreeNode* list = unpack(old_head);
+
+        for (FreeNode* node = list; node; node = node->next.load(std::memory_order_relaxed)) {
+            header_of(node)->free_count++;
+        }
+
+        // 保留未完全空闲的内存块中的空闲对象
+        FreeNode* keep_head = nullptr;
+        FreeNode* keep_tail = nullptr;
+        size_t keep_count = 0;
+        for (FreeNode* node = list; node;) {
+            FreeNode* next = node->next.load(std::memory_order_relaxed);
+            if (header_of(node)->free_count != BLOCKS_PER_CHUNK) {
+                node->next.store(keep_head, std::memory_order_relaxed);
+                if (!keep_tail) keep_tail = node;
+                keep_head = node;
+                ++keep_count;
+            }
+            node = next;
+        }
+        if (keep_head) {
+            push_chain(keep_head, keep_tail);
+        }
+
+        size_t released_chunks = 0;
+        std::vector<void*> remaining;
+        remaining.reserve(chunks_.size());
+        for (void* chunk : chunks_) {
+            auto* header = static_cast<ChunkHeader*>(chunk);
+            if (header->free_count == BLOCKS_PER_CHUNK) {
+                lockfree::EpochManager::instance().retire(chunk, &free_chunk);
+                ++released_chunks;
+            } else {
+                header->free_count = 0;
+                remaining.push_back(chunk);
+            }
+        }
+        chunks_ = std::move(remaining);
+        pool_size_.fetch_sub(released_chunks * BLOCKS_PER_CHUNK, std::memory_order_relaxed);
+        return released_chunks * CHUNK_BYTES;
+    }
+
 private:
-    void release(Block* block) {
+    struct LocalCache {
+        uint64_t pool_id;
+        FreeNode* head;
+        size_t count;
+    };
+
+    // 线程退出时把缓存归还仍然存活的池
+    struct ThreadCaches {
+        LocalCache slots[CACHE_SLOTS] = {};
+        size_t next_victim = 0;
+
+        ~ThreadCaches() {
+            for (auto& slot : slots) {
+                return_to_owner(slot);
+            }
+            tls_exited_ = true;
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, CacheFriendlyMemoryPool*> pools;
+    };
+
+    static Registry& registry() {
+        // 不析构：线程退出时仍可能访问
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    static void return_to_owner(LocalCache& slot) {
+        if (slot.pool_id != 0 && slot.count > 0) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            auto it = registry().pools.find(slot.pool_id);
+            if (it != registry().pools.end()) {
+                it->second->flush(slot, slot.count);
+            }
+        }
+        slot = LocalCache{0, nullptr, 0};
+    }
+
+    static void free_chunk(void* chunk) {
+        std::free(chunk);
+    }
+
+    LocalCache* local_cache() {
+        if (tls_exited_) return nullptr;
+        ThreadCaches& caches = tls_caches_;
+        LocalCache* empty = nullptr;
+        for (auto& slot : caches.slots) {
+            if (slot.pool_id == id_) return &slot;
+            if (slot.pool_id == 0 && !empty) empty = &slot;
+        }
+        if (!empty) {
+            // 槽位用尽时轮换淘汰
+            empty = &caches.slots[caches.next_victim++ % CACHE_SLOTS];
+            return_to_owner(*empty);
+        }
+        empty->pool_id = id_;
+        return empty;
+    }
+
+    void* take_block() {
+        if (LocalCache* cache = local_cache()) {
+            if (cache->count == 0) {
+                cache->count = obtain(cache->head, TRANSFER_BATCH);
+            }
+            FreeNode* node = cache->head;
+            cache->head = node->next.load(std::memory_order_relaxed);
+            cache->count--;
+            return node;
+        }
+        FreeNode* node = nullptr;
+        obtain(node, 1);
+        return node;
+    }
+
+    void give_block(void* block) {
+        auto* node = new (block) FreeNode();
+        if (LocalCache* cache = local_cache()) {
+            node->next.store(cache->head, std::memory_order_relaxed);
+            cache->head = node;
+            if (++cache->count > CACHE_LIMIT) {
+                flush(*cache, TRANSFER_BATCH);
+            }
+            return;
+        }
+        push_chain(node, node);
         allocated_count_.fetch_sub(1, std::memory_order_relaxed);
-        
-        Block* old_head = free_head_.load(std::memory_order_relaxed);
+    }
+
+    // 从共享空闲链表取出最多max个块，链表为空时扩展
+    size_t obtain(FreeNode*& out, size_t max) {
+        for (;;) {
+            size_t n = pop_batch(out, max);
+            if (n > 0) {
+                allocated_count_.fetch_add(n, std::memory_order_relaxed);
+                return n;
+            }
+            expand_pool();
+        }
+    }
+
+    size_t pop_batch(FreeNode*& out, size_t max) {
+        // trim()释放的内存块经epoch回收，读取next期间需保持在临界区内
+        lockfree::EpochGuard guard;
+        FreeNode* batch = nullptr;
+        size_t n = 0;
+        uint64_t old_head = free_head_.load(std::memory_order_acquire);
+        while (n < max) {
+            FreeNode* node = unpack(old_head);
+            if (!node) break;
+            FreeNode* next = node->next.load(std::memory_order_relaxed);
+            if (free_head_.compare_exchange_weak(old_head, pack(next, next_tag(old_head)),
+                                                 std::memory_order_acquire)) {
+                node->next.store(batch, std::memory_order_relaxed);
+                batch = node;
+                ++n;
+                old_head = free_head_.load(std::memory_order_acquire);
+            }
+        }
+        out = batch;
+        return n;
+    }
+
+    void push_chain(FreeNode* first, FreeNode* last) {
+        uint64_t old_head = free_head_.load(std::memory_order_relaxed);
         do {
-            block->next.store(old_head, std::memory_order_relaxed);
-        } while (!free_head_.compare_exchange_weak(old_head, block, std::memory_order_release));
+            last->next.store(unpack(old_head), std::memory_order_relaxed);
+        } while (!free_head_.compare_exchange_weak(old_head, pack(first, next_tag(old_head)),
+                                                   std::memory_order_release));
     }
-    
+
+    // 把缓存头部的count个块归还共享空闲链表
+    void flush(LocalCache& cache, size_t count) {
+        if (count == 0) return;
+        FreeNode* first = cache.head;
+        FreeNode* last = first;
+        for (size_t i = 1; i < count; ++i) {
+            last = last->next.load(std::memory_order_relaxed);
+        }
+        cache.head = last->next.load(std::memory_order_relaxed);
+        cache.count -= count;
+        push_chain(first, last);
+        allocated_count_.fetch_sub(count, std::memory_order_relaxed);
+    }
+
     void expand_pool() {
         std::lock_guard<std::mutex> lock(chunks_mutex_);
-        
-        // 分配新的内存块
-        auto chunk = std::make_unique<Block[]>(CHUNK_SIZE);
-        
+        if (unpack(free_head_.load(std::memory_order_acquire))) {
+            return;  // 其他线程已经扩展
+        }
+
+        void* memory = std::aligned_alloc(CHUNK_BYTES, CHUNK_BYTES);
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        new (memory) ChunkHeader{this, 0};
+
         // 链接所有块
-        for (size_t i = 0; i < CHUNK_SIZE - 1; ++i) {
-            chunk[i].next.store(&chunk[i + 1], std::memory_order_relaxed);
+        char* base = static_cast<char*>(memory) + HEADER_SIZE;
+        FreeNode* first = new (base) FreeNode();
+        FreeNode* last = first;
+        for (size_t i = 1; i < BLOCKS_PER_CHUNK; ++i) {
+            auto* node = new (base + i * BLOCK_SIZE) FreeNode();
+            last->next.store(node, std::memory_order_relaxed);
+            last = node;
         }
-        chunk[CHUNK_SIZE - 1].next.store(nullptr, std::memory_order_relaxed);
-        
-        // 添加到空闲链表
-        Block* old_head = free_head_.load(std::memory_order_relaxed);
-        do {
-            chunk[CHUNK_SIZE - 1].next.store(old_head, std::memory_order_relaxed);
-        } while (!free_head_.compare_exchange_weak(old_head, &chunk[0], std::memory_order_release));
-        
-        pool_size_.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
-        allocated_chunks_.push_back(std::move(chunk));
+
+        chunks_.push_back(memory);
+        pool_size_.fetch_add(BLOCKS_PER_CHUNK, std::memory_order_relaxed);
+        push_chain(first, last);
     }
+
+    // 分离到不同缓存行
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> free_head_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> pool_size_{0};
+    std::atomic<size_t> allocated_count_{0};
+
+    uint64_t id_;
+    std::vector<void*> chunks_;  // 受chunks_mutex_保护
+    std::mutex chunks_mutex_;
+
+    static inline std::atomic<uint64_t> next_pool_id_{1};
+    static inline thread_local ThreadCaches tls_caches_;
+    static inline thread_local bool tls_exited_ = false;
 };
 
-// 缓存友好的字符串缓冲区
-class StringBuffer {
+// 链式I/O缓冲区
+// 由若干段组成，每段引用一个带引用计数的内存块（16/32/64KiB，来自全局MemoryPool）。
+// split/slice/clone只增加引用计数不复制数据；只有独占的块才允许在头部/尾部空闲区写入，
+// 因此共享出去的视图不会被后续的append/prepend改写。
+// fill_iovec/prepare/commit用于writev/readv，数据可以从socket到处理函数再到socket全程不复制。
+// 单个IOBuf非线程安全；共享同一内存块的不同IOBuf可以在不同线程使用。
+class IOBuf {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t MIN_BLOCK_SIZE = 16 * 1024;
+    static constexpr size_t MAX_POOLED_BLOCK_SIZE = 64 * 1024;
+
+    IOBuf() = default;
+
+    explicit IOBuf(std::string_view data) {
+        append(data);
+    }
+
+    // 接管std::string的内存，不复制
+    static IOBuf from_string(std::string&& str) {
+        IOBuf buf;
+        if (str.empty()) return buf;
+        auto* block = new StringBlock(std::move(str));
+        buf.segments_.push_back({block, block->base, block->capacity});
+        buf.size_ = block->capacity;
+        return buf;
+    }
+
+    // 引用外部内存，不复制；最后一个引用释放时调用release(context, data)
+    static IOBuf wrap(void* data, size_t size, void (*release)(void* context, void* data), void* context) {
+        IOBuf buf;
+        auto* block = new ExternalBlock(data, size, release, context);
+        buf.segments_.push_back({block, block->base, size});
+        buf.size_ = size;
+        return buf;
+    }
+
+    // 预留至少capacity字节的尾部空间
+    static IOBuf with_capacity(size_t capacity) {
+        IOBuf buf;
+        Block* block = allocate_block(capacity);
+        buf.segments_.push_back({block, block->base, 0});
+        return buf;
+    }
+
+    ~IOBuf() {
+        clear();
+    }
+
+    // 拷贝语义容易误用成深拷贝，共享请显式调用clone()
+    IOBuf(const IOBuf&) = delete;
+    IOBuf& operator=(const IOBuf&) = delete;
+
+    IOBuf(IOBuf&& other) noexcept
+        : segments_(std::move(other.segments_)), size_(other.size_) {
+        other.segments_.clear();
+        other.size_ = 0;
+    }
+
+    IOBuf& operator=(IOBuf&& other) noexcept {
+        if (this != &other) {
+            clear();
+            segments_ = std::move(other.segments_);
+            size_ = other.size_;
+            other.segments_.clear();
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    // 共享全部数据的新IOBuf
+    IOBuf clone() const {
+        return slice(0, size_);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t segment_count() const { return segments_.size(); }
+
+    std::string_view segment(size_t index) const {
+        const Segment& seg = segments_[index];
+        return {reinterpret_cast<const char*>(seg.data), seg.length};
+    }
+
+    void clear() {
+        for (auto& seg : segments_) {
+            release_block(seg.block);
+        }
+        segments_.clear();
+        size_ = 0;
+    }
+
+    // 追加数据：优先写入最后一个独占块的尾部空间
+    void append(const void* data, size_t len) {
+        auto* src = static_cast<const std::byte*>(data);
+        if (len == 0) return;
+        if (!segments_.empty()) {
+            Segment& tail = segments_.back();
+            size_t room = std::min(len, tailroom(tail));
+            if (room > 0) {
+                std::memcpy(tail.data + tail.length, src, room);
+                tail.length += room;
+                size_ += room;
+                src += room;
+                len -= room;
+            }
+        }
+        if (len > 0) {
+            Block* block = allocate_block(len);
+            std::memcpy(block->base, src, len);
+            segments_.push_back({block, block->base, len});
+            size_ += len;
+        }
+    }
+
+    void append(std::string_view data) {
+        append(data.data(), data.size());
+    }
+
+    // 把other的数据链接到末尾，不复制
+    void append(IOBuf&& other) {
+        if (other.empty()) return;
+        if (empty()) {
+            *this = std::move(other);
+            return;
+        }
+        drop_empty_tail();
+        segments_.insert(segments_.end(), other.segments_.begin(), other.segments_.end());
+        size_ += other.size_;
+        other.segments_.clear();
+        other.size_ = 0;
+    }
+
+    // 在头部插入数据：优先使用第一个独占块的头部空间，
+    // 新分配的块把数据放在末尾，为后续prepend（如协议头）留出空间
+    void prepend(const void* data, size_t len) {
+        auto* src = static_cast<const std::byte*>(data);
+        if (len == 0) return;
+        if (!segments_.empty()) {
+            Segment& head = segments_.front();
+            size_t room = std::min(len, headroom(head));
+            if (room > 0) {
+                head.data -= room;
+                head.length += room;
+                size_ += room;
+                len -= room;
+                std::memcpy(head.data, src + len, room);
+            }
+        }
+        if (len > 0) {
+            Block* block = allocate_block(len);
+            std::byte* dst = block->base + block->capacity - len;
+            std::memcpy(dst, src, len);
+            segments_.insert(segments_.begin(), {block, dst, len});
+            size_ += len;
+        }
+    }
+
+    void prepend(std::string_view data) {
+        prepend(data.data(), data.size());
+    }
+
+    void prepend(IOBuf&& other) {
+        other.append(std::move(*this));
+        *this = std::move(other);
+    }
+
+    // 取出前n字节作为新的IOBuf，边界所在的块由两者共享
+    IOBuf split(size_t n) {
+        n = std::min(n, size_);
+        IOBuf front;
+        size_t taken = 0;
+        size_t whole = 0;
+        while (whole < segments_.size() && taken + segments_[whole].length <= n) {
+            taken += segments_[whole].length;
+            ++whole;
+        }
+        front.segments_.assign(segments_.begin(), segments_.begin() + whole);
+        segments_.erase(segments_.begin(), segments_.begin() + whole);
+        if (taken < n) {
+            Segment& seg = segments_.front();
+            size_t part = n - taken;
+            retain_block(seg.block);
+            front.segments_.push_back({seg.block, seg.data, part});
+            seg.data += part;
+            seg.length -= part;
+        }
+        front.size_ = n;
+        size_ -= n;
+        return front;
+    }
+
+    // 丢弃头部n字节
+    void trim_start(size_t n) {
+        n = std::min(n, size_);
+        size_ -= n;
+        size_t first = 0;
+        while (n > 0) {
+            Segment& seg = segments_[first];
+            if (seg.length <= n) {
+                n -= seg.length;
+                release_block(seg.block);
+                ++first;
+            } else {
+                seg.data += n;
+                seg.length -= n;
+                n = 0;
+            }
+        }
+        segments_.erase(segments_.begin(), segments_.begin() + first);
+    }
+
+    // 丢弃尾部n字节
+    void trim_end(size_t n) {
+        n = std::min(n, size_);
+        size_ -= n;
+        while (n > 0) {
+            Segment& seg = segments_.back();
+            if (seg.length <= n) {
+                n -= seg.length;
+                release_block(seg.block);
+                segments_.pop_back();
+            } else {
+                seg.length -= n;
+                n = 0;
+            }
+        }
+    }
+
+    // [offset, offset+len)的零拷贝视图
+    IOBuf slice(size_t offset, size_t len) const {
+        IOBuf view;
+        if (offset >= size_) return view;
+        len = std::min(len, size_ - offset);
+        for (const auto& seg : segments_) {
+            if (len == 0) break;
+            if (offset >= seg.length) {
+                offset -= seg.length;
+                continue;
+            }
+            size_t part = std::min(len, seg.length - offset);
+            retain_block(seg.block);
+            view.segments_.push_back({seg.block, seg.data + offset, part});
+            view.size_ += part;
+            len -= part;
+            offset = 0;
+        }
+        return view;
+    }
+
+    // 合并为一段连续内存；已经连续时不复制
+    std::string_view coalesce() {
+        drop_empty_tail();
+        if (segments_.size() > 1) {
+            Block* block = allocate_block(size_);
+            std::byte* dst = block->base;
+            for (auto& seg : segments_) {
+                std::memcpy(dst, seg.data, seg.length);
+                dst += seg.length;
+                release_block(seg.block);
+            }
+            segments_.clear();
+            segments_.push_back({block, block->base, size_});
+        }
+        return segments_.empty() ? std::string_view{} : segment(0);
+    }
+
+    // 从offset开始查找字符，返回绝对位置或npos
+    size_t find(char c, size_t from = 0) const {
+        size_t base = 0;
+        for (const auto& seg : segments_) {
+            if (from < base + seg.length) {
+                size_t start = from > base ? from - base : 0;
+                if (const void* hit = std::memchr(seg.data + start, c, seg.length - start)) {
+                    return base + (static_cast<const std::byte*>(hit) - seg.data);
+                }
+            }
+            base += seg.length;
+        }
+        return npos;
+    }
+
+    // 复制[offset, offset+len)到dst，返回实际复制的字节数
+    size_t copy_to(void* dst, size_t offset, size_t len) const {
+        auto* out = static_cast<std::byte*>(dst);
+        size_t copied = 0;
+        for (const auto& seg : segments_) {
+            if (copied == len) break;
+            if (offset >= seg.length) {
+                offset -= seg.length;
+                continue;
+            }
+            size_t part = std::min(len - copied, seg.length - offset);
+            std::memcpy(out + copied, seg.data + offset, part);
+            copied += part;
+            offset = 0;
+        }
+        return copied;
+    }
+
+    std::string to_string() const {
+        std::string result(size_, '\0');
+        copy_to(result.data(), 0, size_);
+        return result;
+    }
+
+    // 导出数据段供writev使用，返回填充的iovec个数
+    size_t fill_iovec(iovec* iov, size_t max) const {
+        size_t count = 0;
+        for (const auto& seg : segments_) {
+            if (count == max) break;
+            if (seg.length == 0) continue;
+            iov[count].iov_base = seg.data;
+            iov[count].iov_len = seg.length;
+            ++count;
+        }
+        return count;
+    }
+
+    // 为readv准备至少min_bytes的可写空间，返回iovec个数；读完后调用commit(实际字节数)
+    // prepare与commit之间不能修改IOBuf
+    size_t prepare(iovec* iov, size_t max, size_t min_bytes) {
+        drop_empty_tail();
+        size_t count = 0;
+        size_t total = 0;
+        prepared_from_ = segments_.size();
+        if (!segments_.empty() && max > 0) {
+            Segment& tail = segments_.back();
+            if (size_t room = tailroom(tail); room > 0) {
+                iov[count].iov_base = tail.data + tail.length;
+                iov[count].iov_len = room;
+                ++count;
+                total += room;
+                prepared_from_ = segments_.size() - 1;
+            }
+        }
+        while (count < max && (total < min_bytes || count == 0)) {
+            Block* block = allocate_block(std::max(min_bytes - std::min(total, min_bytes), MIN_BLOCK_SIZE - HEADER_SIZE));
+            segments_.push_back({block, block->base, 0});
+            iov[count].iov_base = block->base;
+            iov[count].iov_len = block->capacity;
+            ++count;
+            total += block->capacity;
+        }
+        return count;
+    }
+
+    void commit(size_t n) {
+        for (size_t i = prepared_from_; i < segments_.size() && n > 0; ++i) {
+            Segment& seg = segments_[i];
+            size_t part = std::min(n, tailroom(seg));
+            seg.length += part;
+            size_ += part;
+            n -= part;
+        }
+        prepared_from_ = 0;
+        drop_empty_tail();
+    }
+
 private:
-    static constexpr size_t DEFAULT_CAPACITY = 4096;
-    static constexpr size_t MAX_SMALL_STRING = 23; // SSO阈值
-    
-    alignas(CACHE_LINE_SIZE) char* data_;
-    alignas(CACHE_LINE_SIZE) size_t capacity_;
-    alignas(CACHE_LINE_SIZE) size_t size_;
-    
-    // 小字符串优化
-    alignas(CACHE_LINE_SIZE) char small_buffer_[MAX_SMALL_STRING + 1];
-    bool use_small_buffer_;
-    
+    // 引用计数内存块，数据区紧跟在头部之后（外部内存除外）
+    struct Block {
+        std::atomic<uint32_t> refs{1};
+        std::byte* base = nullptr;
+        size_t capacity = 0;
+        void (*destroy)(Block*) = nullptr;
+    };
+
+    // 接管std::string内存的块
+    struct StringBlock : Block {
+        std::string storage;
+
+        explicit StringBlock(std::string&& str) : storage(std::move(str)) {
+            base = reinterpret_cast<std::byte*>(storage.data());
+            capacity = storage.size();
+            destroy = [](Block* b) { delete static_cast<StringBlock*>(b); };
+        }
+    };
+
+    // 引用外部内存的块，容量等于数据长度，不会在尾部追加写入
+    struct ExternalBlock : Block {
+        void (*release)(void* context, void* data);
+        void* context;
+
+        ExternalBlock(void* data, size_t size, void (*release_fn)(void*, void*), void* ctx)
+            : release(release_fn), context(ctx) {
+            base = static_cast<std::byte*>(data);
+            capacity = size;
+            destroy = [](Block* b) {
+                auto* self = static_cast<ExternalBlock*>(b);
+                self->release(self->context, self->base);
+                delete self;
+            };
+        }
+    };
+
+    struct Segment {
+        Block* block;
+        std::byte* data;
+        size_t length;
+    };
+
+    static constexpr size_t HEADER_SIZE = (sizeof(Block) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    static constexpr size_t POOL_CLASSES = 3;  // 16KiB, 32KiB, 64KiB
+
+    // 全局块池，刻意泄漏：线程退出时缓存中的块仍可归还
+    static MemoryPool& block_pool(size_t index) {
+        static MemoryPool** pools = [] {
+            auto** created = new MemoryPool*[POOL_CLASSES];
+            for (size_t i = 0; i < POOL_CLASSES; ++i) {
+                size_t size = MIN_BLOCK_SIZE << i;
+                created[i] = new MemoryPool(size, 4);
+                created[i]->set_max_total_blocks(SIZE_MAX / size);
+            }
+            return created;
+        }();
+        return *pools[index];
+    }
+
+    // 分配可容纳至少capacity字节的块，超过64KiB的直接从堆上分配
+    static Block* allocate_block(size_t capacity) {
+        size_t needed = HEADER_SIZE + capacity;
+        for (size_t i = 0; i < POOL_CLASSES; ++i) {
+            size_t size = MIN_BLOCK_SIZE << i;
+            if (needed <= size) {
+                void* memory = block_pool(i).allocate();
+                return init_block(memory, size, [](Block* b) {
+                    size_t index = std::countr_zero(static_cast<size_t>(b->capacity + HEADER_SIZE) / MIN_BLOCK_SIZE);
+                    b->~Block();
+                    block_pool(index).deallocate(b);
+                });
+            }
+        }
+        void* memory = ::operator new(needed);
+        return init_block(memory, needed, [](Block* b) {
+            b->~Block();
+            ::operator delete(b);
+        });
+    }
+
+    static Block* init_block(void* memory, size_t total, void (*destroy)(Block*)) {
+        auto* block = new (memory) Block();
+        block->base = static_cast<std::byte*>(memory) + HEADER_SIZE;
+        block->capacity = total - HEADER_SIZE;
+        block->destroy = destroy;
+        return block;
+    }
+
+    static void retain_block(Block* block) {
+        block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void release_block(Block* block) {
+        if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            block->destroy(block);
+        }
+    }
+
+    static bool unique(const Segment& seg) {
+        return seg.block->refs.load(std::memory_order_acquire) == 1;
+    }
+
+    static size_t headroom(const Segment& seg) {
+        return unique(seg) ? static_cast<size_t>(seg.data - seg.block->base) : 0;
+    }
+
+    static size_t tailroom(const Segment& seg) {
+        return unique(seg) ? static_cast<size_t>(seg.block->base + seg.block->capacity - (seg.data + seg.length)) : 0;
+    }
+
+    // prepare留下的空段在链接或合并前移除
+    void drop_empty_tail() {
+        while (!segments_.empty() && segments_.back().length == 0) {
+            release_block(segments_.back().block);
+            segments_.pop_back();
+        }
+    }
+
+    std::vector<Segment> segments_;
+    size_t size_ = 0;
+    size_t prepared_from_ = 0;
+};
+
+// 字符串构建缓冲区
+// 底层是一个std::string，size()之外的部分作为写入余量，append/append_format直接写入其中；
+// release()/release_iobuf()把内存原样交出，不复制。
+// 未交出的内存在析构时放回线程本地缓存，下一个StringBuffer可以直接复用已增长的容量。
+class StringBuffer {
 public:
-    StringBuffer(size_t initial_capacity = DEFAULT_CAPACITY) 
-        : capacity_(initial_capacity), size_(0), use_small_buffer_(true) {
-        
-        if (initial_capacity > MAX_SMALL_STRING) {
-            data_ = static_cast<char*>(AlignedAllocator<>::allocate(capacity_));
-            use_small_buffer_ = false;
-        } else {
-            data_ = small_buffer_;
-        }
-        
-        data_[0] = '\0';
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+    static constexpr size_t MAX_RECYCLED_CAPACITY = 64 * 1024;  // 更大的缓冲区不回收
+
+    explicit StringBuffer(size_t initial_capacity = DEFAULT_CAPACITY)
+        : storage_(acquire_storage()) {
+        ensure_capacity(initial_capacity);
+        storage_[0] = '\0';
     }
-    
+
     ~StringBuffer() {
-        if (!use_small_buffer_) {
-            AlignedAllocator<>::deallocate(data_);
-        }
+        recycle_storage(std::move(storage_));
     }
-    
+
     // 禁止拷贝，允许移动
     StringBuffer(const StringBuffer&) = delete;
     StringBuffer& operator=(const StringBuffer&) = delete;
-    
-    StringBuffer(StringBuffer&& other) noexcept 
-        : capacity_(other.capacity_), size_(other.size_), use_small_buffer_(other.use_small_buffer_) {
-        
-        if (use_small_buffer_) {
-            std::memcpy(small_buffer_, other.small_buffer_, size_ + 1);
-            data_ = small_buffer_;
-        } else {
-            data_ = other.data_;
-            other.data_ = nullptr;
-        }
-        
+
+    StringBuffer(StringBuffer&& other) noexcept
+        : storage_(std::move(other.storage_)), size_(other.size_) {
+        other.storage_.clear();
         other.size_ = 0;
-        other.capacity_ = 0;
     }
-    
+
+    StringBuffer& operator=(StringBuffer&& other) noexcept {
+        if (this != &other) {
+            storage_ = std::move(other.storage_);
+            size_ = other.size_;
+            other.storage_.clear();
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
     // 追加字符串
     void append(const char* str, size_t len) {
-        ensure_capacity(size_ + len + 1);
-        std::memcpy(data_ + size_, str, len);
+        ensure_capacity(size_ + len);
+        std::memcpy(storage_.data() + size_, str, len);
         size_ += len;
-        data_[size_] = '\0';
+        storage_[size_] = '\0';
     }
-    
-    void append(const std::string& str) {
-        append(str.c_str(), str.length());
+
+    void append(std::string_view str) {
+        append(str.data(), str.size());
     }
-    
+
     void append(char c) {
-        ensure_capacity(size_ + 2);
-        data_[size_++] = c;
-        data_[size_] = '\0';
+        ensure_capacity(size_ + 1);
+        storage_[size_++] = c;
+        storage_[size_] = '\0';
     }
-    
-    // 格式化追加
-    template<typename... Args>
-    void append_format(const char* format, Args&&... args) {
-        char temp_buffer[1024];
-        int len = std::snprintf(temp_buffer, sizeof(temp_buffer), format, std::forward<Args>(args)...);
+
+    // 追加整数或浮点数的十进制表示
+    template<typename T>
+        requires std::is_arithmetic_v<T> && (!std::is_same_v<T, char>) && (!std::is_same_v<T, bool>)
+    void append_number(T value) {
+        constexpr size_t MAX_DIGITS = 64;
+        ensure_capacity(size_ + MAX_DIGITS);
+        auto [end, ec] = std::to_chars(storage_.data() + size_, storage_.data() + size_ + MAX_DIGITS, value);
+        if (ec == std::errc()) {
+            size_ = static_cast<size_t>(end - storage_.data());
+        }
+        storage_[size_] = '\0';
+    }
+
+    // 格式化追加：直接写入缓冲区剩余空间，空间不足时扩容后重写，不截断
+    // 格式串与参数类型由编译器按printf规则检查(-Wformat)
+    __attribute__((format(printf, 2, 3)))
+    void append_format(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        va_list retry;
+        va_copy(retry, args);
+        size_t room = storage_.size() - size_;
+        int len = std::vsnprintf(storage_.data() + size_, room, format, args);
+        va_end(args);
+        if (len > 0 && static_cast<size_t>(len) >= room) {
+            ensure_capacity(size_ + static_cast<size_t>(len));
+            std::vsnprintf(storage_.data() + size_, static_cast<size_t>(len) + 1, format, retry);
+        }
+        va_end(retry);
         if (len > 0) {
-            append(temp_buffer, static_cast<size_t>(len));
+            size_ += static_cast<size_t>(len);
         }
+        storage_[size_] = '\0';
     }
-    
-    // 清空缓冲区
+
+    // 清空缓冲区，保留容量
     void clear() {
         size_ = 0;
-        data_[0] = '\0';
+        storage_[0] = '\0';
     }
-    
-    // 重置大小
+
+    // 重置大小，新增部分补零
     void resize(size_t new_size) {
-        ensure_capacity(new_size + 1);
+        ensure_capacity(new_size);
+        if (new_size > size_) {
+            std::memset(storage_.data() + size_, 0, new_size - size_);
+        }
         size_ = new_size;
-        data_[size_] = '\0';
+        storage_[size_] = '\0';
     }
-    
+
+    void reserve(size_t capacity) {
+        ensure_capacity(capacity);
+    }
+
     // 访问器
-    const char* c_str() const { return data_; }
-    const char* data() const { return data_; }
+    const char* c_str() const { return storage_.c_str(); }
+    const char* data() const { return storage_.data(); }
     size_t size() const { return size_; }
-    size_t capacity() const { return capacity_; }
+    size_t capacity() const { return storage_.empty() ? 0 : storage_.size() - 1; }
     bool empty() const { return size_ == 0; }
-    
-    // 转换为std::string
+    std::string_view view() const { return {storage_.data(), size_}; }
+
+    // 复制为std::string，缓冲区保持不变
     std::string to_string() const {
-        return std::string(data_, size_);
+        return std::string(storage_.data(), size_);
     }
-    
+
+    // 交出内容，不复制；之后缓冲区为空，可以继续使用
+    std::string release() {
+        storage_.resize(size_);
+        std::string result = std::move(storage_);
+        storage_ = acquire_storage();
+        size_ = 0;
+        ensure_capacity(0);
+        storage_[0] = '\0';
+        return result;
+    }
+
+    IOBuf release_iobuf() {
+        return IOBuf::from_string(release());
+    }
+
 private:
+    // 保证至少能写入required个字符外加结尾的'\0'
     void ensure_capacity(size_t required) {
-        if (required <= capacity_) return;
-        
-        // 计算新容量（2的倍数增长）
-        size_t new_capacity = capacity_;
-        while (new_capacity < required) {
-            new_capacity *= 2;
-        }
-        
-        if (use_small_buffer_ && new_capacity > MAX_SMALL_STRING) {
-            // 从小缓冲区迁移到大缓冲区
-            char* new_data = static_cast<char*>(AlignedAllocator<>::allocate(new_capacity));
-            std::memcpy(new_data, small_buffer_, size_ + 1);
-            data_ = new_data;
-            use_small_buffer_ = false;
-            capacity_ = new_capacity;
-        } else if (!use_small_buffer_) {
-            // 扩展大缓冲区
-            char* new_data = static_cast<char*>(AlignedAllocator<>::allocate(new_capacity));
-            std::memcpy(new_data, data_, size_ + 1);
-            AlignedAllocator<>::deallocate(data_);
-            data_ = new_data;
-            capacity_ = new_capacity;
+        if (required < storage_.size()) return;
+        size_t new_size = std::max<size_t>(storage_.size() * 2, DEFAULT_CAPACITY);
+        while (new_size <= required) {
+            new_size *= 2;
+        }
+        storage_.resize(new_size);
+    }
+
+    // 线程本地的回收缓存
+    struct StorageCache {
+        static constexpr size_t SLOTS = 8;
+        std::string slots[SLOTS];
+        size_t count;
+
+        StorageCache() noexcept : count(0) {}
+
+        ~StorageCache() {
+            tls_exited_ = true;
+        }
+    };
+
+    static std::string acquire_storage() {
+        if (!tls_exited_) {
+            StorageCache& cache = tls_cache_;
+            if (cache.count > 0) {
+                return std::move(cache.slots[--cache.count]);
+            }
+        }
+        return std::string();
+    }
+
+    static void recycle_storage(std::string&& storage) {
+        if (tls_exited_ || storage.capacity() > MAX_RECYCLED_CAPACITY || storage.size() < DEFAULT_CAPACITY) {
+            return;
+        }
+        StorageCache& cache = tls_cache_;
+        if (cache.count < StorageCache::SLOTS) {
+            cache.slots[cache.count++] = std::move(storage);
         }
     }
+
+    std::string storage_;  // size()为当前容量+1，内容只有前size_个字符有效
+    size_t size_ = 0;
+
+    static inline thread_local StorageCache tls_cache_;
+    static inline thread_local bool tls_exited_ = false;
 };
 
 } // namespace flowcoro
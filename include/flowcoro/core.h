@@ -17,6 +17,7 @@
 #include <queue>
 #include <condition_variable>
 #include <iostream>
+#include <memory_resource>
 #include "result.h"
 #include "error_handling.h"
 #include "lockfree.h" 
@@ -42,6 +43,9 @@ void schedule_task_enhanced(std::function<void()> task);
 // 驱动协程池 - 需要在主线程中定期调用
 void drive_coroutine_pool();
 
+// 协程池中是否还有待恢复的协程
+bool coroutine_pool_has_pending();
+
 // 统计信息接口 - 查看协程池状态
 void print_pool_stats();
 
@@ -52,6 +56,113 @@ void shutdown_coroutine_pool();
 // FlowCoro 2.0 - 基于ioManager设计的协程管理器架构
 // ==========================================
 
+// ==========================================
+// 协程本地内存资源 - 请求级arena
+// ==========================================
+
+namespace detail {
+inline thread_local std::pmr::memory_resource* current_arena = nullptr;
+
+// 按co_await的规则取得真正的awaiter：成员operator co_await、非成员operator co_await，否则是操作数本身
+// 返回值类型保留值/引用类别，临时awaiter由调用方按值持有
+template<typename Awaitable>
+decltype(auto) get_awaiter(Awaitable&& awaitable) {
+    if constexpr (requires { std::forward<Awaitable>(awaitable).operator co_await(); }) {
+        return std::forward<Awaitable>(awaitable).operator co_await();
+    } else if constexpr (requires { operator co_await(std::forward<Awaitable>(awaitable)); }) {
+        return operator co_await(std::forward<Awaitable>(awaitable));
+    } else {
+        return std::forward<Awaitable>(awaitable);
+    }
+}
+}
+
+// 当前协程的arena，未设置时为nullptr
+inline std::pmr::memory_resource* current_arena() noexcept {
+    return detail::current_arena;
+}
+
+// 当前协程应使用的内存资源：有arena用arena，否则用pmr默认资源
+inline std::pmr::memory_resource* current_memory_resource() noexcept {
+    auto* arena = detail::current_arena;
+    return arena ? arena : std::pmr::get_default_resource();
+}
+
+// 为分配器类型构造默认实例：pmr分配器取当前协程的arena，其他分配器默认构造
+template<typename Allocator>
+Allocator default_allocator() {
+    if constexpr (std::is_constructible_v<Allocator, std::pmr::memory_resource*>) {
+        return Allocator(current_memory_resource());
+    } else {
+        return Allocator();
+    }
+}
+
+// 在作用域内设置当前arena，期间创建的Task都继承该arena
+class ArenaScope {
+public:
+    explicit ArenaScope(std::pmr::memory_resource* arena) noexcept
+        : previous_(detail::current_arena) {
+        detail::current_arena = arena;
+    }
+    ~ArenaScope() { detail::current_arena = previous_; }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+// Task的promise基类：创建时继承当前arena；挂起时记下协程内的当前arena并还原外层的，
+// 恢复执行时再设回，协程在其他线程恢复或在体内使用ArenaScope都能保持一致
+struct ArenaPromiseBase {
+    std::pmr::memory_resource* arena_ = detail::current_arena;
+    std::pmr::memory_resource* outer_arena_ = detail::current_arena;
+
+    void enter_arena() noexcept {
+        outer_arena_ = detail::current_arena;
+        detail::current_arena = arena_;
+    }
+
+    void leave_arena() noexcept {
+        arena_ = detail::current_arena;
+        detail::current_arena = outer_arena_;
+    }
+
+    // Awaiter为引用时引用操作数（在整个co_await表达式内有效），为值类型时持有operator co_await返回的awaiter
+    template<typename Awaiter>
+    struct ArenaAwaiter {
+        Awaiter inner;
+        ArenaPromiseBase& promise;
+        bool suspended = false;
+
+        bool await_ready() { return inner.await_ready(); }
+
+        template<typename Handle>
+        auto await_suspend(Handle h) {
+            // 必须在交出控制权之前还原，之后协程可能已在其他线程恢复
+            promise.leave_arena();
+            suspended = true;
+            return inner.await_suspend(h);
+        }
+
+        decltype(auto) await_resume() {
+            // await_ready直接返回true时没有离开过arena，无需恢复
+            if (suspended) {
+                promise.enter_arena();
+            }
+            return inner.await_resume();
+        }
+    };
+
+    template<typename Awaitable>
+    auto await_transform(Awaitable&& awaitable) {
+        using Awaiter = decltype(detail::get_awaiter(std::forward<Awaitable>(awaitable)));
+        return ArenaAwaiter<Awaiter>{detail::get_awaiter(std::forward<Awaitable>(awaitable)), *this};
+    }
+};
+
 // 前向声明
 class CoroutineManager;
 
@@ -79,8 +190,47 @@ public:
     
     // 添加定时器
     void add_timer(std::chrono::steady_clock::time_point when, std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(timer_mutex_);
+            timer_queue_.emplace(when, handle);
+        }
+        wake_parked();
+    }
+    
+    // 最早到期的定时器，没有定时器时返回time_point::max()
+    std::chrono::steady_clock::time_point next_timer_deadline() {
         std::lock_guard<std::mutex> lock(timer_mutex_);
-        timer_queue_.emplace(when, handle);
+        return timer_queue_.empty() ? std::chrono::steady_clock::time_point::max() : timer_queue_.top().first;
+    }
+    
+    // 是否有不需要等待就能处理的工作（就绪协程、待销毁协程）
+    bool has_ready_work() {
+        {
+            std::lock_guard<std::mutex> lock(ready_mutex_);
+            if (!ready_queue_.empty()) return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(destroy_mutex_);
+            if (!destroy_queue_.empty()) return true;
+        }
+        return coroutine_pool_has_pending();
+    }
+    
+    // 停放点：由事件循环驱动调度时，其他线程提交的工作通过waker唤醒在epoll/io_uring中等待的事件循环。
+    // 同一时间只能有一个停放点，已设置时返回false；waker在设置它的线程上不会被调用
+    bool set_waker(std::function<void()> waker) {
+        std::lock_guard<std::mutex> lock(waker_mutex_);
+        if (waker_) return false;
+        waker_ = std::move(waker);
+        waker_thread_ = std::this_thread::get_id();
+        has_waker_.store(true, std::memory_order_release);
+        return true;
+    }
+    
+    void clear_waker() {
+        std::lock_guard<std::mutex> lock(waker_mutex_);
+        has_waker_.store(false, std::memory_order_release);
+        waker_ = nullptr;
     }
     
     // 调度协程恢复 - 集成协程池
@@ -105,6 +255,7 @@ public:
         
         // 使用增强的协程池进行调度
         schedule_coroutine_enhanced(handle);
+        wake_parked();
     }
     
     // 调度协程销毁（延迟销毁）
@@ -122,6 +273,14 @@ public:
     }
     
 private:
+    void wake_parked() {
+        if (!has_waker_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(waker_mutex_);
+        if (waker_ && std::this_thread::get_id() != waker_thread_) {
+            waker_();
+        }
+    }
+    
     void process_timer_queue() {
         std::lock_guard<std::mutex> lock(timer_mutex_);
         auto now = std::chrono::steady_clock::now();
@@ -217,6 +376,12 @@ private:
     // 延迟销毁队列
     std::queue<std::coroutine_handle<>> destroy_queue_;
     std::mutex destroy_mutex_;
+    
+    // 停放点唤醒
+    std::atomic<bool> has_waker_{false};
+    std::function<void()> waker_;
+    std::thread::id waker_thread_;
+    std::mutex waker_mutex_;
 };
 
 // 安全的时钟等待器 - 参考ioManager的clock设计
@@ -635,7 +800,7 @@ private:
 
 template<typename T>
 struct Task {
-    struct promise_type {
+    struct promise_type : ArenaPromiseBase {
         std::optional<T> value;
         bool has_error = false; // 替换exception_ptr
         
@@ -656,7 +821,10 @@ struct Task {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
         std::suspend_never initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept {
+            leave_arena();
+            return {};
+        }
         
         void return_value(T v) noexcept { 
             std::lock_guard<std::mutex> lock(state_mutex_);
@@ -743,7 +911,7 @@ struct Task {
         if (handle && !handle.done() && !handle.promise().is_destroyed()) {
             handle.promise().request_cancellation();
             LOG_INFO("Task::cancel: Task cancelled (lifetime: %lld ms)", 
-                     handle.promise().get_lifetime().count());
+                     static_cast<long long>(handle.promise().get_lifetime().count()));
         }
     }
     
@@ -974,7 +1142,7 @@ struct Task {
 // Task<Result<T,E>>特化 - 支持Result错误处理
 template<typename T, typename E>
 struct Task<Result<T, E>> {
-    struct promise_type {
+    struct promise_type : ArenaPromiseBase {
         std::optional<Result<T, E>> result;
         std::exception_ptr exception;
         
@@ -994,7 +1162,10 @@ struct Task<Result<T, E>> {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
         std::suspend_never initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept {
+            leave_arena();
+            return {};
+        }
         
         void return_value(Result<T, E> r) noexcept {
             std::lock_guard<std::mutex> lock(state_mutex_);
@@ -1181,7 +1352,7 @@ struct Task<Result<T, E>> {
 // Task<void>特化 - 增强版集成生命周期管理
 template<>
 struct Task<void> {
-    struct promise_type {
+    struct promise_type : ArenaPromiseBase {
         bool has_error = false; // 替换exception_ptr
         
         // 增强版生命周期管理 - 与Task<T>保持一致
@@ -1201,7 +1372,10 @@ struct Task<void> {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
         std::suspend_never initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept {
+            leave_arena();
+            return {};
+        }
         
         void return_void() noexcept {
             // 增强版 - 检查状态
@@ -1293,7 +1467,7 @@ struct Task<void> {
         if (handle && !handle.done() && !handle.promise().is_destroyed()) {
             handle.promise().request_cancellation();
             LOG_INFO("Task<void>::cancel: Task cancelled (lifetime: %lld ms)", 
-                     handle.promise().get_lifetime().count());
+                     static_cast<long long>(handle.promise().get_lifetime().count()));
         }
     }
     
@@ -1726,14 +1900,17 @@ private:
 // Task<unique_ptr<T>>特化，支持移动语义
 template<typename T>
 struct Task<std::unique_ptr<T>> {
-    struct promise_type {
+    struct promise_type : ArenaPromiseBase {
         std::unique_ptr<T> value;
         std::exception_ptr exception;
         Task get_return_object() {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
         std::suspend_never initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept {
+            leave_arena();
+            return {};
+        }
         void return_value(std::unique_ptr<T> v) noexcept { value = std::move(v); }
         void unhandled_exception() { exception = std::current_exception(); }
     };
@@ -1983,15 +2160,20 @@ Task<std::tuple<decltype(std::declval<Tasks>().get())...>> when_all(Tasks&&... t
     auto task_tuple = std::make_tuple(std::forward<Tasks>(tasks)...);
     
     // 顺序执行每个task，就像for循环一样
-    auto result0 = co_await std::get<0>(task_tuple);
+    // 先绑定到具名引用再co_await，避免GCC 12对非具名左值awaiter执行拷贝
+    auto& task0 = std::get<0>(task_tuple);
+    auto result0 = co_await task0;
     if constexpr (sizeof...(tasks) == 1) {
         co_return std::make_tuple(std::move(result0));
     } else if constexpr (sizeof...(tasks) == 2) {
-        auto result1 = co_await std::get<1>(task_tuple);
+        auto& task1 = std::get<1>(task_tuple);
+        auto result1 = co_await task1;
         co_return std::make_tuple(std::move(result0), std::move(result1));
     } else if constexpr (sizeof...(tasks) == 3) {
-        auto result1 = co_await std::get<1>(task_tuple);
-        auto result2 = co_await std::get<2>(task_tuple);
+        auto& task1 = std::get<1>(task_tuple);
+        auto& task2 = std::get<2>(task_tuple);
+        auto result1 = co_await task1;
+        auto result2 = co_await task2;
         co_return std::make_tuple(std::move(result0), std::move(result1), std::move(result2));
     }
     // 可以继续扩展更多数量...
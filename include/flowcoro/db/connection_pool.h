@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <chrono>
 #include <atomic>
@@ -35,18 +36,42 @@ struct ConnectionPoolConfig {
 };
 
 // 查询结果结构体
-struct QueryResult {
+// Allocator为std::pmr::polymorphic_allocator时结果行从当前协程的arena分配（见pmr::QueryResult）
+template<typename Allocator = std::allocator<char>>
+struct BasicQueryResult {
+    using allocator_type = Allocator;
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+    using row_type = std::unordered_map<
+        string_type, string_type, std::hash<string_type>, std::equal_to<string_type>,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const string_type, string_type>>>;
+    using row_list = std::vector<row_type, typename std::allocator_traits<Allocator>::template rebind_alloc<row_type>>;
+
     bool success{false};
-    std::string error;
-    std::vector<std::unordered_map<std::string, std::string>> rows;
+    string_type error;
+    row_list rows;
     uint64_t affected_rows{0};
     uint64_t insert_id{0};
+
+    BasicQueryResult() : BasicQueryResult(default_allocator<Allocator>()) {}
+
+    explicit BasicQueryResult(const allocator_type& alloc) : error(alloc), rows(alloc) {}
+
+    BasicQueryResult(const BasicQueryResult&) = default;
+    BasicQueryResult(BasicQueryResult&&) noexcept = default;
+    BasicQueryResult& operator=(const BasicQueryResult&) = default;
+    BasicQueryResult& operator=(BasicQueryResult&&) = default;
+
+    BasicQueryResult(const BasicQueryResult& other, const allocator_type& alloc)
+        : success(other.success), error(other.error, alloc), rows(other.rows, alloc),
+          affected_rows(other.affected_rows), insert_id(other.insert_id) {}
+
+    allocator_type get_allocator() const { return error.get_allocator(); }
     
     // 便捷访问方法
     bool empty() const { return rows.empty(); }
     size_t size() const { return rows.size(); }
     
-    const std::unordered_map<std::string, std::string>& operator[](size_t index) const {
+    const row_type& operator[](size_t index) const {
         return rows[index];
     }
     
@@ -55,6 +80,12 @@ struct QueryResult {
     auto end() const { return rows.end(); }
 };
 
+using QueryResult = BasicQueryResult<>;
+
+namespace pmr {
+using QueryResult = BasicQueryResult<std::pmr::polymorphic_allocator<char>>;
+}
+
 // 数据库连接接口
 class IConnection {
 public:
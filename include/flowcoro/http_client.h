@@ -4,6 +4,8 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 #include <sstream>
 #include <regex>
 #include <chrono>
@@ -38,19 +40,145 @@ enum class HttpMethod {
 };
 
 // HTTP响应状态
-struct HttpResponse {
+// Allocator为std::pmr::polymorphic_allocator时字段和头部表从当前协程的arena分配（见pmr::HttpResponse）
+template<typename Allocator = std::allocator<char>>
+struct BasicHttpResponse {
+    using allocator_type = Allocator;
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+    using header_map = std::unordered_map<
+        string_type, string_type, std::hash<string_type>, std::equal_to<string_type>,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const string_type, string_type>>>;
+
     int status_code = 0;
-    std::string status_text;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
+    string_type status_text;
+    header_map headers;
+    string_type body;
     bool success = false;
-    std::string error_message;
+    string_type error_message;
     
-    HttpResponse() = default;
-    HttpResponse(int code, const std::string& text, const std::string& content) 
-        : status_code(code), status_text(text), body(content), success(code >= 200 && code < 300) {}
+    BasicHttpResponse() : BasicHttpResponse(default_allocator<Allocator>()) {}
+
+    explicit BasicHttpResponse(const allocator_type& alloc)
+        : status_text(alloc), headers(alloc), body(alloc), error_message(alloc) {}
+
+    BasicHttpResponse(int code, std::string_view text, std::string_view content,
+                      const allocator_type& alloc = default_allocator<Allocator>())
+        : status_code(code), status_text(text, alloc), headers(alloc), body(content, alloc),
+          success(code >= 200 && code < 300), error_message(alloc) {}
+
+    BasicHttpResponse(const BasicHttpResponse&) = default;
+    BasicHttpResponse(BasicHttpResponse&&) noexcept = default;
+    BasicHttpResponse& operator=(const BasicHttpResponse&) = default;
+    BasicHttpResponse& operator=(BasicHttpResponse&&) = default;
+
+    BasicHttpResponse(const BasicHttpResponse& other, const allocator_type& alloc)
+        : status_code(other.status_code), status_text(other.status_text, alloc),
+          headers(other.headers.begin(), other.headers.end(), other.headers.bucket_count(),
+                  typename header_map::hasher(), typename header_map::key_equal(), alloc),
+          body(other.body, alloc), success(other.success), error_message(other.error_message, alloc) {}
+
+    allocator_type get_allocator() const { return body.get_allocator(); }
+
+    // 对象池复用时清空内容但保留容量（ObjectPoolTraits的默认钩子）
+    void pool_reset() {
+        status_code = 0;
+        status_text.clear();
+        headers.clear();
+        body.clear();
+        success = false;
+        error_message.clear();
+    }
 };
 
+using HttpResponse = BasicHttpResponse<>;
+
+namespace pmr {
+using HttpResponse = BasicHttpResponse<std::pmr::polymorphic_allocator<char>>;
+}
+
+// 解析HTTP响应；基于string_view切分，除结果字段外不产生中间字符串
+template<typename Allocator = std::allocator<char>>
+BasicHttpResponse<Allocator> parse_http_response(std::string_view raw_response,
+                                                 const Allocator& alloc = default_allocator<Allocator>()) {
+    BasicHttpResponse<Allocator> response(alloc);
+
+    if (raw_response.empty()) {
+        response.error_message = "Empty response";
+        return response;
+    }
+
+    // 分离头部和主体
+    size_t header_end = raw_response.find("\r\n\r\n");
+    if (header_end == std::string_view::npos) {
+        response.error_message = "Invalid HTTP response format";
+        return response;
+    }
+
+    std::string_view headers_part = raw_response.substr(0, header_end);
+    response.body = raw_response.substr(header_end + 4);
+
+    auto next_line = [&headers_part]() {
+        size_t eol = headers_part.find('\n');
+        std::string_view line = headers_part.substr(0, eol);
+        headers_part = eol == std::string_view::npos ? std::string_view{} : headers_part.substr(eol + 1);
+        // 移除\r
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return line;
+    };
+    auto is_space = [](char c) { return c == ' ' || c == '\t'; };
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    // 解析状态行: "HTTP/1.1 200 OK"
+    std::string_view status_line = next_line();
+    size_t pos = 0;
+    bool valid = status_line.size() > 8 && status_line.substr(0, 5) == "HTTP/" &&
+                 is_digit(status_line[5]) && status_line[6] == '.' && is_digit(status_line[7]);
+    if (valid) {
+        pos = 8;
+        size_t ws_begin = pos;
+        while (pos < status_line.size() && is_space(status_line[pos])) ++pos;
+        size_t code_begin = pos;
+        while (pos < status_line.size() && is_digit(status_line[pos])) ++pos;
+        // 状态码恰好三位，之后是空白或行尾（原因短语可以为空）
+        valid = code_begin > ws_begin && pos - code_begin == 3 &&
+                (pos == status_line.size() || is_space(status_line[pos]));
+        if (valid) {
+            response.status_code = (status_line[code_begin] - '0') * 100 +
+                                   (status_line[code_begin + 1] - '0') * 10 + (status_line[code_begin + 2] - '0');
+            while (pos < status_line.size() && is_space(status_line[pos])) ++pos;
+            response.status_text = status_line.substr(pos);
+        }
+    }
+    if (!valid) {
+        response.error_message = "Invalid status line: ";
+        response.error_message += status_line;
+        return response;
+    }
+
+    // 解析头部
+    while (!headers_part.empty()) {
+        std::string_view header_line = next_line();
+        if (header_line.empty()) break;
+
+        size_t colon_pos = header_line.find(':');
+        if (colon_pos != std::string_view::npos) {
+            auto trim = [&is_space](std::string_view v) {
+                while (!v.empty() && is_space(v.front())) v.remove_prefix(1);
+                while (!v.empty() && is_space(v.back())) v.remove_suffix(1);
+                return v;
+            };
+            using string_type = typename BasicHttpResponse<Allocator>::string_type;
+            response.headers.insert_or_assign(string_type(trim(header_line.substr(0, colon_pos)), alloc),
+                                              string_type(trim(header_line.substr(colon_pos + 1)), alloc));
+        }
+    }
+
+    response.success = (response.status_code >= 200 && response.status_code < 300);
+    return response;
+}
+
 // URL解析结果
 struct ParsedUrl {
     std::string scheme;     // http/https
@@ -255,74 +383,7 @@ private:
     
     // 解析HTTP响应
     HttpResponse parse_response(const std::string& raw_response) {
-        HttpResponse response;
-        
-        if (raw_response.empty()) {
-            response.error_message = "Empty response";
-            return response;
-        }
-        
-        // 分离头部和主体
-        size_t header_end = raw_response.find("\r\n\r\n");
-        if (header_end == std::string::npos) {
-            response.error_message = "Invalid HTTP response format";
-            return response;
-        }
-        
-        std::string headers_part = raw_response.substr(0, header_end);
-        response.body = raw_response.substr(header_end + 4);
-        
-        // 解析状态行
-        std::istringstream header_stream(headers_part);
-        std::string status_line;
-        if (!std::getline(header_stream, status_line)) {
-            response.error_message = "No status line";
-            return response;
-        }
-        
-        // 移除\r
-        if (!status_line.empty() && status_line.back() == '\r') {
-            status_line.pop_back();
-        }
-        
-        // 解析状态行: "HTTP/1.1 200 OK"
-        std::regex status_regex(R"(HTTP/\d\.\d\s+(\d+)\s+(.*))");
-        std::smatch matches;
-        if (std::regex_match(status_line, matches, status_regex)) {
-            response.status_code = std::stoi(matches[1].str());
-            response.status_text = matches[2].str();
-        } else {
-            response.error_message = "Invalid status line: " + status_line;
-            return response;
-        }
-        
-        // 解析头部
-        std::string header_line;
-        while (std::getline(header_stream, header_line)) {
-            // 移除\r
-            if (!header_line.empty() && header_line.back() == '\r') {
-                header_line.pop_back();
-            }
-            
-            if (header_line.empty()) break;
-            
-            size_t colon_pos = header_line.find(':');
-            if (colon_pos != std::string::npos) {
-                std::string key = header_line.substr(0, colon_pos);
-                std::string value = header_line.substr(colon_pos + 1);
-                
-                // 去除前后空格
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                
-                response.headers[key] = value;
-            }
-        }
-        
-        response.success = (response.status_code >= 200 && response.status_code < 300);
-        return response;
+        return parse_http_response(raw_response);
     }
     
 public:
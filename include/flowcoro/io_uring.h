@@ -0,0 +1,193 @@
+/**
+ * @file io_uring.h
+ * @brief io_uring的最小封装
+ * 直接使用io_uring_setup/io_uring_enter/io_uring_register系统调用，不依赖liburing。
+ * 只在所属事件循环的线程上使用（IoUringBufferRing::release除外）。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "buffer.h"
+
+#include <linux/io_uring.h>
+// linux/fs.h定义的BLOCK_SIZE宏会与内存池的同名常量冲突
+#undef BLOCK_SIZE
+
+namespace flowcoro::net {
+
+/**
+ * @brief io_uring实例：SQ/CQ两个ring加SQE数组
+ * get_sqe只在本地累积，submit/submit_and_wait时一次io_uring_enter批量提交。
+ */
+class IoUring {
+public:
+    // 内核是否支持网络后端需要的操作和特性（结果缓存）
+    static bool supported();
+
+    /**
+     * @brief 创建io_uring实例
+     * @param entries SQ大小，CQ为其两倍
+     * @throws std::system_error 创建或映射失败
+     */
+    explicit IoUring(unsigned entries = 256);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * @brief 取一个已清零的SQE
+     * 提交队列满时先提交已有的SQE，直到内核取走SQE腾出槽位才返回
+     * @throws std::system_error 提交遇到无法恢复的错误
+     */
+    io_uring_sqe* get_sqe();
+
+    // 保证接下来count次get_sqe不会中途提交（链接的SQE必须在同一次提交里）
+    void reserve(unsigned count) {
+        make_room(count);
+    }
+
+    // 已填写但尚未提交给内核的SQE数
+    unsigned unsubmitted() const {
+        return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    // 提交所有SQE，不等待完成
+    int submit();
+
+    /**
+     * @brief 提交所有SQE并等待至少一个完成事件
+     * @param timeout_ms 最长等待时间，<0表示无限等待；CQ中已有完成事件时不等待
+     */
+    int submit_and_wait(int timeout_ms);
+
+    /**
+     * @brief 依次处理已完成的CQE
+     * 每个CQE先拷贝出来并归还槽位再调用回调，回调中可以继续get_sqe/submit
+     * @return 处理的CQE数
+     */
+    template<typename Handler>
+    unsigned drain_completions(Handler&& handler) {
+        unsigned count = 0;
+        // 先处理提交时为腾出CQ而暂存的完成事件，它们早于CQ中现有的
+        if (!reaped_.empty()) {
+            std::vector<io_uring_cqe> backlog;
+            backlog.swap(reaped_);
+            for (const io_uring_cqe& cqe : backlog) {
+                ++count;
+                handler(cqe);
+            }
+        }
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+            ++count;
+            handler(cqe);
+        }
+        completions_ += count;
+        return count;
+    }
+
+    // 注册/注销provided buffer ring（内核5.19+）
+    bool register_buffer_ring(io_uring_buf_ring* ring, unsigned entries, uint16_t group);
+    void unregister_buffer_ring(uint16_t group);
+
+    int fd() const { return ring_fd_; }
+
+    // 统计：io_uring_enter调用次数、提交的SQE数、处理的CQE数
+    struct Stats {
+        uint64_t enter_calls;
+        uint64_t submitted;
+        uint64_t completions;
+    };
+    Stats get_stats() const { return {enter_calls_, submitted_, completions_}; }
+
+private:
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size);
+    // 提交直到SQ至少有count个空槽；CQ溢出(EBUSY)或内核暂时无资源(EAGAIN)时先把CQE移到reaped_
+    void make_room(unsigned count);
+    unsigned reap_completions();
+
+    int ring_fd_{-1};
+    void* ring_ptr_{nullptr};
+    size_t ring_size_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_size_{0};
+
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    unsigned sqe_tail_{0};  // 本地已填写到的位置，submit时发布给内核
+
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+    std::vector<io_uring_cqe> reaped_;  // 已从CQ取出、等待drain_completions处理的完成事件
+
+    uint64_t enter_calls_{0};
+    uint64_t submitted_{0};
+    uint64_t completions_{0};
+};
+
+/**
+ * @brief provided buffer ring：recv时由内核从组里挑选缓冲区
+ * 收到的数据以IOBuf形式交给调用者，不复制；IOBuf释放时（任意线程）缓冲区归还，
+ * 由事件循环线程在replenish()时放回ring。事件循环先于IOBuf销毁时，内存在最后一个缓冲区归还后释放。
+ */
+class IoUringBufferRing {
+public:
+    /**
+     * @brief 创建并注册缓冲区组
+     * @return 内核不支持provided buffer ring时返回nullptr
+     */
+    static IoUringBufferRing* create(IoUring& ring, uint16_t group, unsigned count, size_t buffer_size);
+
+    uint16_t group() const { return group_; }
+    size_t buffer_size() const { return buffer_size_; }
+
+    // 把内核选中的缓冲区包装成IOBuf交给调用者
+    IOBuf adopt(uint16_t bid, size_t length);
+
+    // 直接放回ring（事件循环线程，缓冲区未交出时使用）
+    void recycle(uint16_t bid);
+
+    // 把其他地方归还的缓冲区放回ring（事件循环线程）
+    void replenish();
+
+    // 所属io_uring即将销毁：注销缓冲区组，内存在所有缓冲区归还后释放
+    void retire(IoUring& ring);
+
+private:
+    IoUringBufferRing(uint16_t group, unsigned count, size_t buffer_size);
+    ~IoUringBufferRing();
+
+    static void release(void* context, void* data);
+    void push(uint16_t bid);
+
+    uint16_t group_;
+    unsigned count_;
+    size_t buffer_size_;
+    io_uring_buf_ring* ring_{nullptr};
+    size_t ring_bytes_{0};
+    std::byte* buffers_{nullptr};
+    size_t buffer_bytes_{0};
+    uint16_t tail_{0};
+
+    std::mutex returned_mutex_;
+    std::vector<uint16_t> returned_;
+    std::atomic<bool> has_returned_{false};
+    size_t outstanding_{0};  // 受returned_mutex_保护
+    bool retired_{false};
+};
+
+} // namespace flowcoro::net
@@ -1,228 +1,864 @@
 #pragma once
 #include <atomic>
+#include <algorithm>
 #include <memory>
+#include <span>
 #include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
 
 namespace lockfree {
 
-// 无锁队列实现 (简化版本，更安全)
+// ==========================================
+// 基于纪元的安全内存回收 (Epoch-Based Reclamation)
+// ==========================================
+// 访问共享节点的线程先进入临界区(EpochGuard)，被摘除的节点通过retire()登记，
+// 只有当所有处于临界区的线程都越过了节点被摘除时的纪元后才真正回收，
+// 从而消除了use-after-free和ABA问题。
+class EpochManager {
+public:
+    using Deleter = void (*)(void*);
+
+    static EpochManager& instance() {
+        // 有意不析构：线程退出和静态析构的顺序不确定，回收器必须比所有线程活得更久
+        static EpochManager* manager = new EpochManager();
+        return *manager;
+    }
+
+    // 进入临界区（可嵌套）
+    void enter() {
+        ThreadRecord* rec = local_record();
+        if (rec->nesting++ == 0) {
+            uint64_t epoch = global_epoch_.load(std::memory_order_relaxed);
+            rec->epoch.store((epoch << 1) | 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    // 离开临界区
+    void leave() {
+        ThreadRecord* rec = tls_record_;
+        if (--rec->nesting == 0) {
+            rec->epoch.store(0, std::memory_order_release);
+            if (tls_exited_) {
+                // 线程已进入退出流程，不再持有记录
+                tls_record_ = nullptr;
+                release_record(rec);
+            }
+        }
+    }
+
+    // 登记一个已从数据结构中摘除的节点，待安全时调用deleter回收
+    void retire(void* ptr, Deleter deleter) {
+        ThreadRecord* rec = local_record();
+        uint64_t epoch = global_epoch_.load(std::memory_order_acquire);
+        LimboBag& bag = rec->limbo[epoch % EPOCH_SLOTS];
+        if (bag.epoch != epoch) {
+            // 同一槽位中的旧节点来自epoch-3或更早，必然已可回收
+            free_bag(bag);
+            bag.epoch = epoch;
+        }
+        bag.items.push_back({ptr, deleter});
+
+        if (++rec->retired_since_collect >= COLLECT_THRESHOLD) {
+            rec->retired_since_collect = 0;
+            collect(rec);
+        }
+    }
+
+    uint64_t current_epoch() const {
+        return global_epoch_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t EPOCH_SLOTS = 3;
+    static constexpr size_t COLLECT_THRESHOLD = 64;
+
+    struct Retired {
+        void* ptr;
+        Deleter deleter;
+    };
+
+    struct LimboBag {
+        uint64_t epoch = 0;
+        std::vector<Retired> items;  // clear()后保留容量，稳态下不再分配
+    };
+
+    struct alignas(64) ThreadRecord {
+        std::atomic<uint64_t> epoch{0};     // (纪元 << 1) | 活跃位
+        std::atomic<bool> in_use{true};
+        ThreadRecord* next = nullptr;       // 发布后不再修改
+        // 以下字段仅由持有者线程访问
+        size_t nesting = 0;
+        size_t retired_since_collect = 0;
+        LimboBag limbo[EPOCH_SLOTS];
+    };
+
+    struct OrphanItem {
+        Retired item;
+        uint64_t epoch;
+    };
+
+    // 线程退出时归还ThreadRecord
+    struct RecordReleaser {
+        ~RecordReleaser() {
+            tls_exited_ = true;
+            ThreadRecord* rec = tls_record_;
+            if (rec && rec->nesting == 0) {
+                tls_record_ = nullptr;
+                EpochManager::instance().release_record(rec);
+            }
+        }
+        void arm() {}
+    };
+
+    EpochManager() = default;
+
+    ThreadRecord* local_record() {
+        ThreadRecord* rec = tls_record_;
+        if (rec) {
+            return rec;
+        }
+        rec = acquire_record();
+        tls_record_ = rec;
+        if (!tls_exited_) {
+            tls_releaser_.arm();  // 首次使用时注册线程退出回调
+        }
+        return rec;
+    }
+
+    ThreadRecord* acquire_record() {
+        // 优先复用已退出线程留下的记录
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec; rec = rec->next) {
+            bool expected = false;
+            if (!rec->in_use.load(std::memory_order_relaxed) &&
+                rec->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                return rec;
+            }
+        }
+
+        auto* rec = new ThreadRecord();
+        ThreadRecord* head = records_.load(std::memory_order_relaxed);
+        do {
+            rec->next = head;
+        } while (!records_.compare_exchange_weak(head, rec, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        return rec;
+    }
+
+    void release_record(ThreadRecord* rec) {
+        {
+            // 未回收的节点转交给全局孤儿列表，由其他线程在安全后回收
+            std::lock_guard<std::mutex> lock(orphan_mutex_);
+            for (auto& bag : rec->limbo) {
+                for (const auto& item : bag.items) {
+                    orphans_.push_back({item, bag.epoch});
+                }
+                bag.items.clear();
+            }
+            orphan_count_.store(orphans_.size(), std::memory_order_release);
+        }
+        rec->retired_since_collect = 0;
+        rec->epoch.store(0, std::memory_order_release);
+        rec->in_use.store(false, std::memory_order_release);
+    }
+
+    // 所有活跃线程都观察到当前纪元时才推进全局纪元
+    bool try_advance() {
+        uint64_t epoch = global_epoch_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec; rec = rec->next) {
+            uint64_t local = rec->epoch.load(std::memory_order_relaxed);
+            if ((local & 1) && (local >> 1) != epoch) {
+                return false;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed);
+    }
+
+    void collect(ThreadRecord* rec) {
+        try_advance();
+        uint64_t epoch = global_epoch_.load(std::memory_order_acquire);
+        for (auto& bag : rec->limbo) {
+            if (!bag.items.empty() && bag.epoch + 2 <= epoch) {
+                free_bag(bag);
+            }
+        }
+        if (orphan_count_.load(std::memory_order_acquire) > 0) {
+            collect_orphans(epoch);
+        }
+    }
+
+    void collect_orphans(uint64_t epoch) {
+        std::unique_lock<std::mutex> lock(orphan_mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < orphans_.size(); ++i) {
+            if (orphans_[i].epoch + 2 <= epoch) {
+                orphans_[i].item.deleter(orphans_[i].item.ptr);
+            } else {
+                orphans_[kept++] = orphans_[i];
+            }
+        }
+        orphans_.resize(kept);
+        orphan_count_.store(kept, std::memory_order_release);
+    }
+
+    static void free_bag(LimboBag& bag) {
+        for (const auto& item : bag.items) {
+            item.deleter(item.ptr);
+        }
+        bag.items.clear();
+    }
+
+    alignas(64) std::atomic<uint64_t> global_epoch_{0};
+    alignas(64) std::atomic<ThreadRecord*> records_{nullptr};
+    alignas(64) std::atomic<size_t> orphan_count_{0};
+    std::mutex orphan_mutex_;
+    std::vector<OrphanItem> orphans_;
+
+    static inline thread_local ThreadRecord* tls_record_ = nullptr;
+    static inline thread_local bool tls_exited_ = false;
+    static inline thread_local RecordReleaser tls_releaser_;
+};
+
+// RAII临界区守卫
+class EpochGuard {
+public:
+    EpochGuard() { EpochManager::instance().enter(); }
+    ~EpochGuard() { EpochManager::instance().leave(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// 定长节点回收池：线程本地空闲链表 + 全局批量中转
+// 按(大小, 对齐)共享，同尺寸节点的Queue/Stack复用同一个池，稳态下不再调用new/delete
+template<size_t NodeSize, size_t NodeAlign>
+class NodeRecycler {
+public:
+    static void* allocate() {
+        LocalCache& cache = local_cache();
+        if (cache.head == nullptr) {
+            refill(cache);
+        }
+        if (FreeNode* node = cache.head) {
+            cache.head = node->next;
+            --cache.count;
+            return node;
+        }
+        return ::operator new(BLOCK_SIZE, std::align_val_t{BLOCK_ALIGN});
+    }
+
+    static void deallocate(void* ptr) {
+        auto* node = static_cast<FreeNode*>(ptr);
+        LocalCache& cache = local_cache();
+        if (cache.exited) {
+            // 线程退出流程中，直接归还全局池
+            Global& global = global_pool();
+            std::lock_guard<std::mutex> lock(global.mutex);
+            node->next = nullptr;
+            global.batches.push_back({node, 1});
+            return;
+        }
+
+        node->next = cache.head;
+        cache.head = node;
+        if (++cache.count >= LOCAL_LIMIT) {
+            flush(cache, BATCH_SIZE);
+        }
+    }
+
+private:
+    static constexpr size_t BATCH_SIZE = 64;
+    static constexpr size_t LOCAL_LIMIT = BATCH_SIZE * 2;
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static constexpr size_t BLOCK_ALIGN =
+        NodeAlign > alignof(FreeNode) ? NodeAlign : alignof(FreeNode);
+    static constexpr size_t BLOCK_SIZE =
+        ((NodeSize > sizeof(FreeNode) ? NodeSize : sizeof(FreeNode)) + BLOCK_ALIGN - 1) &
+        ~(BLOCK_ALIGN - 1);
+
+    struct LocalCache {
+        FreeNode* head;
+        size_t count;
+        bool armed;
+        bool exited;
+    };
+
+    struct Batch {
+        FreeNode* head;
+        size_t count;
+    };
+
+    struct Global {
+        std::mutex mutex;
+        std::vector<Batch> batches;
+    };
+
+    struct CacheFlusher {
+        ~CacheFlusher() {
+            LocalCache& cache = tls_cache_;
+            flush(cache, cache.count);
+            cache.exited = true;
+        }
+        void arm() {}
+    };
+
+    static Global& global_pool() {
+        // 与EpochManager相同，全局池不析构，保证退出期间的回收仍然有效
+        static Global* global = new Global();
+        return *global;
+    }
+
+    static LocalCache& local_cache() {
+        LocalCache& cache = tls_cache_;
+        if (!cache.armed) {
+            cache.armed = true;
+            tls_flusher_.arm();  // 首次使用时注册线程退出回调
+        }
+        return cache;
+    }
+
+    static void refill(LocalCache& cache) {
+        Global& global = global_pool();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        if (global.batches.empty()) {
+            return;
+        }
+        Batch batch = global.batches.back();
+        global.batches.pop_back();
+        cache.head = batch.head;
+        cache.count = batch.count;
+    }
+
+    // 将本地缓存中的count个节点作为一批转移到全局池
+    static void flush(LocalCache& cache, size_t count) {
+        if (count == 0 || cache.head == nullptr) {
+            return;
+        }
+        FreeNode* head = cache.head;
+        FreeNode* last = head;
+        size_t moved = 1;
+        while (moved < count && last->next) {
+            last = last->next;
+            ++moved;
+        }
+        cache.head = last->next;
+        cache.count -= moved;
+        last->next = nullptr;
+
+        Global& global = global_pool();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        global.batches.push_back({head, moved});
+    }
+
+    static inline thread_local LocalCache tls_cache_{nullptr, 0, false, false};
+    static inline thread_local CacheFlusher tls_flusher_;
+};
+
+// 无锁队列实现 (MPMC，入队wait-free，出队基于CAS + 纪元回收)
 template<typename T>
 class Queue {
 private:
     struct Node {
-        std::atomic<T*> data{nullptr};
         std::atomic<Node*> next{nullptr};
-        
-        Node() = default;
-        ~Node() {
-            T* data_ptr = data.load();
-            if (data_ptr) {
-                delete data_ptr;
-            }
-        }
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
     };
-    
+
+    using NodeAllocator = NodeRecycler<sizeof(Node), alignof(Node)>;
+
     alignas(64) std::atomic<Node*> head;
     alignas(64) std::atomic<Node*> tail;
     alignas(64) std::atomic<bool> destroyed{false}; // 添加析构标志
-    
+
+    static Node* create_node() {
+        return new (NodeAllocator::allocate()) Node();
+    }
+
+    // 节点的值在出队时已经析构，这里只归还内存
+    static void reclaim_node(void* ptr) {
+        auto* node = static_cast<Node*>(ptr);
+        node->~Node();
+        NodeAllocator::deallocate(node);
+    }
+
 public:
     Queue() {
-        Node* dummy = new Node;
+        Node* dummy = create_node();
         head.store(dummy);
         tail.store(dummy);
         destroyed.store(false);
     }
-    
+
     ~Queue() {
         // 设置析构标志
         destroyed.store(true, std::memory_order_release);
-        
-        // 先清理所有数据，避免析构时访问无效内存
-        T unused_item;
-        while (dequeue_unsafe(unused_item)) {
-            // 清空队列
-        }
-        
-        // 然后清理节点链表
-        Node* current = head.load();
-        while (current) {
-            Node* next = current->next.load();
-            delete current;
+
+        // 析构时不再有并发访问：head是哑节点，其后的节点都持有未取走的数据
+        Node* current = head.load(std::memory_order_acquire);
+        Node* next = current->next.load(std::memory_order_acquire);
+        reclaim_node(current);
+        while (next) {
             current = next;
+            next = current->next.load(std::memory_order_acquire);
+            current->value()->~T();
+            reclaim_node(current);
         }
     }
-    
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
     void enqueue(T item) {
         if (destroyed.load(std::memory_order_acquire)) {
             return; // 队列已析构，丢弃任务
         }
-        
-        Node* new_node = new Node;
-        T* data_ptr = new T(std::move(item));
-        new_node->data.store(data_ptr);
-        
-        Node* prev_tail = tail.exchange(new_node);
-        if (prev_tail) {
-            prev_tail->next.store(new_node);
-        }
+
+        Node* new_node = create_node();
+        new (new_node->storage) T(std::move(item));
+
+        // prev_tail在链接完成前next为空，消费者无法越过它，因此不会被回收
+        Node* prev_tail = tail.exchange(new_node, std::memory_order_acq_rel);
+        prev_tail->next.store(new_node, std::memory_order_release);
     }
-    
+
     bool dequeue(T& result) {
         if (destroyed.load(std::memory_order_acquire)) {
             return false; // 队列已析构
         }
-        
-        return dequeue_unsafe(result);
-    }
-    
-private:
-    bool dequeue_unsafe(T& result) {
-        Node* head_node = head.load();
-        if (!head_node) {
-            return false; // 队列已被析构
-        }
-        
-        Node* next = head_node->next.load();
-        if (next == nullptr) {
-            return false; // 队列为空
-        }
-        
-        T* data_ptr = next->data.exchange(nullptr);
-        if (data_ptr == nullptr) {
-            return false; // 数据已被其他线程取走
-        }
-        
-        result = *data_ptr;
-        delete data_ptr;
-        
-        // 尝试更新head，如果失败也不要紧，下次调用会重试
-        Node* expected = head_node;
-        if (head.compare_exchange_weak(expected, next)) {
-            delete head_node;
-        }
-        
-        return true;
+
+        EpochGuard guard;
+        Node* head_node = head.load(std::memory_order_acquire);
+        while (true) {
+            Node* next = head_node->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return false; // 队列为空
+            }
+
+            if (head.compare_exchange_weak(head_node, next, std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+                // CAS成功后next成为新的哑节点，其数据只归当前线程所有
+                T* value = next->value();
+                result = std::move(*value);
+                value->~T();
+                EpochManager::instance().retire(head_node, &Queue::reclaim_node);
+                return true;
+            }
+        }
     }
-    
-public:
-    
+
     bool empty() const {
-        Node* head_node = head.load();
-        return head_node->next.load() == nullptr;
+        EpochGuard guard;
+        Node* head_node = head.load(std::memory_order_acquire);
+        return head_node->next.load(std::memory_order_acquire) == nullptr;
     }
 };
 
-// 无锁栈实现 (Treiber Stack)
+// 无锁栈实现 (Treiber Stack，纪元回收避免ABA和use-after-free)
 template<typename T>
 class Stack {
 private:
     struct Node {
-        T data;
-        Node* next;
-        
-        Node(T&& item) : data(std::move(item)), next(nullptr) {}
+        Node* next = nullptr;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
     };
-    
+
+    using NodeAllocator = NodeRecycler<sizeof(Node), alignof(Node)>;
+
     alignas(64) std::atomic<Node*> head{nullptr};
-    
+
+    static void reclaim_node(void* ptr) {
+        auto* node = static_cast<Node*>(ptr);
+        node->~Node();
+        NodeAllocator::deallocate(node);
+    }
+
 public:
+    Stack() = default;
+
     ~Stack() {
-        while (Node* old_head = head.load()) {
-            head.store(old_head->next);
-            delete old_head;
+        Node* current = head.load(std::memory_order_acquire);
+        while (current) {
+            Node* next = current->next;
+            current->value()->~T();
+            reclaim_node(current);
+            current = next;
         }
     }
-    
+
+    Stack(const Stack&) = delete;
+    Stack& operator=(const Stack&) = delete;
+
     void push(T item) {
-        Node* new_node = new Node(std::move(item));
-        new_node->next = head.load();
-        
-        while (!head.compare_exchange_weak(new_node->next, new_node)) {
+        Node* new_node = new (NodeAllocator::allocate()) Node();
+        new (new_node->storage) T(std::move(item));
+        new_node->next = head.load(std::memory_order_relaxed);
+
+        while (!head.compare_exchange_weak(new_node->next, new_node, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
             // 重试
         }
     }
-    
+
     bool pop(T& result) {
-        Node* old_head = head.load();
-        
-        while (old_head && !head.compare_exchange_weak(old_head, old_head->next)) {
+        EpochGuard guard;
+        Node* old_head = head.load(std::memory_order_acquire);
+
+        // 临界区内old_head不会被回收复用，读取next安全且不存在ABA
+        while (old_head && !head.compare_exchange_weak(old_head, old_head->next,
+                                                       std::memory_order_acq_rel,
+                                                       std::memory_order_acquire)) {
             // 重试
         }
-        
+
         if (old_head) {
-            result = std::move(old_head->data);
-            delete old_head;
+            T* value = old_head->value();
+            result = std::move(*value);
+            value->~T();
+            EpochManager::instance().retire(old_head, &Stack::reclaim_node);
             return true;
         }
-        
+
         return false;
     }
-    
+
     bool empty() const {
-        return head.load() == nullptr;
+        return head.load(std::memory_order_acquire) == nullptr;
     }
 };
 
 // 无锁环形缓冲区 (SPSC Ring Buffer)
+// 槽位直接存放T（无逐元素atomic/填充），读写索引位于不同缓存行，
+// 双方各自缓存对端索引，只有在看起来满/空时才去读取对端的原子变量。
+// reserve/commit和peek/release支持原地写入与零拷贝读取。
 template<typename T, size_t Size>
 class RingBuffer {
 private:
     static_assert((Size & (Size - 1)) == 0, "Size must be power of 2");
+    static_assert(std::is_default_constructible_v<T>, "T must be default constructible");
     static constexpr size_t MASK = Size - 1;
-    
-    struct alignas(64) Slot {
-        std::atomic<T> data{};
-        std::atomic<bool> valid{false};
-    };
-    
+
+    // 消费者侧
     alignas(64) std::atomic<size_t> head{0};
+    size_t cached_tail_{0};
+
+    // 生产者侧
     alignas(64) std::atomic<size_t> tail{0};
-    alignas(64) Slot slots[Size];
-    
+    size_t cached_head_{0};
+
+    alignas(64) std::unique_ptr<T[]> slots;
+
 public:
+    RingBuffer() : slots(new T[Size]()) {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // ---------------- 生产者接口 ----------------
+
     bool push(T item) {
         size_t current_tail = tail.load(std::memory_order_relaxed);
-        size_t next_tail = (current_tail + 1) & MASK;
-        
-        if (next_tail == head.load(std::memory_order_acquire)) {
-            return false; // 缓冲区满
-        }
-        
-        slots[current_tail].data.store(std::move(item), std::memory_order_relaxed);
-        slots[current_tail].valid.store(true, std::memory_order_release);
-        tail.store(next_tail, std::memory_order_release);
-        
+        if (current_tail - cached_head_ == Size) {
+            cached_head_ = head.load(std::memory_order_acquire);
+            if (current_tail - cached_head_ == Size) {
+                return false; // 缓冲区满
+            }
+        }
+
+        slots[current_tail & MASK] = std::move(item);
+        tail.store(current_tail + 1, std::memory_order_release);
         return true;
     }
-    
+
+    size_t push_batch(const T* items, size_t count) {
+        std::span<T> region = reserve(count);
+        size_t pushed = region.size();
+        std::copy_n(items, pushed, region.begin());
+        commit(pushed);
+        // 尾部回绕时再写一段
+        if (pushed < count) {
+            region = reserve(count - pushed);
+            std::copy_n(items + pushed, region.size(), region.begin());
+            commit(region.size());
+            pushed += region.size();
+        }
+        return pushed;
+    }
+
+    // 预留最多n个连续可写槽位（回绕处可能少于n），写完后调用commit发布
+    std::span<T> reserve(size_t n) {
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t free_slots = Size - (current_tail - cached_head_);
+        if (free_slots < n) {
+            cached_head_ = head.load(std::memory_order_acquire);
+            free_slots = Size - (current_tail - cached_head_);
+        }
+        size_t offset = current_tail & MASK;
+        size_t contiguous = std::min({n, free_slots, Size - offset});
+        return {slots.get() + offset, contiguous};
+    }
+
+    // 发布最近一次reserve中已写入的前n个槽位
+    void commit(size_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // ---------------- 消费者接口 ----------------
+
     bool pop(T& result) {
         size_t current_head = head.load(std::memory_order_relaxed);
-        
-        if (current_head == tail.load(std::memory_order_acquire)) {
-            return false; // 缓冲区空
-        }
-        
-        if (!slots[current_head].valid.load(std::memory_order_acquire)) {
-            return false;
-        }
-        
-        result = std::move(slots[current_head].data.load(std::memory_order_relaxed));
-        slots[current_head].valid.store(false, std::memory_order_release);
-        head.store((current_head + 1) & MASK, std::memory_order_release);
-        
+        if (current_head == cached_tail_) {
+            cached_tail_ = tail.load(std::memory_order_acquire);
+            if (current_head == cached_tail_) {
+                return false; // 缓冲区空
+            }
+        }
+
+        result = std::move(slots[current_head & MASK]);
+        head.store(current_head + 1, std::memory_order_release);
         return true;
     }
-    
+
+    size_t pop_batch(T* items, size_t count) {
+        size_t popped = 0;
+        while (popped < count) {
+            std::span<T> region = peek(count - popped);
+            if (region.empty()) {
+                break;
+            }
+            std::move(region.begin(), region.end(), items + popped);
+            release(region.size());
+            popped += region.size();
+        }
+        return popped;
+    }
+
+    // 查看最多n个连续可读元素（回绕处可能少于n），处理完后调用release归还
+    std::span<T> peek(size_t n) {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        size_t available = cached_tail_ - current_head;
+        if (available < n) {
+            cached_tail_ = tail.load(std::memory_order_acquire);
+            available = cached_tail_ - current_head;
+        }
+        size_t offset = current_head & MASK;
+        size_t contiguous = std::min({n, available, Size - offset});
+        return {slots.get() + offset, contiguous};
+    }
+
+    // 归还最近一次peek中已处理的前n个元素
+    void release(size_t n) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // ---------------- 状态查询 ----------------
+
     bool empty() const {
         return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
     }
-    
+
     bool full() const {
-        size_t current_tail = tail.load(std::memory_order_acquire);
-        size_t next_tail = (current_tail + 1) & MASK;
-        return next_tail == head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire) == Size;
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
     }
+
+    static constexpr size_t capacity() { return Size; }
+};
+
+// 有界MPMC队列 (Vyukov)
+// 每个槽位携带序列号，生产者/消费者各自通过一次CAS领取位置，无需额外分配；
+// 槽位直接存放T，只要求T可移动
+template<typename T, size_t Capacity>
+class BoundedQueue {
+private:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be power of 2");
+    static_assert(std::is_move_constructible_v<T> && std::is_move_assignable_v<T>,
+                  "T must be movable");
+    static constexpr size_t MASK = Capacity - 1;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    alignas(64) std::unique_ptr<Slot[]> slots_;
+
+public:
+    BoundedQueue() : slots_(new Slot[Capacity]) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedQueue() {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+        for (; pos != end; ++pos) {
+            slots_[pos & MASK].value()->~T();
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[pos & MASK];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列满
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (slot->storage) T(std::forward<Args>(args)...);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& item) { return try_emplace(item); }
+    bool try_push(T&& item) { return try_emplace(std::move(item)); }
+
+    bool try_pop(T& result) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[pos & MASK];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列空
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* value = slot->value();
+        result = std::move(*value);
+        value->~T();
+        slot->sequence.store(pos + Capacity, std::memory_order_release);
+        return true;
+    }
+
+    // 批量入队：一次CAS领取连续的空闲槽位，返回实际入队数量（元素被移走）
+    size_t try_push_bulk(T* items, size_t count) {
+        if (count == 0) return 0;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t claimed;
+        while (true) {
+            claimed = 0;
+            while (claimed < count && claimed < Capacity) {
+                size_t seq = slots_[(pos + claimed) & MASK].sequence.load(std::memory_order_acquire);
+                if (seq != pos + claimed) {
+                    break;
+                }
+                ++claimed;
+            }
+            if (claimed == 0) {
+                size_t seq = slots_[pos & MASK].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) {
+                    return 0; // 队列满
+                }
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < claimed; ++i) {
+            Slot& slot = slots_[(pos + i) & MASK];
+            new (slot.storage) T(std::move(items[i]));
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    // 批量出队：一次CAS领取连续的就绪槽位，返回实际出队数量
+    size_t try_pop_bulk(T* out, size_t max_count) {
+        if (max_count == 0) return 0;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t claimed;
+        while (true) {
+            claimed = 0;
+            while (claimed < max_count && claimed < Capacity) {
+                size_t seq = slots_[(pos + claimed) & MASK].sequence.load(std::memory_order_acquire);
+                if (seq != pos + claimed + 1) {
+                    break;
+                }
+                ++claimed;
+            }
+            if (claimed == 0) {
+                size_t seq = slots_[pos & MASK].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+                    return 0; // 队列空
+                }
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < claimed; ++i) {
+            Slot& slot = slots_[(pos + i) & MASK];
+            T* value = slot.value();
+            out[i] = std::move(*value);
+            value->~T();
+            slot.sequence.store(pos + i + Capacity, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    // 近似大小（并发下仅供参考）
+    size_t size_approx() const {
+        size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+        size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    bool empty() const { return size_approx() == 0; }
+
+    static constexpr size_t capacity() { return Capacity; }
 };
 
 // 高性能原子计数器
@@ -1,22 +1,25 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <bit>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
-#include <fstream>
-#include <sstream>
-#include <queue>
+#include <vector>
 #include <array>
-#include <iostream>
 #include <cstring>
+#include <cstdint>
 #include <cstdio>
-#include "lockfree.h"
+#include <cstdlib>
+#include <type_traits>
 
 namespace flowcoro {
 
+class StringBuffer;
+
 // 日志级别枚举
 enum class LogLevel : int {
     TRACE = 0,
@@ -34,357 +37,704 @@ enum class LogOutput : int {
     BOTH = 2        // 同时输出到控制台和文件
 };
 
-// 日志条目结构 - 缓存友好设计
-struct LogEntry {
-    std::chrono::system_clock::time_point timestamp;
+inline constexpr size_t LOG_LEVEL_COUNT = 6;
+
+// 线程缓冲区写满（或超出本级别份额）时的处理策略
+enum class LogOverflowPolicy : int {
+    DROP = 0,    // 丢弃并计数
+    BLOCK = 1,   // 唤醒写入线程并等待空间，最长等待1秒
+    SAMPLE = 2   // 超出份额后每sample_every条保留1条，可以使用整个缓冲区
+};
+
+// 每个级别的缓冲策略
+struct LogLevelPolicy {
+    double max_fill;             // 本级别可以占用的线程缓冲区比例 (0, 1]
+    LogOverflowPolicy overflow;
+    uint32_t sample_every;       // 仅SAMPLE使用
+};
+
+// 日志文件落盘策略
+enum class LogFsyncPolicy : int {
+    NEVER = 0,     // 只写入页缓存，由内核回写
+    INTERVAL = 1,  // 写出后距上次同步超过fsync_interval时fdatasync
+    ALWAYS = 2     // 每次写出后fdatasync
+};
+
+// 日志文件的缓冲、轮转与同步策略
+struct LogFilePolicy {
+    size_t buffer_size = 1024 * 1024;                      // 缓冲数据达到该大小即写出
+    std::chrono::milliseconds flush_interval{50};          // 缓冲数据最长停留时间
+    size_t rotate_bytes = 0;                               // 文件超过该大小时轮转，0表示不按大小轮转
+    std::chrono::seconds rotate_interval{0};               // 文件打开超过该时长时轮转，0表示不按时间轮转
+    size_t max_files = 5;                                  // 保留的历史文件数：path.1 ... path.N
+    LogFsyncPolicy fsync = LogFsyncPolicy::NEVER;
+    std::chrono::milliseconds fsync_interval{1000};
+};
+
+// 日志文件统计
+struct LogFileStats {
+    uint64_t bytes_written;
+    uint64_t write_calls;   // writev系统调用次数
+    uint64_t rotations;
+    uint64_t syncs;
+    uint64_t errors;        // 写入失败次数，失败的数据被丢弃
+};
+
+// 日志调用点：由LOG_*宏生成的静态常量，其地址即格式串ID
+// 调用线程只记录调用点指针和参数的原始字节，格式化由后台线程完成
+struct LogSite {
     LogLevel level;
-    std::thread::id thread_id;
-    char message[128];  // 减小大小
-    char file[32];      // 减小大小
+    const char* file;
     int line;
-    
-    LogEntry() = default;
-    
-    LogEntry(LogLevel lvl, const char* msg, const char* filename, int ln) 
-        : timestamp(std::chrono::system_clock::now())
-        , level(lvl)
-        , thread_id(std::this_thread::get_id())
-        , line(ln) {
-        
-        // 安全拷贝消息
-        strncpy(message, msg, sizeof(message) - 1);
-        message[sizeof(message) - 1] = '\0';
-        
-        // 提取文件名（去掉路径）
-        const char* basename = strrchr(filename, '/');
-        basename = basename ? basename + 1 : filename;
-        strncpy(file, basename, sizeof(file) - 1);
-        file[sizeof(file) - 1] = '\0';
+    const char* format;
+};
+
+// 参数在记录中的编码类型
+enum class LogArgType : uint8_t {
+    INT,          // int64_t
+    UINT,         // uint64_t
+    DOUBLE,       // double
+    LONG_DOUBLE,  // long double
+    POINTER,      // const void*
+    STRING        // uint32_t长度 + 字节 + '\0'
+};
+
+// 环形缓冲区中的一条记录，参数字节紧随其后，整条记录按8字节对齐
+struct LogRecordHeader {
+    uint32_t size;        // 含头部的总字节数，0表示回绕标记
+    uint32_t arg_count;
+    int64_t timestamp_ns; // system_clock纳秒
+    const LogSite* site;
+    const LogArgType* arg_types;
+
+    const std::byte* args() const {
+        return reinterpret_cast<const std::byte*>(this + 1);
     }
 };
 
-// 高性能无锁日志器
-class Logger {
+namespace detail {
+
+template<typename T>
+using log_arg_t = std::remove_cvref_t<std::decay_t<T>>;
+
+template<typename T>
+constexpr LogArgType log_arg_type() {
+    using U = log_arg_t<T>;
+    if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, const char*> ||
+                  std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+        return LogArgType::STRING;
+    } else if constexpr (std::is_same_v<U, bool> || std::is_enum_v<U>) {
+        return LogArgType::INT;
+    } else if constexpr (std::is_integral_v<U>) {
+        return std::is_signed_v<U> ? LogArgType::INT : LogArgType::UINT;
+    } else if constexpr (std::is_same_v<U, long double>) {
+        return LogArgType::LONG_DOUBLE;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return LogArgType::DOUBLE;
+    } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+        return LogArgType::POINTER;
+    } else {
+        static_assert(sizeof(U) == 0, "unsupported log argument type");
+    }
+}
+
+template<typename... Args>
+struct LogArgTypes {
+    static constexpr std::array<LogArgType, sizeof...(Args)> value{log_arg_type<Args>()...};
+};
+
+// 单个字符串参数的上限，超出部分替换为截断标记，不会静默丢失
+inline constexpr size_t MAX_LOG_STRING = 16 * 1024;
+inline constexpr std::string_view LOG_TRUNCATED_MARK = "...<truncated>";
+
+template<typename T>
+std::string_view log_string_view(const T& value) {
+    using U = log_arg_t<T>;
+    if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view> ||
+                  std::is_array_v<T>) {
+        return std::string_view(value);
+    } else {
+        return value ? std::string_view(value) : std::string_view("(null)");
+    }
+}
+
+template<typename T>
+size_t log_arg_size(const T& value) {
+    if constexpr (log_arg_type<T>() == LogArgType::STRING) {
+        size_t len = log_string_view(value).size();
+        if (len > MAX_LOG_STRING) len = MAX_LOG_STRING + LOG_TRUNCATED_MARK.size();
+        return sizeof(uint32_t) + len + 1;
+    } else if constexpr (log_arg_type<T>() == LogArgType::LONG_DOUBLE) {
+        return sizeof(long double);
+    } else {
+        return 8;
+    }
+}
+
+template<typename T>
+void encode_log_arg(std::byte*& out, const T& value) {
+    constexpr LogArgType type = log_arg_type<T>();
+    if constexpr (type == LogArgType::STRING) {
+        std::string_view str = log_string_view(value);
+        bool truncated = str.size() > MAX_LOG_STRING;
+        uint32_t len = static_cast<uint32_t>(truncated ? MAX_LOG_STRING + LOG_TRUNCATED_MARK.size() : str.size());
+        std::memcpy(out, &len, sizeof(len));
+        out += sizeof(len);
+        if (truncated) {
+            std::memcpy(out, str.data(), MAX_LOG_STRING);
+            std::memcpy(out + MAX_LOG_STRING, LOG_TRUNCATED_MARK.data(), LOG_TRUNCATED_MARK.size());
+        } else {
+            std::memcpy(out, str.data(), len);
+        }
+        out += len;
+        *out++ = std::byte{0};
+    } else if constexpr (type == LogArgType::INT) {
+        int64_t v = static_cast<int64_t>(value);
+        std::memcpy(out, &v, sizeof(v));
+        out += sizeof(v);
+    } else if constexpr (type == LogArgType::UINT) {
+        uint64_t v = static_cast<uint64_t>(value);
+        std::memcpy(out, &v, sizeof(v));
+        out += sizeof(v);
+    } else if constexpr (type == LogArgType::DOUBLE) {
+        double v = static_cast<double>(value);
+        std::memcpy(out, &v, sizeof(v));
+        out += sizeof(v);
+    } else if constexpr (type == LogArgType::LONG_DOUBLE) {
+        std::memcpy(out, &value, sizeof(long double));
+        out += sizeof(long double);
+    } else {
+        const void* v = static_cast<const void*>(value);
+        std::memcpy(out, &v, sizeof(v));
+        out += sizeof(v);
+    }
+}
+
+// 仅用于编译期检查格式串，从不执行
+__attribute__((format(printf, 1, 2)))
+inline void check_log_format(const char*, ...) {}
+
+} // namespace detail
+
+// 单生产者单消费者的变长记录环形缓冲区
+// 每个线程一个，生产者是所属线程，消费者是日志写入线程
+class LogStagingBuffer {
+public:
+    LogStagingBuffer(size_t capacity, size_t thread_hash)
+        : storage_(new uint64_t[capacity / sizeof(uint64_t)]),
+          capacity_(capacity),
+          mask_(capacity - 1),
+          thread_hash_(thread_hash) {}
+
+    LogStagingBuffer(const LogStagingBuffer&) = delete;
+    LogStagingBuffer& operator=(const LogStagingBuffer&) = delete;
+
+    // 生产者：预留n字节连续空间（8的倍数），使用量将超过limit字节时返回nullptr
+    std::byte* reserve(size_t n, size_t limit = SIZE_MAX) {
+        limit = std::min(limit, capacity_);
+        size_t pos = write_pos_.load(std::memory_order_relaxed);
+        size_t offset = pos & mask_;
+        size_t padding = offset + n > capacity_ ? capacity_ - offset : 0;
+        if (pos + padding + n - cached_read_pos_ > limit) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+            if (pos + padding + n - cached_read_pos_ > limit) {
+                return nullptr;
+            }
+        }
+        if (padding > 0) {
+            // 尾部放不下，写入回绕标记，记录从头开始
+            uint32_t marker = 0;
+            std::memcpy(data() + offset, &marker, sizeof(marker));
+        }
+        pending_padding_ = padding;
+        return data() + ((pos + padding) & mask_);
+    }
+
+    void commit(size_t n) {
+        size_t pos = write_pos_.load(std::memory_order_relaxed);
+        records_.store(records_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        write_pos_.store(pos + pending_padding_ + n, std::memory_order_release);
+    }
+
+    // 累计写入的记录数，只由生产者更新
+    uint64_t records() const {
+        return records_.load(std::memory_order_relaxed);
+    }
+
+    // 消费者：返回下一条记录，处理完后调用consume
+    const LogRecordHeader* peek() {
+        size_t pos = read_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            if (pos == cached_write_pos_) {
+                cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+                if (pos == cached_write_pos_) {
+                    return nullptr;
+                }
+            }
+            size_t offset = pos & mask_;
+            auto* header = reinterpret_cast<const LogRecordHeader*>(data() + offset);
+            if (header->size != 0) {
+                return header;
+            }
+            pos += capacity_ - offset;
+            read_pos_.store(pos, std::memory_order_release);
+        }
+    }
+
+    void consume(const LogRecordHeader* header) {
+        read_pos_.store(read_pos_.load(std::memory_order_relaxed) + header->size, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return read_pos_.load(std::memory_order_acquire) == write_pos_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t thread_hash() const { return thread_hash_; }
+
+    // 所属线程已退出，排空后由写入线程移除
+    std::atomic<bool> retired{false};
+
+    // 各级别溢出次数，用于SAMPLE策略，只由生产者访问
+    std::array<uint32_t, LOG_LEVEL_COUNT> overflow_counts{};
+
 private:
-    static constexpr size_t RING_BUFFER_SIZE = 4096;  // 必须是2的幂
-    static constexpr size_t BATCH_SIZE = 64;
-    
-    // 使用无锁环形缓冲区
-    lockfree::RingBuffer<LogEntry, RING_BUFFER_SIZE> log_buffer_;
-    
-    // 后台写入线程
-    std::unique_ptr<std::thread> writer_thread_;
-    std::atomic<bool> shutdown_{false};
-    
-    // 输出流
-    std::unique_ptr<std::ofstream> file_stream_;
-    std::atomic<LogLevel> min_level_{LogLevel::LOG_INFO};
-    std::atomic<LogOutput> output_type_{LogOutput::FILE};
-    std::string log_file_path_;
-    
-    // 性能统计
-    alignas(64) std::atomic<uint64_t> total_logs_{0};
-    alignas(64) std::atomic<uint64_t> dropped_logs_{0};
-    
+    std::byte* data() const { return reinterpret_cast<std::byte*>(storage_.get()); }
+
+    std::unique_ptr<uint64_t[]> storage_;
+    const size_t capacity_;
+    const size_t mask_;
+    const size_t thread_hash_;
+
+    alignas(64) std::atomic<size_t> write_pos_{0};
+    std::atomic<uint64_t> records_{0};
+    size_t cached_read_pos_ = 0;   // 生产者缓存的读位置
+    size_t pending_padding_ = 0;
+    alignas(64) std::atomic<size_t> read_pos_{0};
+    size_t cached_write_pos_ = 0;  // 消费者缓存的写位置
+};
+
+// 日志文件输出
+// 格式化后的行追加到按页对齐的64KiB块中，攒到buffer_size或超过flush_interval后
+// 用一次writev写出（O_APPEND）；轮转与文件切换都发生在两次写出之间，不会拆开一行。
+// 只由持有Logger::output_mutex_的线程访问，统计数据可以并发读取。
+class LogFileSink {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    LogFileSink() = default;
+    ~LogFileSink() { close(); }
+
+    LogFileSink(const LogFileSink&) = delete;
+    LogFileSink& operator=(const LogFileSink&) = delete;
+
+    // 以追加方式打开文件；已打开的文件先写出缓冲数据再关闭。失败时保留原文件
+    bool open(const std::string& path);
+    // 写出缓冲数据、按策略同步并关闭文件
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    void set_policy(const LogFilePolicy& policy) { policy_ = policy; }
+    const LogFilePolicy& policy() const { return policy_; }
+
+    // 追加数据；超过buffer_size时先写出已缓冲的数据
+    void append(const char* data, size_t size);
+    size_t pending_bytes() const { return pending_; }
+
+    // 缓冲数据已满或已超过flush_interval
+    bool should_write(std::chrono::steady_clock::time_point now) const;
+    // 写出全部缓冲数据，然后按策略同步和轮转
+    void write_out();
+    // 定时工作：到期的写出、同步和按时间轮转
+    void tick(std::chrono::steady_clock::time_point now);
+
+    LogFileStats stats() const;
+
+private:
+    struct ChunkDeleter {
+        void operator()(char* chunk) const { std::free(chunk); }
+    };
+    using Chunk = std::unique_ptr<char, ChunkDeleter>;
+
+    void sync(std::chrono::steady_clock::time_point now);
+    void maybe_rotate(std::chrono::steady_clock::time_point now);
+    void rotate(std::chrono::steady_clock::time_point now);
+    static int open_fd(const std::string& path);
+
+    int fd_ = -1;
+    std::string path_;
+    LogFilePolicy policy_;
+
+    // 缓冲块：前chunk_index_个已满，当前块已用chunk_used_字节
+    std::vector<Chunk> chunks_;
+    size_t chunk_index_ = 0;
+    size_t chunk_used_ = 0;
+    size_t pending_ = 0;
+    std::chrono::steady_clock::time_point first_pending_{};
+
+    uint64_t file_bytes_ = 0;
+    std::chrono::steady_clock::time_point opened_at_{};
+    std::chrono::steady_clock::time_point last_sync_{};
+    bool unsynced_ = false;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> write_calls_{0};
+    std::atomic<uint64_t> rotations_{0};
+    std::atomic<uint64_t> syncs_{0};
+    std::atomic<uint64_t> errors_{0};
+};
+
+// 二进制异步日志器
+// 调用线程只写入调用点ID、时间戳和参数原始字节（约20ns），不做格式化；
+// 后台线程按时间戳归并各线程缓冲区中的记录，按printf语义格式化后输出，消息不会被截断。
+// 写入线程空闲时阻塞在eventfd上，由记录日志的线程唤醒。
+// 每个级别可以配置能占用的缓冲区份额和溢出策略，默认TRACE/DEBUG/INFO/WARN分别只能用到
+// 50%/50%/75%/90%，ERROR/FATAL可以用满并在满时阻塞等待，突发的调试日志不会挤掉错误日志。
+class Logger {
 public:
-    Logger() = default;
-    
+    static constexpr size_t DEFAULT_THREAD_BUFFER_SIZE = 256 * 1024;  // 必须是2的幂
+
+    Logger();
+
     ~Logger() {
         shutdown();
     }
-    
+
     // 初始化日志器
-    bool initialize(const std::string& filename = "", LogLevel min_level = LogLevel::LOG_INFO, LogOutput output = LogOutput::FILE) {
-        min_level_.store(min_level, std::memory_order_release);
-        output_type_.store(output, std::memory_order_release);
-        log_file_path_ = filename;
-        
-        // 根据输出类型初始化文件流
-        if (output == LogOutput::FILE || output == LogOutput::BOTH) {
-            if (!filename.empty()) {
-                file_stream_ = std::make_unique<std::ofstream>(filename, std::ios::app);
-                if (!file_stream_->is_open()) {
-                    std::cerr << "Failed to open log file: " << filename << std::endl;
-                    return false;
-                }
-            } else if (output == LogOutput::FILE) {
-                // 如果要求文件输出但没有提供文件名，使用默认文件名
-                log_file_path_ = "flowcoro.log";
-                file_stream_ = std::make_unique<std::ofstream>(log_file_path_, std::ios::app);
-                if (!file_stream_->is_open()) {
-                    std::cerr << "Failed to open default log file: " << log_file_path_ << std::endl;
-                    return false;
-                }
-            }
+    bool initialize(const std::string& filename = "", LogLevel min_level = LogLevel::LOG_INFO, LogOutput output = LogOutput::FILE);
+
+    // 关闭日志器，输出所有已记录的日志
+    void shutdown();
+
+    // 记录日志
+    template<typename... Args>
+    void log(const LogSite& site, const Args&... args) {
+        if (site.level < min_level_.load(std::memory_order_relaxed)) {
+            return;
         }
-        
-        // 启动后台写入线程
-        writer_thread_ = std::make_unique<std::thread>([this] { writer_loop(); });
-        
-        return true;
-    }
-    
-    // 关闭日志器
-    void shutdown() {
-        if (shutdown_.exchange(true, std::memory_order_acq_rel)) {
-            return; // 已经关闭
+
+        size_t size = sizeof(LogRecordHeader);
+        ((size += detail::log_arg_size(args)), ...);
+        size = (size + 7) & ~size_t(7);
+
+        std::unique_lock<std::mutex> fallback_lock;
+        LogStagingBuffer* buffer = local_buffer(fallback_lock);
+        if (!buffer) {
+            count_dropped(site.level);
+            return;
         }
-        
-        if (writer_thread_ && writer_thread_->joinable()) {
-            writer_thread_->join();
+        auto level = static_cast<size_t>(site.level);
+        size_t limit = buffer->capacity() * fill_permille_[level].load(std::memory_order_relaxed) / 1000;
+        std::byte* out = buffer->reserve(size, limit);
+        if (!out && !(out = reserve_on_overflow(*buffer, site.level, size))) {
+            return;
         }
-        
-        if (file_stream_) {
-            file_stream_->close();
+
+        auto* header = reinterpret_cast<LogRecordHeader*>(out);
+        header->size = static_cast<uint32_t>(size);
+        header->arg_count = sizeof...(Args);
+        header->timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        header->site = &site;
+        header->arg_types = detail::LogArgTypes<Args...>::value.data();
+        out += sizeof(LogRecordHeader);
+        (detail::encode_log_arg(out, args), ...);
+
+        buffer->commit(size);
+        if (writer_sleeping_.load(std::memory_order_relaxed)) {
+            wake_writer();
         }
     }
-    
-    // 记录日志 - 高性能无锁版本
+
+    // 兼容旧接口：调用方自带格式串，格式化在调用线程完成
     template<typename... Args>
-    void log(LogLevel level, const char* file, int line, const char* format, Args&&... args) {
-        if (level < min_level_.load(std::memory_order_acquire)) {
+    void log(LogLevel level, const char* file, int line, const char* format, const Args&... args) {
+        if (level < min_level_.load(std::memory_order_relaxed)) {
             return;
         }
-        
-        // 格式化消息
-        std::array<char, 512> format_buffer;
-        if constexpr (sizeof...(args) > 0) {
-            std::snprintf(format_buffer.data(), format_buffer.size(), format, std::forward<Args>(args)...);
+        std::string message;
+        if constexpr (sizeof...(Args) > 0) {
+            int len = std::snprintf(nullptr, 0, format, args...);
+            if (len > 0) {
+                message.resize(static_cast<size_t>(len));
+                std::snprintf(message.data(), message.size() + 1, format, args...);
+            }
         } else {
-            // 没有参数时直接复制格式字符串
-            std::strncpy(format_buffer.data(), format, format_buffer.size() - 1);
-            format_buffer[format_buffer.size() - 1] = '\0';
-        }
-        
-        // 创建日志条目
-        LogEntry entry(level, format_buffer.data(), file, line);
-        
-        // 尝试写入环形缓冲区
-        if (!log_buffer_.push(std::move(entry))) {
-            dropped_logs_.fetch_add(1, std::memory_order_relaxed);
-            return;
+            message = format;
         }
-        
-        total_logs_.fetch_add(1, std::memory_order_relaxed);
+        log(dynamic_site(level), file, line, message);
     }
-    
+
+    bool should_log(LogLevel level) const {
+        return level >= min_level_.load(std::memory_order_relaxed);
+    }
+
+    // 等待调用前记录的日志全部输出
+    void flush();
+
     // 设置日志级别
     void set_level(LogLevel level) {
         min_level_.store(level, std::memory_order_release);
     }
-    
+
     // 设置输出类型
     void set_output(LogOutput output) {
         output_type_.store(output, std::memory_order_release);
     }
-    
-    // 设置日志文件路径（动态切换）
-    bool set_log_file(const std::string& filename) {
-        if (filename.empty()) {
-            return false;
-        }
-        
-        // 创建新的文件流
-        auto new_stream = std::make_unique<std::ofstream>(filename, std::ios::app);
-        if (!new_stream->is_open()) {
-            std::cerr << "Failed to open new log file: " << filename << std::endl;
-            return false;
-        }
-        
-        // 原子性地替换文件流
-        file_stream_ = std::move(new_stream);
-        log_file_path_ = filename;
-        
-        std::cout << "Log file switched to: " << filename << std::endl;
-        return true;
+
+    // 配置某个级别的缓冲份额与溢出策略
+    void set_level_policy(LogLevel level, LogLevelPolicy policy);
+    LogLevelPolicy level_policy(LogLevel level) const;
+
+    // 每个线程缓冲区的大小，只影响之后首次记录日志的线程
+    void set_thread_buffer_size(size_t bytes) {
+        thread_buffer_size_.store(std::bit_ceil(std::max<size_t>(bytes, 4096)), std::memory_order_relaxed);
     }
-    
+
+    // 设置日志文件路径（动态切换）：调用前记录的日志写入原文件，之后的写入新文件
+    bool set_log_file(const std::string& filename);
+
+    // 设置日志文件的缓冲、轮转与同步策略
+    void set_file_policy(const LogFilePolicy& policy);
+    LogFilePolicy file_policy() const;
+
     // 获取性能统计
     struct Stats {
         uint64_t total_logs;
         uint64_t dropped_logs;
         double drop_rate;
         std::string output_info;
+        std::array<uint64_t, LOG_LEVEL_COUNT> dropped_by_level;
+        LogFileStats file;
     };
-    
-    Stats get_stats() const {
-        uint64_t total = total_logs_.load(std::memory_order_acquire);
-        uint64_t dropped = dropped_logs_.load(std::memory_order_acquire);
-        double drop_rate = total > 0 ? (double)dropped / total * 100.0 : 0.0;
-        
-        std::string output_info;
-        LogOutput output = output_type_.load(std::memory_order_acquire);
-        switch (output) {
-            case LogOutput::CONSOLE:
-                output_info = "Console only";
-                break;
-            case LogOutput::FILE:
-                output_info = "File: " + log_file_path_;
-                break;
-            case LogOutput::BOTH:
-                output_info = "Console + File: " + log_file_path_;
-                break;
-        }
-        
-        return {total, dropped, drop_rate, output_info};
-    }
-    
+
+    Stats get_stats() const;
+
+    // 按记录中的格式串和参数生成消息正文
+    static void format_message(const LogRecordHeader& record, StringBuffer& out);
+
 private:
-    void writer_loop() {
-        std::array<LogEntry, BATCH_SIZE> batch;
-        
-        while (!shutdown_.load(std::memory_order_acquire)) {
-            size_t count = 0;
-            
-            // 批量读取日志条目
-            while (count < BATCH_SIZE) {
-                if (!log_buffer_.pop(batch[count])) {
-                    break;
-                }
-                ++count;
-            }
-            
-            if (count > 0) {
-                write_batch(batch.data(), count);
-            } else {
-                // 没有日志时稍微休眠
-                std::this_thread::sleep_for(std::chrono::microseconds(100));
+    // 线程本地的缓冲区缓存，按日志器ID区分
+    struct ThreadBuffers {
+        static constexpr size_t SLOTS = 4;
+        uint64_t logger_ids[SLOTS];
+        std::shared_ptr<LogStagingBuffer> buffers[SLOTS];
+        size_t next_victim;
+
+        ThreadBuffers() noexcept : logger_ids{}, next_victim(0) {}
+
+        ~ThreadBuffers() {
+            for (auto& buffer : buffers) {
+                if (buffer) buffer->retired.store(true, std::memory_order_release);
             }
+            tls_exited_ = true;
         }
-        
-        // 处理剩余的日志
-        LogOutput output = output_type_.load(std::memory_order_acquire);
-        LogEntry entry;
-        while (log_buffer_.pop(entry)) {
-            write_entry(entry, output);
-        }
-    }
-    
-    void write_batch(const LogEntry* entries, size_t count) {
-        LogOutput output = output_type_.load(std::memory_order_acquire);
-        
-        for (size_t i = 0; i < count; ++i) {
-            write_entry(entries[i], output);
-        }
-        
-        // 批量刷新
-        if ((output == LogOutput::FILE || output == LogOutput::BOTH) && file_stream_) {
-            file_stream_->flush();
-        }
-        if (output == LogOutput::CONSOLE || output == LogOutput::BOTH) {
-            std::cout.flush();
-        }
-    }
-    
-    void write_entry(const LogEntry& entry, LogOutput output) {
-        // 格式化时间戳为人类可读格式
-        auto time_t_value = std::chrono::system_clock::to_time_t(entry.timestamp);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            entry.timestamp.time_since_epoch()) % 1000;
-        
-        std::tm* tm_info = std::localtime(&time_t_value);
-        char time_buffer[32];
-        std::strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", tm_info);
-        
-        // 格式化日志级别
-        const char* level_str = level_to_string(entry.level);
-        
-        // 构建日志行
-        char log_line[1024];
-        std::snprintf(log_line, sizeof(log_line), 
-            "[%s.%03ld] [%s] [%s:%d] [tid:%zu] %s\n",
-            time_buffer, ms.count(), level_str, entry.file, entry.line, 
-            std::hash<std::thread::id>{}(entry.thread_id), entry.message);
-        
-        // 根据输出类型决定输出位置
-        switch (output) {
-            case LogOutput::CONSOLE:
-                std::cout << log_line;
-                break;
-            case LogOutput::FILE:
-                if (file_stream_) {
-                    file_stream_->write(log_line, strlen(log_line));
-                }
-                break;
-            case LogOutput::BOTH:
-                std::cout << log_line;
-                if (file_stream_) {
-                    file_stream_->write(log_line, strlen(log_line));
-                }
-                break;
-        }
-    }
-    
-    static const char* level_to_string(LogLevel level) {
-        switch (level) {
-            case LogLevel::TRACE: return "TRACE";
-            case LogLevel::LOG_DEBUG: return "DEBUG";
-            case LogLevel::LOG_INFO:  return "INFO ";
-            case LogLevel::LOG_WARN:  return "WARN ";
-            case LogLevel::LOG_ERROR: return "ERROR";
-            case LogLevel::LOG_FATAL: return "FATAL";
-            default: return "UNKNOWN";
+    };
+
+    LogStagingBuffer* local_buffer(std::unique_lock<std::mutex>& fallback_lock) {
+        if (!tls_exited_) {
+            ThreadBuffers& tls = tls_buffers_;
+            for (size_t i = 0; i < ThreadBuffers::SLOTS; ++i) {
+                if (tls.logger_ids[i] == id_) return tls.buffers[i].get();
+            }
+            return register_thread_buffer(tls);
         }
+        // 线程本地对象已析构（如其他thread_local的析构函数中记录日志），退回共享缓冲区
+        fallback_lock = std::unique_lock<std::mutex>(fallback_mutex_);
+        return fallback_buffer_.get();
     }
+
+    LogStagingBuffer* register_thread_buffer(ThreadBuffers& tls);
+
+    static const LogSite& dynamic_site(LogLevel level);
+
+    // 慢路径：超出份额或缓冲区已满时按级别策略处理，返回nullptr表示丢弃
+    std::byte* reserve_on_overflow(LogStagingBuffer& buffer, LogLevel level, size_t size);
+    void count_dropped(LogLevel level);
+    void wake_writer();
+
+    void writer_loop();
+    void wait_for_records();
+    bool has_pending_records();
+    size_t drain_buffers();
+    void service_file(bool force);
+    void write_out_file();
+    void write_record(const LogRecordHeader& record, size_t thread_hash, StringBuffer& line);
+    void write_line(const char* data, size_t size, LogOutput output);
+    static const char* level_to_string(LogLevel level);
+
+    const uint64_t id_;
+    static inline std::atomic<uint64_t> next_id_{1};
+
+    // 已注册的线程缓冲区
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<LogStagingBuffer>> buffers_;
+    std::atomic<size_t> thread_buffer_size_{DEFAULT_THREAD_BUFFER_SIZE};
+
+    // 线程退出后使用的共享缓冲区
+    std::mutex fallback_mutex_;
+    std::shared_ptr<LogStagingBuffer> fallback_buffer_;
+
+    // 后台写入线程，空闲时阻塞在eventfd上
+    std::unique_ptr<std::thread> writer_thread_;
+    std::atomic<bool> shutdown_{false};
+    std::atomic<bool> flush_requested_{false};
+    int event_fd_ = -1;
+    alignas(64) std::atomic<bool> writer_sleeping_{false};
+
+    // 各级别策略
+    std::array<std::atomic<uint32_t>, LOG_LEVEL_COUNT> fill_permille_;
+    std::array<std::atomic<int>, LOG_LEVEL_COUNT> overflow_policy_;
+    std::array<std::atomic<uint32_t>, LOG_LEVEL_COUNT> sample_every_;
+    std::array<std::atomic<uint64_t>, LOG_LEVEL_COUNT> dropped_by_level_{};
+
+    // 输出，以下成员受output_mutex_保护
+    mutable std::mutex output_mutex_;
+    LogFileSink file_sink_;
+    uint64_t unflushed_records_ = 0;  // 已格式化但仍在文件缓冲中的记录数
+    int64_t cached_second_ = -1;       // 时间前缀按秒缓存，避免每行调用localtime
+    char cached_prefix_[32] = {};
+    size_t cached_prefix_size_ = 0;
+    std::atomic<LogLevel> min_level_{LogLevel::LOG_INFO};
+    std::atomic<LogOutput> output_type_{LogOutput::FILE};
+    std::string log_file_path_;
+
+    // 性能统计；成功记录数由各缓冲区分别计数，避免调用线程争用同一缓存行
+    uint64_t total_logs() const;
+    uint64_t removed_records_ = 0;  // 已移除缓冲区的记录数，受buffers_mutex_保护
+    alignas(64) std::atomic<uint64_t> dropped_logs_{0};
+    alignas(64) std::atomic<uint64_t> written_logs_{0};
+
+    static inline thread_local ThreadBuffers tls_buffers_;
+    static inline thread_local bool tls_exited_ = false;
 };
 
 // 全局日志器实例
+// 每个线程缓存当前日志器指针，用代数(generation)判断是否失效，热路径上没有call_once；
+// 重新初始化时旧实例只关闭不释放，其他线程手里的旧指针始终有效。
 class GlobalLogger {
-private:
-    static std::unique_ptr<Logger> instance_;
-    static std::once_flag init_flag_;
-    
 public:
     static Logger& get() {
-        std::call_once(init_flag_, []() {
-            instance_ = std::make_unique<Logger>();
-            // 默认输出到文件
-            instance_->initialize("flowcoro.log", LogLevel::LOG_INFO, LogOutput::FILE);
-        });
-        return *instance_;
-    }
-    
-    // 重新初始化日志系统
-    static bool reinitialize(const std::string& filename = "flowcoro.log", 
-                            LogLevel min_level = LogLevel::LOG_INFO, 
-                            LogOutput output = LogOutput::FILE) {
-        if (instance_) {
-            instance_->shutdown();
+        Cache& cache = tls_cache_;
+        if (cache.generation != generation_.load(std::memory_order_acquire)) [[unlikely]] {
+            return refresh(cache);
         }
-        instance_ = std::make_unique<Logger>();
-        return instance_->initialize(filename, min_level, output);
+        return *cache.logger;
     }
-    
+
+    // 级别启用时返回日志器，否则返回nullptr；LOG_*宏只在返回非空时才对参数求值
+    static Logger* enabled_for(LogLevel level) {
+        Logger& logger = get();
+        return logger.should_log(level) ? &logger : nullptr;
+    }
+
+    // 重新初始化日志系统
+    static bool reinitialize(const std::string& filename = "flowcoro.log",
+                            LogLevel min_level = LogLevel::LOG_INFO,
+                            LogOutput output = LogOutput::FILE);
+
     // 便捷方法：设置为控制台输出
     static bool set_console_output(LogLevel min_level = LogLevel::LOG_INFO) {
         return reinitialize("", min_level, LogOutput::CONSOLE);
     }
-    
+
     // 便捷方法：设置为文件输出
-    static bool set_file_output(const std::string& filename = "flowcoro.log", 
+    static bool set_file_output(const std::string& filename = "flowcoro.log",
                                LogLevel min_level = LogLevel::LOG_INFO) {
         return reinitialize(filename, min_level, LogOutput::FILE);
     }
-    
+
     // 便捷方法：设置为同时输出
-    static bool set_both_output(const std::string& filename = "flowcoro.log", 
+    static bool set_both_output(const std::string& filename = "flowcoro.log",
                                LogLevel min_level = LogLevel::LOG_INFO) {
         return reinitialize(filename, min_level, LogOutput::BOTH);
     }
-    
-    static void shutdown() {
-        if (instance_) {
-            instance_->shutdown();
-            instance_.reset();
-        }
-    }
+
+    // 关闭当前日志器并输出剩余日志；之后的日志调用安全但不再输出
+    static void shutdown();
+
+private:
+    struct Cache {
+        Logger* logger;
+        uint64_t generation;
+    };
+
+    static Logger& refresh(Cache& cache);
+
+    static std::atomic<Logger*> current_;
+    static std::atomic<uint64_t> generation_;
+    static inline thread_local Cache tls_cache_{nullptr, 0};
 };
 } // namespace flowcoro
 
+// 编译期日志级别：低于FLOWCORO_LOG_ACTIVE_LEVEL的LOG_*调用在预处理阶段移除，参数不求值
+// 默认Release(NDEBUG)移除TRACE，其余构建全部保留；可在编译选项中指定
+#define FLOWCORO_LOG_LEVEL_TRACE 0
+#define FLOWCORO_LOG_LEVEL_DEBUG 1
+#define FLOWCORO_LOG_LEVEL_INFO  2
+#define FLOWCORO_LOG_LEVEL_WARN  3
+#define FLOWCORO_LOG_LEVEL_ERROR 4
+#define FLOWCORO_LOG_LEVEL_FATAL 5
+#define FLOWCORO_LOG_LEVEL_OFF   6
+
+#ifndef FLOWCORO_LOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define FLOWCORO_LOG_ACTIVE_LEVEL FLOWCORO_LOG_LEVEL_DEBUG
+#else
+#define FLOWCORO_LOG_ACTIVE_LEVEL FLOWCORO_LOG_LEVEL_TRACE
+#endif
+#endif
+
 // 便捷宏定义
-#define LOG_TRACE(format, ...) flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::TRACE, __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_DEBUG(format, ...) flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::LOG_DEBUG, __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_INFO(format, ...)  flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::LOG_INFO,  __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_WARN(format, ...)  flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::LOG_WARN,  __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_ERROR(format, ...) flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::LOG_ERROR, __FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_FATAL(format, ...) flowcoro::GlobalLogger::get().log(flowcoro::LogLevel::LOG_FATAL, __FILE__, __LINE__, format, ##__VA_ARGS__)
+// 每个调用点生成一个静态LogSite；格式串在编译期按printf规则检查（std::string参数请传c_str()）
+// 运行期级别关闭时只有一次线程本地指针读取和一次relaxed读取，参数不求值
+#define FLOWCORO_LOG(level, format, ...) \
+    do { \
+        if (false) ::flowcoro::detail::check_log_format(format __VA_OPT__(,) __VA_ARGS__); \
+        if (::flowcoro::Logger* flowcoro_logger_ = ::flowcoro::GlobalLogger::enabled_for(level)) { \
+            static constexpr ::flowcoro::LogSite flowcoro_log_site_{level, __FILE__, __LINE__, format}; \
+            flowcoro_logger_->log(flowcoro_log_site_ __VA_OPT__(,) __VA_ARGS__); \
+        } \
+    } while (0)
+
+// 编译期移除的调用：只保留格式检查，不生成任何代码
+#define FLOWCORO_LOG_DISABLED(format, ...) \
+    do { \
+        if (false) ::flowcoro::detail::check_log_format(format __VA_OPT__(,) __VA_ARGS__); \
+    } while (0)
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_TRACE
+#define LOG_TRACE(format, ...) FLOWCORO_LOG(flowcoro::LogLevel::TRACE, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_TRACE(format, ...) FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) FLOWCORO_LOG(flowcoro::LogLevel::LOG_DEBUG, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_INFO
+#define LOG_INFO(format, ...)  FLOWCORO_LOG(flowcoro::LogLevel::LOG_INFO, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_INFO(format, ...)  FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_WARN
+#define LOG_WARN(format, ...)  FLOWCORO_LOG(flowcoro::LogLevel::LOG_WARN, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_WARN(format, ...)  FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) FLOWCORO_LOG(flowcoro::LogLevel::LOG_ERROR, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
+
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_FATAL
+#define LOG_FATAL(format, ...) FLOWCORO_LOG(flowcoro::LogLevel::LOG_FATAL, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define LOG_FATAL(format, ...) FLOWCORO_LOG_DISABLED(format __VA_OPT__(,) __VA_ARGS__)
+#endif
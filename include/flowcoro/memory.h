@@ -4,36 +4,81 @@
  */
 
 #pragma once
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include "buffer.h"
 #include "memory_pool.h"
 #include "object_pool.h"
+#include "slab_allocator.h"
+#include "request_arena.h"
 
 namespace flowcoro {
 namespace memory {
 
 /**
  * @brief 全局内存管理器
+ *
+ * 按类型登记CacheFriendlyMemoryPool，每种类型一个池，统一统计和回收。
  */
 class GlobalMemoryManager {
 public:
     static GlobalMemoryManager& instance();
-    
+
     template<typename T>
-    std::shared_ptr<CacheFriendlyMemoryPool<T>> get_pool();
-    
-    void cleanup_all_pools();
-    
+    std::shared_ptr<CacheFriendlyMemoryPool<T>> get_pool() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = pools_[std::type_index(typeid(T))];
+        if (!entry) {
+            entry = std::make_unique<TypedPoolEntry<T>>();
+        }
+        return static_cast<TypedPoolEntry<T>*>(entry.get())->pool;
+    }
+
+    // 释放各池中完全空闲的内存块，返回释放的字节数
+    size_t cleanup_all_pools();
+
     struct MemoryStats {
-        size_t total_allocated_bytes;
-        size_t total_objects;
+        size_t total_allocated_bytes;  // 各池持有的内存
+        size_t total_objects;          // 正在使用的对象数
         size_t pool_count;
-        double fragmentation_ratio;
+        double fragmentation_ratio;    // 持有但未使用的内存占比
     };
-    
+
     MemoryStats get_stats() const;
-    
+
 private:
     GlobalMemoryManager() = default;
     ~GlobalMemoryManager() = default;
+
+    // 类型擦除的池条目
+    struct PoolEntry {
+        virtual ~PoolEntry() = default;
+        virtual size_t held_bytes() const = 0;
+        virtual size_t in_use_objects() const = 0;
+        virtual size_t in_use_bytes() const = 0;
+        virtual size_t trim() = 0;
+    };
+
+    template<typename T>
+    struct TypedPoolEntry : PoolEntry {
+        std::shared_ptr<CacheFriendlyMemoryPool<T>> pool = std::make_shared<CacheFriendlyMemoryPool<T>>();
+
+        size_t held_bytes() const override {
+            return pool->get_stats().pool_size * CacheFriendlyMemoryPool<T>::block_size();
+        }
+        size_t in_use_objects() const override {
+            return pool->get_stats().allocated_count;
+        }
+        size_t in_use_bytes() const override {
+            return in_use_objects() * CacheFriendlyMemoryPool<T>::block_size();
+        }
+        size_t trim() override { return pool->trim(); }
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::type_index, std::unique_ptr<PoolEntry>> pools_;
 };
 
 } // namespace memory
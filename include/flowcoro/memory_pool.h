@@ -1,94 +1,136 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <mutex>
 #include <memory>
 #include <list>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <chrono>
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace flowcoro {
 
+// 定长块内存池
+// 共享池由互斥锁保护，前端为每个线程的块缓存(magazine)：
+// 常规的allocate/deallocate只访问线程本地缓存，缓存空/满时才批量与共享池交换，
+// 因此分配随线程数扩展而不是串行在同一把锁上。
 class MemoryPool {
 public:
     explicit MemoryPool(size_t block_size = 4096, size_t initial_block_count = 128)
-        : block_size_(block_size), 
+        : block_size_(block_size),
           initial_block_count_(initial_block_count),
           expansion_factor_(2.0),  // 每次扩展为当前大小的2倍
           max_total_blocks_(initial_block_count * 32) {  // 最大扩展限制
-        
+
+        register_pool();
+        std::lock_guard<std::mutex> lock(mtx_);
         expand_pool(initial_block_count);
     }
-    
+
     ~MemoryPool() {
-        // unique_ptr会自动清理所有内存块
+        // 其他线程缓存中的块随内存一起释放，它们的缓存会通过pool_id不匹配自行作废
+        unregister_pool();
     }
-    
+
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
     void* allocate() {
-        std::lock_guard<std::mutex> lock(mtx_);
-        
-        if (free_blocks_.empty()) {
-            // 动态扩展池
-            size_t current_total = total_allocated_blocks_;
-            size_t expand_size = std::max(
-                static_cast<size_t>(current_total * (expansion_factor_ - 1.0)),
-                initial_block_count_ / 4  // 最小扩展数量
-            );
-            
-            // 检查是否超过最大限制
-            if (current_total + expand_size > max_total_blocks_) {
-                expand_size = max_total_blocks_ - current_total;
-            }
-            
-            if (expand_size > 0) {
-                expand_pool(expand_size);
-            }
-        }
-        
-        if (free_blocks_.empty()) {
-            // 如果还是没有可用块，说明已经达到最大限制
-            // 这时我们可以选择降低扩展因子继续尝试，或者抛出异常
-            // 这里我们尝试小幅扩展
-            if (total_allocated_blocks_ < max_total_blocks_) {
-                expand_pool(1);  // 至少分配一个块
+        if (Magazine* mag = local_magazine()) {
+            if (mag->count == 0) {
+                refill(*mag);
             }
+            return mag->blocks[--mag->count];
         }
-        
-        if (free_blocks_.empty()) {
-            throw std::bad_alloc();  // 真的无法分配时抛出异常
-        }
-        
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        ensure_free_blocks();
         void* ptr = free_blocks_.back();
         free_blocks_.pop_back();
         allocated_count_++;
+        on_block_taken(ptr);
         return ptr;
     }
-    
+
     void deallocate(void* ptr) {
         if (!ptr) return;
-        
-        std::lock_guard<std::mutex> lock(mtx_);
-        
+
         // 检查指针是否来自我们的池
         if (!is_from_pool(ptr)) {
             // 不是来自池的内存，抛出异常而不是静默忽略
             throw std::invalid_argument("Attempting to deallocate pointer not from this pool");
         }
-        
+
+        if (Magazine* mag = local_magazine()) {
+            if (mag->count == MAGAZINE_SIZE) {
+                flush(*mag, TRANSFER_BATCH);
+            }
+            mag->blocks[mag->count++] = ptr;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
         free_blocks_.push_back(ptr);
         allocated_count_--;
+        on_block_returned(ptr, std::chrono::steady_clock::now());
+    }
+
+    // 将当前线程缓存的块全部归还共享池
+    void flush_thread_cache() {
+        if (Magazine* mag = local_magazine()) {
+            flush(*mag, mag->count);
+        }
+    }
+
+    // 请求其他线程归还缓存的块：各线程下次访问本池时先把整个缓存交回共享池
+    void request_thread_cache_flush() {
+        flush_epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 将空闲超过idle时长的内存块通过madvise(MADV_DONTNEED)归还操作系统
+    // 地址空间保留，块仍在空闲列表中，再次使用时由内核按需补零页
+    // 只有全部块都在共享空闲列表中的内存块才会释放，其他线程缓存的块需先通过request_thread_cache_flush收回
+    // 返回本次释放的字节数
+    size_t release_idle_chunks(std::chrono::steady_clock::duration idle) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto now = std::chrono::steady_clock::now();
+        size_t released = 0;
+        for (auto& chunk : memory_chunks_) {
+            if (chunk->free_count == chunk->block_count && !chunk->released &&
+                now - chunk->idle_since >= idle) {
+                ::madvise(chunk->start, chunk->mapped_bytes, MADV_DONTNEED);
+                chunk->released = true;
+                released += chunk->mapped_bytes;
+            }
+        }
+        released_bytes_ += released;
+        return released;
     }
-    
+
     // 配置接口
     void set_expansion_factor(double factor) {
         std::lock_guard<std::mutex> lock(mtx_);
         expansion_factor_ = std::max(1.1, std::min(factor, 5.0));  // 限制在合理范围
     }
-    
+
     void set_max_total_blocks(size_t max_blocks) {
         std::lock_guard<std::mutex> lock(mtx_);
         max_total_blocks_ = std::max(max_blocks, initial_block_count_);
     }
-    
+
+    // 限制每次扩展新建内存块的块数；固定大小的内存块更容易整体空闲，便于归还操作系统
+    void set_max_chunk_blocks(size_t max_blocks) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        max_chunk_blocks_ = std::max<size_t>(max_blocks, 1);
+    }
+
     // 统计信息
+    // allocated_blocks包含各线程缓存中尚未使用的块
     struct PoolStats {
         size_t block_size;
         size_t total_blocks;
@@ -96,8 +138,9 @@ public:
         size_t allocated_blocks;
         size_t memory_chunks;
         size_t total_memory_bytes;
+        size_t released_memory_bytes;  // 当前已归还操作系统的字节数
     };
-    
+
     PoolStats get_stats() const {
         std::lock_guard<std::mutex> lock(mtx_);
         return {
@@ -106,67 +149,383 @@ public:
             free_blocks_.size(),
             allocated_count_,
             memory_chunks_.size(),
-            total_allocated_blocks_ * block_size_
+            total_allocated_blocks_ * block_size_,
+            released_bytes_
         };
     }
-    
+
     size_t block_size() const { return block_size_; }
-    size_t available_blocks() const { 
+    size_t available_blocks() const {
         std::lock_guard<std::mutex> lock(mtx_);
-        return free_blocks_.size(); 
+        return free_blocks_.size();
     }
-    
+
+    // 判断指针是否为本池分配的块（O(1)，无锁）
+    bool owns(void* ptr) const { return is_from_pool(ptr); }
+
 private:
+    static constexpr size_t MAGAZINE_SIZE = 64;
+    static constexpr size_t TRANSFER_BATCH = MAGAZINE_SIZE / 2;
+
+    // 内存块按页对齐映射，每个SEGMENT_SIZE段在段表中登记所属块，成员检查只需一次哈希查找
+    static constexpr size_t SEGMENT_SHIFT = 12;
+    static constexpr size_t SEGMENT_SIZE = size_t{1} << SEGMENT_SHIFT;
+
+    // 内存块直接mmap，按页对齐，空闲时可以整体madvise
     struct MemoryChunk {
-        std::unique_ptr<char[]> memory;
         char* start;
         char* end;
         size_t block_count;
-        
-        MemoryChunk(size_t block_size, size_t count) 
-            : memory(std::make_unique<char[]>(block_size * count)),
-              start(memory.get()),
-              end(start + (block_size * count)),
-              block_count(count) {}
+        size_t mapped_bytes;
+        size_t free_count;                                 // 位于共享空闲列表中的块数
+        std::chrono::steady_clock::time_point idle_since;  // 全部块空闲的起始时间
+        bool released = false;
+
+        MemoryChunk(size_t block_size, size_t count)
+            : block_count(count), free_count(count), idle_since(std::chrono::steady_clock::now()) {
+            static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t bytes = block_size * count;
+            mapped_bytes = (bytes + page_size - 1) / page_size * page_size;
+            void* mem = ::mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            start = static_cast<char*>(mem);
+            end = start + bytes;
+        }
+
+        ~MemoryChunk() {
+            ::munmap(start, mapped_bytes);
+        }
+
+        MemoryChunk(const MemoryChunk&) = delete;
+        MemoryChunk& operator=(const MemoryChunk&) = delete;
     };
-    
+
+    // 段表：开放寻址哈希，段基址 -> 所属块
+    // 负载不超过一半时原地插入（先写块指针再发布段基址），否则按4倍余量重建并原子发布
+    struct SegmentTable {
+        struct Entry {
+            std::atomic<uintptr_t> segment{0};  // 0表示空槽
+            std::atomic<MemoryChunk*> chunk{nullptr};
+        };
+        std::unique_ptr<Entry[]> entries;
+        size_t capacity;
+        size_t mask;
+        size_t used = 0;
+
+        explicit SegmentTable(size_t cap) : entries(new Entry[cap]), capacity(cap), mask(cap - 1) {}
+
+        static size_t hash(uintptr_t segment) {
+            return static_cast<size_t>((segment >> SEGMENT_SHIFT) * 0x9E3779B97F4A7C15ull);
+        }
+
+        bool has_room(size_t count) const {
+            return (used + count) * 2 <= capacity;
+        }
+
+        void insert(uintptr_t segment, MemoryChunk* chunk) {
+            for (size_t i = hash(segment) & mask;; i = (i + 1) & mask) {
+                if (entries[i].segment.load(std::memory_order_relaxed) == 0) {
+                    entries[i].chunk.store(chunk, std::memory_order_relaxed);
+                    entries[i].segment.store(segment, std::memory_order_release);
+                    ++used;
+                    return;
+                }
+            }
+        }
+
+        MemoryChunk* find(uintptr_t segment) const {
+            for (size_t i = hash(segment) & mask;; i = (i + 1) & mask) {
+                uintptr_t current = entries[i].segment.load(std::memory_order_acquire);
+                if (current == segment) return entries[i].chunk.load(std::memory_order_relaxed);
+                if (current == 0) return nullptr;
+            }
+        }
+    };
+
+    // 线程本地缓存
+    struct Magazine {
+        uint64_t pool_id;
+        uint64_t flush_epoch;  // 已响应的归还请求
+        size_t count;
+        void* blocks[MAGAZINE_SIZE];
+    };
+
+    // 按槽位索引，线程首次使用某个池时才为其分配缓存，槽位数随存活池数增长
+    struct ThreadCaches {
+        std::vector<std::unique_ptr<Magazine>> magazines;
+    };
+
+    // 全局登记表：分配缓存槽位，并在线程退出时判断池是否仍然存活
+    // 池销毁后槽位空出供新池复用，槽位数等于同时存活的池数峰值
+    struct Registry {
+        std::mutex mutex;
+        uint64_t next_id = 1;
+        std::vector<MemoryPool*> pools;
+        std::vector<uint64_t> ids;
+    };
+
+    struct CacheOwner {
+        ThreadCaches* caches;
+
+        constexpr CacheOwner() noexcept : caches(nullptr) {}
+
+        ~CacheOwner() {
+            if (!caches) return;
+            Registry& registry = registry_instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (size_t slot = 0; slot < caches->magazines.size(); ++slot) {
+                Magazine* mag = caches->magazines[slot].get();
+                if (!mag || mag->count == 0) continue;
+                MemoryPool* pool = registry.pools[slot];
+                if (pool && registry.ids[slot] == mag->pool_id) {
+                    pool->return_blocks(mag->blocks, mag->count);
+                }
+            }
+            delete caches;
+            caches = nullptr;
+            tls_caches_ = nullptr;
+            tls_exited_ = true;
+        }
+    };
+
+    static Registry& registry_instance() {
+        // 不析构：线程退出时仍可能访问
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    void register_pool() {
+        Registry& registry = registry_instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        pool_id_ = registry.next_id++;
+        auto it = std::find(registry.pools.begin(), registry.pools.end(), nullptr);
+        slot_ = static_cast<size_t>(it - registry.pools.begin());
+        if (it == registry.pools.end()) {
+            registry.pools.push_back(this);
+            registry.ids.push_back(pool_id_);
+        } else {
+            *it = this;
+            registry.ids[slot_] = pool_id_;
+        }
+    }
+
+    void unregister_pool() {
+        Registry& registry = registry_instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.pools[slot_] = nullptr;
+        registry.ids[slot_] = 0;
+    }
+
+    Magazine* local_magazine() {
+        ThreadCaches* caches = tls_caches_;
+        if (!caches) {
+            if (tls_exited_) return nullptr;
+            caches = new ThreadCaches();
+            tls_caches_ = caches;
+            tls_owner_.caches = caches;
+        }
+        if (slot_ >= caches->magazines.size()) {
+            caches->magazines.resize(slot_ + 1);
+        }
+        uint64_t epoch = flush_epoch_.load(std::memory_order_relaxed);
+        auto& slot = caches->magazines[slot_];
+        if (!slot) {
+            slot = std::make_unique<Magazine>();
+            slot->pool_id = pool_id_;
+            slot->flush_epoch = epoch;
+            slot->count = 0;
+        } else if (slot->pool_id != pool_id_) {
+            // 槽位之前属于已销毁的池，其中的块已随该池释放
+            slot->pool_id = pool_id_;
+            slot->flush_epoch = epoch;
+            slot->count = 0;
+        } else if (slot->flush_epoch != epoch) {
+            slot->flush_epoch = epoch;
+            flush(*slot, slot->count);
+        }
+        return slot.get();
+    }
+
+    void refill(Magazine& mag) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ensure_free_blocks();
+        size_t batch = std::min(TRANSFER_BATCH, free_blocks_.size());
+        std::copy(free_blocks_.end() - batch, free_blocks_.end(), mag.blocks);
+        free_blocks_.resize(free_blocks_.size() - batch);
+        mag.count = batch;
+        allocated_count_ += batch;
+        for (size_t i = 0; i < batch; ++i) {
+            on_block_taken(mag.blocks[i]);
+        }
+    }
+
+    void flush(Magazine& mag, size_t count) {
+        count = std::min(count, mag.count);
+        if (count == 0) return;
+        return_blocks(mag.blocks + (mag.count - count), count);
+        mag.count -= count;
+    }
+
+    void return_blocks(void* const* blocks, size_t count) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_blocks_.insert(free_blocks_.end(), blocks, blocks + count);
+        allocated_count_ -= count;
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            on_block_returned(blocks[i], now);
+        }
+    }
+
+    MemoryChunk* chunk_of(void* ptr) const {
+        const SegmentTable* table = segment_table_.load(std::memory_order_acquire);
+        return table->find(reinterpret_cast<uintptr_t>(ptr) & ~(SEGMENT_SIZE - 1));
+    }
+
+    // 以下两个函数需持有mtx_，维护每个内存块的空闲计数
+    void on_block_taken(void* ptr) {
+        MemoryChunk* chunk = chunk_of(ptr);
+        if (chunk->released) {
+            released_bytes_ -= chunk->mapped_bytes;
+            chunk->released = false;
+        }
+        chunk->free_count--;
+    }
+
+    void on_block_returned(void* ptr, std::chrono::steady_clock::time_point now) {
+        MemoryChunk* chunk = chunk_of(ptr);
+        if (++chunk->free_count == chunk->block_count) {
+            chunk->idle_since = now;
+        }
+    }
+
+    // 需持有mtx_
+    void ensure_free_blocks() {
+        if (free_blocks_.empty()) {
+            // 动态扩展池
+            size_t current_total = total_allocated_blocks_;
+            size_t expand_size = std::max(
+                static_cast<size_t>(current_total * (expansion_factor_ - 1.0)),
+                initial_block_count_ / 4  // 最小扩展数量
+            );
+            expand_size = std::min(expand_size, max_chunk_blocks_);
+
+            // 检查是否超过最大限制
+            if (current_total + expand_size > max_total_blocks_) {
+                expand_size = max_total_blocks_ > current_total ? max_total_blocks_ - current_total : 0;
+            }
+
+            if (expand_size > 0) {
+                expand_pool(expand_size);
+            }
+        }
+
+        if (free_blocks_.empty()) {
+            // 如果还是没有可用块，说明已经达到最大限制
+            // 这里我们尝试小幅扩展
+            if (total_allocated_blocks_ < max_total_blocks_) {
+                expand_pool(1);  // 至少分配一个块
+            }
+        }
+
+        if (free_blocks_.empty()) {
+            throw std::bad_alloc();  // 真的无法分配时抛出异常
+        }
+    }
+
     bool is_from_pool(void* ptr) const {
+        const SegmentTable* table = segment_table_.load(std::memory_order_acquire);
+        if (!table) return false;
+
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        const MemoryChunk* chunk = table->find(addr & ~(SEGMENT_SIZE - 1));
+        if (!chunk) return false;
+
         char* char_ptr = static_cast<char*>(ptr);
+        return char_ptr >= chunk->start && char_ptr < chunk->end &&
+               static_cast<size_t>(char_ptr - chunk->start) % block_size_ == 0;
+    }
+
+    static size_t segment_count(const MemoryChunk& chunk) {
+        return (chunk.end - chunk.start + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+    }
+
+    // 需持有mtx_；新块的段能原地插入时不重建
+    void register_segments(MemoryChunk* chunk) {
+        SegmentTable* table = segment_tables_.empty() ? nullptr : segment_tables_.back().get();
+        if (table && table->has_room(segment_count(*chunk))) {
+            for (char* seg = chunk->start; seg < chunk->end; seg += SEGMENT_SIZE) {
+                table->insert(reinterpret_cast<uintptr_t>(seg), chunk);
+            }
+            return;
+        }
+        rebuild_segment_table();
+    }
+
+    // 需持有mtx_；重建段表后原子发布，旧表保留到池析构，保证无锁读取安全
+    void rebuild_segment_table() {
+        size_t segments = 0;
         for (const auto& chunk : memory_chunks_) {
-            if (char_ptr >= chunk->start && char_ptr < chunk->end) {
-                return true;
+            segments += segment_count(*chunk);
+        }
+        size_t capacity = 16;
+        while (capacity < segments * 4) {
+            capacity <<= 1;
+        }
+
+        auto table = std::make_unique<SegmentTable>(capacity);
+        for (const auto& chunk : memory_chunks_) {
+            for (char* seg = chunk->start; seg < chunk->end; seg += SEGMENT_SIZE) {
+                table->insert(reinterpret_cast<uintptr_t>(seg), chunk.get());
             }
         }
-        return false;
+        segment_table_.store(table.get(), std::memory_order_release);
+        segment_tables_.push_back(std::move(table));
     }
-    
+
+    // 需持有mtx_
     void expand_pool(size_t additional_blocks) {
         if (additional_blocks == 0) return;
-        
+
         // 创建新的内存块
         auto chunk = std::make_unique<MemoryChunk>(block_size_, additional_blocks);
         char* memory_start = chunk->start;
-        
+
         // 将新内存切分成小块加入空闲列表
         for (size_t i = 0; i < additional_blocks; ++i) {
             void* block = memory_start + (i * block_size_);
             free_blocks_.push_back(block);
         }
-        
+
         total_allocated_blocks_ += additional_blocks;
         memory_chunks_.push_back(std::move(chunk));
+        register_segments(memory_chunks_.back().get());
     }
-    
+
     size_t block_size_;
     size_t initial_block_count_;
     double expansion_factor_;
     size_t max_total_blocks_;
+    size_t max_chunk_blocks_ = SIZE_MAX;
     size_t total_allocated_blocks_ = 0;
     size_t allocated_count_ = 0;
-    
+    size_t released_bytes_ = 0;
+
+    uint64_t pool_id_ = 0;
+    size_t slot_ = 0;
+
     std::list<std::unique_ptr<MemoryChunk>> memory_chunks_;  // 所有内存块
     std::vector<void*> free_blocks_;                         // 空闲块列表
-    mutable std::mutex mtx_;                                 // 线程安全
+    std::atomic<const SegmentTable*> segment_table_{nullptr};
+    std::vector<std::unique_ptr<SegmentTable>> segment_tables_;
+    std::atomic<uint64_t> flush_epoch_{0};
+    mutable std::mutex mtx_;                                 // 保护共享池
+
+    static inline thread_local ThreadCaches* tls_caches_ = nullptr;
+    static inline thread_local bool tls_exited_ = false;
+    static inline thread_local CacheOwner tls_owner_;
 };
 
 } // namespace flowcoro
@@ -16,10 +16,13 @@
 
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -30,9 +33,17 @@
 #include <queue>
 #include <mutex>
 #include <atomic>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
 
 #include "core.h"
 #include "lockfree.h"
+#include "buffer.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
 
 namespace flowcoro::net {
 
@@ -41,6 +52,20 @@ class EventLoop;
 class Socket;
 class TcpServer;
 class TcpConnection;
+class UdpSocket;
+class BufferedReader;
+class IoWaiter;
+struct SocketIoState;
+class IoUring;
+class IoUringBufferRing;
+struct UringOp;
+
+// IO后端
+enum class IoBackend {
+    AUTO,      // 内核支持时用io_uring，否则回退到epoll
+    EPOLL,     // 就绪通知：边沿触发epoll + 非阻塞系统调用
+    IO_URING   // 完成通知：操作直接提交给内核，完成后恢复协程
+};
 
 // IO事件类型
 enum class IoEvent : uint32_t {
@@ -48,6 +73,7 @@ enum class IoEvent : uint32_t {
     WRITE = EPOLLOUT,
     ERROR = EPOLLERR,
     HANGUP = EPOLLHUP,
+    READ_HANGUP = EPOLLRDHUP,
     EDGE_TRIGGERED = EPOLLET
 };
 
@@ -62,13 +88,34 @@ struct IoEventHandler {
 
 /**
  * @brief 高性能事件循环
- * 基于Linux epoll实现的异步IO事件循环
+ * 基于Linux epoll或io_uring实现的异步IO事件循环
+ * io_uring模式下Socket的读写、accept、connect以SQE提交，每轮run_once一次io_uring_enter
+ * 批量提交并等待完成；add_fd注册的普通处理器仍然通过epoll分发（epoll fd本身以multishot poll挂在ring上）。
  */
 class EventLoop {
 private:
+    friend class Socket;
+    friend class IoWaiter;
+
+    IoBackend backend_{IoBackend::EPOLL};
     int epoll_fd_{-1};
+    int wake_fd_{-1};                       // eventfd，其他线程投递任务或stop时唤醒等待
+    std::atomic<bool> wake_pending_{false};
     std::atomic<bool> running_{false};
-    std::unordered_map<int, std::unique_ptr<IoEventHandler>> handlers_;
+    // 按fd直接索引的处理器表，只在事件循环线程上访问。Socket直接登记就绪状态，不经过std::function；
+    // epoll_event.data高32位是槽位的代数，移除时递增，fd关闭后被重用时同一批中的旧事件据此丢弃
+    struct HandlerSlot {
+        SocketIoState* socket{nullptr};
+        std::unique_ptr<IoEventHandler> handler;
+        uint32_t generation{0};
+    };
+    std::vector<HandlerSlot> handlers_;
+    // 分发事件期间被移除的处理器，本轮分发结束后再释放
+    bool dispatching_{false};
+    std::vector<std::unique_ptr<IoEventHandler>> retired_handlers_;
+    uint64_t ctl_calls_{0};
+    uint64_t events_dispatched_{0};
+    uint64_t iterations_{0};
     lockfree::Queue<std::function<void()>> pending_tasks_;
     
     // 定时器支持
@@ -80,21 +127,64 @@ private:
         }
     };
     std::priority_queue<TimerEvent> timer_queue_;
-    std::mutex timer_mutex_;
+    mutable std::mutex timer_mutex_;
+
+    // 被close取消、等待在下一轮恢复的操作
+    std::vector<IoWaiter*> deferred_resumes_;
+
+    // io_uring后端
+    std::unique_ptr<IoUring> uring_;
+    IoUringBufferRing* buffer_ring_{nullptr};  // 内核不支持provided buffer ring时为nullptr
+    UringOp* live_ops_{nullptr};               // 进行中请求的链表，析构时回收
+    bool multishot_accept_{true};
+    bool epoll_poll_armed_{false};
 
 public:
-    EventLoop();
+    // io_uring的SQ大小与接收缓冲区组的配置
+    static constexpr unsigned URING_ENTRIES = 256;
+    static constexpr unsigned RECV_BUFFER_COUNT = 64;
+    static constexpr size_t RECV_BUFFER_SIZE = 16 * 1024;
+
+    /**
+     * @brief 创建事件循环
+     * @param backend IO后端；请求io_uring但内核不支持（或创建失败）时回退到epoll
+     */
+    explicit EventLoop(IoBackend backend = default_backend());
     ~EventLoop();
+
+    /**
+     * @brief 默认后端，由环境变量FLOWCORO_IO_BACKEND决定：epoll、io_uring或auto（默认）
+     */
+    static IoBackend default_backend();
+
+    /**
+     * @brief 实际使用的后端（AUTO已解析）
+     */
+    IoBackend backend() const { return backend_; }
+
+    /**
+     * @brief io_uring模式下的接收缓冲区组，内核不支持provided buffer ring时为nullptr
+     */
+    IoUringBufferRing* buffer_ring() const { return buffer_ring_; }
     
     // 禁止拷贝
     EventLoop(const EventLoop&) = delete;
     EventLoop& operator=(const EventLoop&) = delete;
     
     /**
-     * @brief 启动事件循环
-     * @return 协程任务
+     * @brief 在当前线程运行事件循环直到stop()，同时作为协程调度器（CoroutineManager）的停放点
+     * 每轮在epoll/io_uring中等待，超时取本循环与调度器最近的定时器；有就绪协程时不等待。
+     * IO完成唤醒的协程与到期的sleep_for在同一轮中恢复，其他线程调度协程时唤醒等待。
+     * 同一时间只能有一个事件循环驱动调度器，否则抛出std::logic_error。
      */
-    Task<void> run();
+    void run();
+    
+    /**
+     * @brief 执行一轮循环：到期定时器、待执行任务，然后等待并分发IO事件（不驱动协程调度器）
+     * @param timeout_ms epoll_wait的最长等待时间，还会被下一个定时器截短；-1表示只受定时器限制，没有定时器时等到被唤醒
+     * @return 本轮分发的IO事件数
+     */
+    int run_once(int timeout_ms = -1);
     
     /**
      * @brief 停止事件循环
@@ -102,7 +192,7 @@ public:
     void stop();
     
     /**
-     * @brief 添加文件描述符到事件循环
+     * @brief 添加文件描述符到事件循环（只能在事件循环线程上调用，下同）
      * @param fd 文件描述符
      * @param events 监听的事件类型
      * @param handler 事件处理器
@@ -123,11 +213,16 @@ public:
     void remove_fd(int fd);
     
     /**
-     * @brief 在事件循环中执行任务
+     * @brief 在事件循环中执行任务，可以从任意线程调用，会唤醒正在等待的事件循环
      * @param task 要执行的任务
      */
     void post_task(std::function<void()> task);
     
+    /**
+     * @brief 唤醒正在等待IO的事件循环，可以从任意线程调用
+     */
+    void wakeup();
+    
     /**
      * @brief 定时执行任务
      * @param delay 延迟时间
@@ -140,25 +235,463 @@ public:
      * @return 是否运行中
      */
     bool is_running() const { return running_.load(std::memory_order_acquire); }
+    
+    // 统计：epoll_ctl调用次数、已分发的事件数（io_uring模式含完成事件）、io_uring_enter调用次数、循环轮数、待触发的定时器数
+    struct Stats {
+        uint64_t ctl_calls;
+        uint64_t events_dispatched;
+        uint64_t submit_calls;
+        uint64_t iterations;
+        size_t pending_timers;
+    };
+    Stats get_stats() const;
 
 private:
     void process_pending_tasks();
     void process_timers();
+    void process_deferred_resumes();
     int get_next_timeout();
+    int iterate(int timeout_ms, CoroutineManager* scheduler);
+
+    // 处理器表
+    void register_fd(int fd, uint32_t events, SocketIoState* socket, std::unique_ptr<IoEventHandler> handler);
+    bool is_live(int fd, uint32_t generation) const;
+    int dispatch_epoll(int timeout);
+    int run_uring(int timeout);
+
+    // io_uring请求管理
+    UringOp* new_op(IoWaiter* waiter);
+    void release_op(UringOp* op);
+    void submit_io(IoWaiter* waiter);
+    void arm_accept(SocketIoState* io, int fd);
+    void cancel_op(UringOp* op);
+    void arm_epoll_poll();
+    void handle_completion(const io_uring_cqe& cqe);
+    void complete_accept(UringOp* op, int result, uint32_t flags);
+
+    // close取消的等待者在下一轮run_once中恢复；等待者先销毁时从队列移除
+    void defer_resume(IoWaiter* waiter);
+    void forget_deferred(IoWaiter* waiter);
+};
+
+// 挂起在socket某个方向上的IO操作
+// epoll模式：就绪事件到达后由事件循环调用retry重试；io_uring模式：prepare填写SQE，完成后调用complete。
+// 协程帧在操作完成前被销毁时，析构函数解除与socket、进行中请求和事件循环的关联。
+class IoWaiter {
+public:
+    // 重试操作：完成（成功或出错）返回true，仍然EAGAIN返回false继续等待
+    virtual bool retry() = 0;
+
+    // 填写io_uring请求；不以单次请求提交的等待者（accept）不需要实现
+    virtual void prepare(io_uring_sqe*) {}
+
+    // 处理io_uring完成结果（result<0为-errno）；返回false表示需要重新提交
+    virtual bool complete(int result, uint32_t flags) = 0;
+
+    // 从socket上摘下并恢复协程
+    void resume() {
+        if (slot) {
+            *slot = nullptr;
+            slot = nullptr;
+        }
+        handle.resume();
+    }
+
+    std::coroutine_handle<> handle;
+    int error{0};
+    int timeout_ms{-1};                 // 操作超时，<0表示不限
+    IoWaiter** slot{nullptr};           // 登记在SocketIoState中的位置
+    UringOp* op{nullptr};               // 进行中的io_uring请求
+    EventLoop* deferred_loop{nullptr};  // 已排入事件循环等待恢复
+
+protected:
+    ~IoWaiter();
+};
+
+// socket在事件循环中的持久状态
+// epoll模式：fd在第一次需要等待时以边沿触发(EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET)注册，直到关闭才注销；
+// 每个方向缓存一个就绪位：就绪时直接做系统调用，确认EAGAIN（或读写不足）后才挂起等待下一次边沿；
+// 对端关闭或出错之后不会再有新边沿，读写不足时保持就绪，由下一次系统调用返回0或错误。
+// io_uring模式：监听socket上保持一个multishot accept，先到的连接暂存在accepted中。
+// 只在所属事件循环的线程上访问
+// 按缓存行对齐，不同reactor上的连接状态不共享缓存行
+struct alignas(64) SocketIoState {
+    IoWaiter* read_waiter{nullptr};
+    IoWaiter* write_waiter{nullptr};
+    bool read_ready{true};    // 状态未知时按就绪处理，先尝试系统调用
+    bool write_ready{true};
+    bool registered{false};
+    bool read_closed{false};  // 收到过EPOLLRDHUP/EPOLLHUP/EPOLLERR
+    bool write_closed{false}; // 收到过EPOLLHUP/EPOLLERR
+    // epoll模式的操作超时：每个方向记录当前等待的截止时间（无超时为max），事件循环中最多挂一个该方向的定时器；
+    // 定时器到期时等待已换成截止更晚的，就按新截止时间重新挂上，不为每次等待都压入一个定时器
+    std::chrono::steady_clock::time_point read_deadline{std::chrono::steady_clock::time_point::max()};
+    std::chrono::steady_clock::time_point write_deadline{std::chrono::steady_clock::time_point::max()};
+    std::chrono::steady_clock::time_point read_timer_at{};   // 已挂定时器的到期时间，默认值表示没有
+    std::chrono::steady_clock::time_point write_timer_at{};
+
+    // MSG_ZEROCOPY：0未尝试，1已开启SO_ZEROCOPY，-1不支持；每次零拷贝sendmsg占一个序号，通知按序号区间确认
+    int8_t zerocopy{0};
+    uint32_t zerocopy_sent{0};
+    uint32_t zerocopy_acked{0};
+    uint32_t zerocopy_copied{0};  // 内核无法零拷贝（如回环）而复制了数据的通知数
+
+    UringOp* accept_op{nullptr};
+    // 只有io_uring监听socket使用：空vector不分配内存，accepted_head之前的已被取走
+    std::vector<int> accepted;
+    size_t accepted_head{0};
+
+    // 系统调用读写不足：缓冲区通常已空/满，下次直接等待边沿；
+    // 但关闭事件可能与数据在同一个边沿到达，已关闭的方向保持就绪
+    void drained(bool write_side) {
+        if (!(write_side ? write_closed : read_closed)) {
+            (write_side ? write_ready : read_ready) = false;
+        }
+    }
+
+    // 事件循环收到某个方向的就绪事件
+    void notify(bool write_side) {
+        (write_side ? write_ready : read_ready) = true;
+        IoWaiter* waiter = write_side ? write_waiter : read_waiter;
+        if (waiter && waiter->retry()) {
+            waiter->resume();
+        }
+    }
+};
+
+/**
+ * @brief socket地址：IPv4、IPv6或Unix域（文件路径或Linux抽象命名空间）
+ * 值类型，内部是sockaddr_storage加实际长度，可以直接交给bind/connect/sendmsg；
+ * 构造只做字面量解析，不查询DNS。地址无效时抛出std::invalid_argument。
+ */
+class Endpoint {
+public:
+    Endpoint() = default;  // 空地址，family()为AF_UNSPEC
+
+    // host为空或"0.0.0.0"表示任意地址
+    static Endpoint ipv4(const std::string& host, uint16_t port);
+    // host为空或"::"表示任意地址；接受方括号和"%接口名/序号"形式的scope
+    static Endpoint ipv6(const std::string& host, uint16_t port);
+    // 按字面量选择IPv4或IPv6
+    static Endpoint ip(const std::string& host, uint16_t port);
+    // 文件系统中的Unix域socket，bind时路径不能已存在
+    static Endpoint unix_path(const std::string& path);
+    // 抽象命名空间的Unix域socket：不在文件系统中留下文件，随最后一个socket关闭而消失
+    static Endpoint unix_abstract(const std::string& name);
+
+    /**
+     * @brief 解析to_string()的格式："1.2.3.4:80"、"[::1]:80"、"unix:/run/app.sock"、"unix:@name"
+     */
+    static Endpoint parse(const std::string& text);
+
+    // 从内核返回的地址构造
+    static Endpoint from_sockaddr(const sockaddr* addr, socklen_t size);
+
+    int family() const { return storage_.ss_family; }
+    bool is_ip() const { return family() == AF_INET || family() == AF_INET6; }
+    bool is_unix() const { return family() == AF_UNIX; }
+    // 抽象命名空间的Unix域地址
+    bool is_abstract() const;
+
+    // IP地址的端口，Unix域地址为0
+    uint16_t port() const;
+    void set_port(uint16_t port);
+
+    // Unix域地址的路径或抽象名称（不含开头的'\0'）
+    std::string path() const;
+
+    std::string to_string() const;
+
+    const sockaddr* data() const { return reinterpret_cast<const sockaddr*>(&storage_); }
+    sockaddr* data() { return reinterpret_cast<sockaddr*>(&storage_); }
+    socklen_t size() const { return size_; }
+
+    // 供内核写入地址：先把data()/capacity()交给recvmsg/getsockname，再按返回的长度resize
+    static constexpr socklen_t capacity() { return sizeof(sockaddr_storage); }
+    void resize(socklen_t size) { size_ = std::min(size, capacity()); }
+
+    bool operator==(const Endpoint& other) const {
+        return size_ == other.size_ && std::memcmp(&storage_, &other.storage_, size_) == 0;
+    }
+
+private:
+    sockaddr_storage storage_{};
+    socklen_t size_{0};
 };
 
 /**
  * @brief 异步Socket封装
  * 提供非阻塞Socket操作的协程接口
+ * read/write/accept/connect/receive返回等待器，直接co_await；同一方向同时只能有一个等待者。
+ * io_uring模式下操作完成前传入的缓冲区必须保持有效。
  */
 class Socket {
 private:
+    friend class UdpSocket;
+    friend class BufferedReader;
+
     int fd_{-1};
     EventLoop* loop_{nullptr};
     bool connected_{false};
-    
+    std::shared_ptr<SocketIoState> io_;  // 单独分配，Socket移动后事件回调中的指针仍然有效；超时定时器持有弱引用
+
+    // 等待器公共部分
+    // epoll模式：就绪位为真时先尝试系统调用，EAGAIN时登记到对应方向并挂起；
+    // io_uring模式：总是挂起，由await_suspend提交请求
+    class IoAwaiterBase : public IoWaiter {
+    public:
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            socket_->wait(this, write_side_);
+        }
+
+    protected:
+        IoAwaiterBase(Socket* socket, bool write_side) : socket_(socket), write_side_(write_side) {}
+
+        bool try_now() {
+            if (socket_->uses_uring()) {
+                return false;
+            }
+            SocketIoState& io = *socket_->io_;
+            return (write_side_ ? io.write_ready : io.read_ready) && retry();
+        }
+
+        // 把io_uring的结果拆成字节数或错误码
+        bool take_result(int result, ssize_t& out) {
+            if (result < 0) {
+                error = -result;
+            } else {
+                out = result;
+            }
+            return true;
+        }
+
+        void throw_if_failed(const char* what) const;
+
+        Socket* socket_;
+        bool write_side_;
+    };
+
+public:
+    class ReadAwaiter : public IoAwaiterBase {
+    public:
+        ReadAwaiter(Socket* socket, char* buffer, size_t size, int timeout = -1)
+            : IoAwaiterBase(socket, false), buffer_(buffer), size_(size) { timeout_ms = timeout; }
+        bool await_ready() { return try_now(); }
+        ssize_t await_resume() { throw_if_failed("Read failed"); return result_; }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override { return take_result(result, result_); }
+
+    private:
+        char* buffer_;
+        size_t size_;
+        ssize_t result_{0};
+    };
+
+    class WriteAwaiter : public IoAwaiterBase {
+    public:
+        WriteAwaiter(Socket* socket, const char* data, size_t size)
+            : IoAwaiterBase(socket, true), data_(data), size_(size) {}
+        bool await_ready() { return try_now(); }
+        ssize_t await_resume() { throw_if_failed("Write failed"); return result_; }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override { return take_result(result, result_); }
+
+    private:
+        const char* data_;
+        size_t size_;
+        ssize_t result_{0};
+    };
+
+    // 读取到IOBuf；io_uring模式下由内核从事件循环的接收缓冲区组中挑选缓冲区，不复制
+    class ReceiveAwaiter : public IoAwaiterBase {
+    public:
+        ReceiveAwaiter(Socket* socket, size_t max_size)
+            : IoAwaiterBase(socket, false), max_size_(max_size) {}
+        bool await_ready() { return try_now(); }
+        IOBuf await_resume() { throw_if_failed("Receive failed"); return std::move(buffer_); }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t flags) override;
+
+    private:
+        size_t max_size_;
+        IOBuf buffer_;
+        bool use_buffer_ring_{true};
+    };
+
+private:
+    // 没有对应io_uring请求的操作（recvmmsg/sendmmsg、零拷贝发送）：先直接做非阻塞系统调用，
+    // EAGAIN时epoll模式等待就绪事件，io_uring模式提交POLL_ADD，就绪后在完成回调里重试
+    class PolledAwaiterBase : public IoAwaiterBase {
+    public:
+        bool await_ready() { return retry(); }
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override;
+
+    protected:
+        PolledAwaiterBase(Socket* socket, bool write_side) : IoAwaiterBase(socket, write_side) {}
+        virtual uint32_t poll_events() const;
+    };
+
+    // MSG_PEEK读取，数据留在内核缓冲区里（read_line用来避免读过行尾）
+    class PeekAwaiter : public PolledAwaiterBase {
+    public:
+        PeekAwaiter(Socket* socket, char* buffer, size_t size)
+            : PolledAwaiterBase(socket, false), buffer_(buffer), size_(size) {}
+        ssize_t await_resume() { throw_if_failed("Read failed"); return result_; }
+        bool retry() override;
+
+    private:
+        char* buffer_;
+        size_t size_;
+        ssize_t result_{0};
+    };
+
 public:
+    // 分散读；iovec数组和缓冲区在操作完成前必须保持有效
+    class ReadvAwaiter : public IoAwaiterBase {
+    public:
+        ReadvAwaiter(Socket* socket, std::span<const iovec> iov);
+        bool await_ready() { return try_now(); }
+        ssize_t await_resume() { throw_if_failed("Readv failed"); return result_; }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override { return take_result(result, result_); }
+
+    private:
+        msghdr msg_{};
+        size_t size_{0};
+        ssize_t result_{0};
+    };
+
+    // 聚集写，一次sendmsg写出多段数据；可能只写出一部分
+    class WritevAwaiter : public IoAwaiterBase {
+    public:
+        WritevAwaiter(Socket* socket, std::span<const iovec> iov);
+        bool await_ready() { return try_now(); }
+        ssize_t await_resume() { throw_if_failed("Writev failed"); return result_; }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override { return take_result(result, result_); }
+
+    private:
+        msghdr msg_{};
+        size_t size_{0};
+        ssize_t result_{0};
+    };
+
+    // MSG_ZEROCOPY发送全部数据，co_await返回时内核已不再引用这些缓冲区；
+    // socket不支持SO_ZEROCOPY时退化为普通发送
+    class ZeroCopyAwaiter : public PolledAwaiterBase {
+    public:
+        ZeroCopyAwaiter(Socket* socket, std::span<const iovec> iov);
+        size_t await_resume() { throw_if_failed("Zero-copy send failed"); return sent_; }
+        bool retry() override;
+
+    protected:
+        uint32_t poll_events() const override;
+
+    private:
+        bool send_remaining();
+        void drain_notifications();
+
+        std::vector<iovec> iov_;  // 未发送的部分
+        size_t next_{0};          // iov_中第一个未发完的段
+        size_t sent_{0};
+        bool sending_{true};
+    };
+
+    // recvmmsg/sendmmsg：一次系统调用收发多个数据报，返回处理的消息数
+    class MmsgAwaiter : public PolledAwaiterBase {
+    public:
+        MmsgAwaiter(Socket* socket, std::span<mmsghdr> messages, bool send)
+            : PolledAwaiterBase(socket, send), messages_(messages) {}
+        int await_resume() { throw_if_failed(write_side_ ? "Sendmmsg failed" : "Recvmmsg failed"); return result_; }
+        bool retry() override;
+
+    private:
+        std::span<mmsghdr> messages_;
+        int result_{0};
+    };
+
+    // sendfile：文件内容由内核直接发往socket，不经过用户态；发送count字节或到文件末尾为止
+    class SendfileAwaiter : public PolledAwaiterBase {
+    public:
+        SendfileAwaiter(Socket* socket, int file_fd, off_t offset, size_t count)
+            : PolledAwaiterBase(socket, true), file_fd_(file_fd), offset_(offset), remaining_(count) {}
+        size_t await_resume() { throw_if_failed("Sendfile failed"); return sent_; }
+        bool retry() override;
+
+    private:
+        int file_fd_;
+        off_t offset_;
+        size_t remaining_;
+        size_t sent_{0};
+    };
+
+    // 经管道splice到另一个socket，数据不进入用户态；转发count字节或到源端关闭为止。
+    // 按需要在源socket的读方向和目标socket的写方向之间切换等待
+    class SpliceAwaiter : public PolledAwaiterBase {
+    public:
+        SpliceAwaiter(Socket* source, Socket* dest, size_t count)
+            : PolledAwaiterBase(source, false), source_(source), dest_(dest), remaining_(count) {}
+        ~SpliceAwaiter();
+        SpliceAwaiter(const SpliceAwaiter&) = delete;
+        SpliceAwaiter& operator=(const SpliceAwaiter&) = delete;
+        size_t await_resume() { throw_if_failed("Splice failed"); return moved_; }
+        bool retry() override;
+
+    private:
+        bool wait_on(Socket* target, bool write_side);
+
+        Socket* source_;
+        Socket* dest_;
+        size_t remaining_;
+        size_t moved_{0};
+        size_t buffered_{0};  // 已进入管道、尚未写到目标的字节
+        int pipe_[2]{-1, -1};
+        bool eof_{false};
+    };
+
+    class AcceptAwaiter : public IoAwaiterBase {
+    public:
+        explicit AcceptAwaiter(Socket* socket) : IoAwaiterBase(socket, false), loop_(socket->loop_) {}
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            socket_->wait_accept(this);
+        }
+        std::unique_ptr<Socket> await_resume();
+        bool retry() override;
+        bool complete(int result, uint32_t) override;
+
+    private:
+        EventLoop* loop_;
+        int client_fd_{-1};
+    };
+
+    class ConnectAwaiter : public IoAwaiterBase {
+    public:
+        ConnectAwaiter(Socket* socket, const Endpoint& addr, bool done, int error)
+            : IoAwaiterBase(socket, true), addr_(addr), done_(done) { this->error = error; }
+        bool await_ready() const { return done_; }
+        void await_resume() { throw_if_failed("Connect failed"); }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override;
+
+    private:
+        Endpoint addr_;
+        bool done_;
+    };
+    
+    // 创建AF_INET的TCP socket
     explicit Socket(EventLoop* loop);
+    // 指定地址族和类型，如Socket(loop, AF_INET6)、Socket(loop, AF_UNIX)
+    Socket(EventLoop* loop, int family, int type = SOCK_STREAM);
     Socket(int fd, EventLoop* loop);
     ~Socket();
     
@@ -170,20 +703,38 @@ public:
     
     /**
      * @brief 连接到远程地址
-     * @param host 主机地址
+     * @param host 主机地址（IPv4或IPv6字面量，需与socket的地址族一致）
      * @param port 端口号
      * @return 协程任务
      */
-    Task<void> connect(const std::string& host, uint16_t port);
+    ConnectAwaiter connect(const std::string& host, uint16_t port);
+    
+    /**
+     * @brief 连接到远程地址
+     * @param endpoint 地址，地址族需与socket一致
+     * @return 协程任务
+     */
+    ConnectAwaiter connect(const Endpoint& endpoint);
     
     /**
      * @brief 绑定到本地地址
-     * @param host 本地地址
+     * @param host 本地地址（IPv4或IPv6字面量，需与socket的地址族一致）
      * @param port 端口号
      * @return 是否成功
      */
     bool bind(const std::string& host, uint16_t port);
     
+    /**
+     * @brief 绑定到本地地址
+     * @param endpoint 地址，地址族需与socket一致
+     * @return 是否成功
+     */
+    bool bind(const Endpoint& endpoint);
+    
+    // 本端/对端地址（getsockname/getpeername），失败时返回空地址
+    Endpoint local_endpoint() const;
+    Endpoint peer_endpoint() const;
+    
     /**
      * @brief 开始监听连接
      * @param backlog 连接队列大小
@@ -195,7 +746,7 @@ public:
      * @brief 接受新连接
      * @return 新连接的Socket
      */
-    Task<std::unique_ptr<Socket>> accept();
+    AcceptAwaiter accept();
     
     /**
      * @brief 异步读取数据
@@ -203,7 +754,21 @@ public:
      * @param size 最大读取字节数
      * @return 实际读取的字节数
      */
-    Task<ssize_t> read(char* buffer, size_t size);
+    ReadAwaiter read(char* buffer, size_t size);
+    
+    /**
+     * @brief 带超时的异步读取
+     * io_uring模式使用链接超时(IORING_OP_LINK_TIMEOUT)，epoll模式使用事件循环定时器
+     * @param timeout 超时时间，超时抛出std::runtime_error（ETIMEDOUT）
+     */
+    ReadAwaiter read(char* buffer, size_t size, std::chrono::milliseconds timeout);
+    
+    /**
+     * @brief 异步读取到IOBuf
+     * @param max_size 最多读取的字节数（io_uring模式还受接收缓冲区大小限制）
+     * @return 读到的数据，为空表示对端关闭
+     */
+    ReceiveAwaiter receive(size_t max_size = EventLoop::RECV_BUFFER_SIZE);
     
     /**
      * @brief 异步写入数据
@@ -211,10 +776,57 @@ public:
      * @param size 数据大小
      * @return 实际写入的字节数
      */
-    Task<ssize_t> write(const char* data, size_t size);
+    WriteAwaiter write(const char* data, size_t size);
+    
+    /**
+     * @brief 分散读取到多个缓冲区（最多IOV_MAX段）
+     * @return 实际读取的字节数，0表示对端关闭
+     */
+    ReadvAwaiter readv(std::span<const iovec> iov);
+    
+    /**
+     * @brief 聚集写：一次系统调用写出多个缓冲区，不需要先拼接（最多IOV_MAX段）
+     * @return 实际写入的字节数，可能小于总长度
+     */
+    WritevAwaiter writev(std::span<const iovec> iov);
     
     /**
-     * @brief 读取一行数据（以\n结尾）
+     * @brief 以MSG_ZEROCOPY发送全部数据，适合大块数据
+     * 返回前等待内核的完成通知，之后缓冲区可以复用；不支持时（如AF_UNIX）按普通方式发送
+     * @return 发送的字节数
+     */
+    ZeroCopyAwaiter send_zerocopy(std::span<const iovec> iov);
+    
+    /**
+     * @brief 批量接收数据报（recvmmsg），每个mmsghdr的msg_len为收到的长度
+     * @return 收到的消息数
+     */
+    MmsgAwaiter recv_many(std::span<mmsghdr> messages);
+    
+    /**
+     * @brief 批量发送数据报（sendmmsg）
+     * @return 发出的消息数
+     */
+    MmsgAwaiter send_many(std::span<mmsghdr> messages);
+    
+    /**
+     * @brief 把文件的[offset, offset+count)直接发送到socket（sendfile），处理EAGAIN和部分发送
+     * @param file_fd 文件描述符，操作完成前必须保持打开
+     * @return 发送的字节数，文件提前结束时小于count
+     */
+    SendfileAwaiter sendfile(int file_fd, off_t offset, size_t count);
+    
+    /**
+     * @brief 把本socket读到的数据经管道splice到dest，用于代理转发
+     * @param count 最多转发的字节数，默认直到本端读到EOF
+     * @return 转发的字节数
+     */
+    SpliceAwaiter splice_to(Socket& dest, size_t count = SIZE_MAX);
+    
+    /**
+     * @brief 读取一行数据（以\n结尾），不会读走行尾之后的数据
+     * 先MSG_PEEK查看内核缓冲区中的数据再按行尾读取，每行两次系统调用；
+     * 需要连续读取多行时使用BufferedReader
      * @return 读取的字符串
      */
     Task<std::string> read_line();
@@ -238,6 +850,13 @@ public:
      */
     void close();
     
+    /**
+     * @brief 交出fd的所有权，Socket变为已关闭状态
+     * 用于把连接交给其他事件循环；不能有挂起的操作
+     * @return 文件描述符
+     */
+    int release();
+    
     /**
      * @brief 获取文件描述符
      * @return 文件描述符
@@ -259,22 +878,142 @@ public:
 
 private:
     void make_non_blocking();
-    sockaddr_in create_address(const std::string& host, uint16_t port);
+    bool uses_uring() const { return loop_ && loop_->backend() == IoBackend::IO_URING; }
+    void register_with_loop();
+    void wait(IoWaiter* waiter, bool write_side);
+    void wait_accept(IoWaiter* waiter);
+    void cancel_waiters();
+};
+
+/**
+ * @brief socket上的缓冲读取器，面向行协议（Redis RESP、文本RPC）
+ * 数据读进一块连续缓冲区，每次尽量读满空闲空间；分隔符用memchr从上次扫描到的位置继续查找，
+ * 不重复扫描已经看过的数据。返回的string_view指向缓冲区内部，在下一次读取操作前有效。
+ * 缓冲区只在尾部空间不足时把未消费的数据移到开头或扩容，行长度受max_line限制。
+ * 与Socket的其他读操作不能混用：已读进缓冲区的数据只能通过本对象取得。
+ */
+class BufferedReader {
+public:
+    static constexpr size_t DEFAULT_MAX_LINE = 64 * 1024;
+
+    // 读到分隔符为止，返回的行包含分隔符；EOF时返回剩余的数据，没有数据时为空
+    class LineAwaiter : public Socket::PolledAwaiterBase {
+    public:
+        LineAwaiter(BufferedReader* reader, char delimiter);
+        std::string_view await_resume() { throw_if_failed("Read line failed"); return result_; }
+        bool retry() override;
+
+    private:
+        BufferedReader* reader_;
+        char delimiter_;
+        std::string_view result_;
+    };
+
+    // 读满size字节，EOF时返回的数据可能不足size
+    class ExactAwaiter : public Socket::PolledAwaiterBase {
+    public:
+        ExactAwaiter(BufferedReader* reader, size_t size);
+        std::string_view await_resume() { throw_if_failed("Read failed"); return result_; }
+        bool retry() override;
+
+    private:
+        BufferedReader* reader_;
+        size_t size_;
+        std::string_view result_;
+    };
+
+    /**
+     * @param socket 数据来源，生命周期长于读取器
+     * @param max_line 最大行长度（含分隔符），超过时read_line以EMSGSIZE失败
+     */
+    explicit BufferedReader(Socket& socket, size_t max_line = DEFAULT_MAX_LINE);
+
+    BufferedReader(const BufferedReader&) = delete;
+    BufferedReader& operator=(const BufferedReader&) = delete;
+
+    /**
+     * @brief 读取一行
+     * @param delimiter 行分隔符；RESP等以\r\n结尾的协议用'\n'，再去掉结尾的'\r'
+     */
+    LineAwaiter read_line(char delimiter = '\n');
+
+    /**
+     * @brief 读取size字节，先取缓冲区中已有的数据
+     */
+    ExactAwaiter read_exactly(size_t size);
+
+    // 已读进缓冲区、尚未返回的数据
+    std::string_view buffered() const { return {buffer_.get() + begin_ + pending_, end_ - begin_ - pending_}; }
+
+    size_t max_line() const { return max_line_; }
+    void set_max_line(size_t max_line) { max_line_ = max_line; }
+
+private:
+    // 释放上一次返回的数据
+    void consume();
+    // 从socket读一次到缓冲区尾部，需要时先移动数据或扩容；返回值同read()
+    ssize_t fill(size_t wanted);
+    std::string_view take(size_t size);
+
+    Socket* socket_;
+    size_t max_line_;
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_{0};
+    size_t begin_{0};    // 未消费数据的起点
+    size_t end_{0};      // 已读入数据的终点
+    size_t scan_{0};     // [begin_, scan_)中没有scan_delimiter_
+    size_t pending_{0};  // 上次返回、下次操作时才释放的字节数
+    char scan_delimiter_{'\n'};
+};
+
+// TcpServer的reactor配置
+struct TcpServerOptions {
+    // 新连接分配到reactor的方式
+    enum class Balance {
+        REUSE_PORT,    // 每个reactor一个SO_REUSEPORT监听socket，由内核按四元组哈希分配
+        ROUND_ROBIN,   // reactor 0上的单个acceptor依次交给各reactor
+        LEAST_LOADED   // reactor 0上的单个acceptor交给当前连接数最少的reactor
+    };
+
+    size_t reactors{0};                               // reactor线程数，0表示在构造时传入的事件循环上运行
+    Balance balance{Balance::REUSE_PORT};
+    IoBackend backend{EventLoop::default_backend()};  // reactor线程事件循环的后端
 };
 
 /**
  * @brief TCP服务器
  * 高性能异步TCP服务器实现
+ * reactors为0时accept和所有连接都在传入的事件循环上，由调用者驱动；
+ * reactors>0时启动N个线程，每个线程一个事件循环，连接在整个生命周期内固定在分到的reactor上。
  */
 class TcpServer {
 private:
+    // 一个事件循环及其上的监听socket和连接协程
+    // 由shared_ptr持有，回收定时器只保留弱引用
+    struct Reactor : std::enable_shared_from_this<Reactor> {
+        EventLoop* loop{nullptr};
+        std::unique_ptr<EventLoop> owned_loop;   // reactor线程自己的事件循环
+        std::thread thread;
+        std::unique_ptr<Socket> listener;
+        std::optional<Task<void>> accept_task;
+        std::vector<Task<void>> connections;     // 只在所属事件循环的线程上访问
+        std::chrono::steady_clock::time_point next_reap;
+        bool reap_scheduled{false};              // 已有定时器负责补上被跳过的回收
+        std::atomic<size_t> active{0};           // 已分配且未结束的连接数
+    };
+
     EventLoop* loop_;
-    std::unique_ptr<Socket> listen_socket_;
+    TcpServerOptions options_;
+    std::vector<std::shared_ptr<Reactor>> reactors_;
     std::function<Task<void>(std::unique_ptr<Socket>)> connection_handler_;
     std::atomic<bool> running_{false};
+    uint16_t port_{0};
+    Endpoint endpoint_;       // 实际监听的地址
+    bool reuse_port_{false};  // 每个reactor各自监听
+    size_t next_reactor_{0};
     
 public:
-    explicit TcpServer(EventLoop* loop);
+    explicit TcpServer(EventLoop* loop, TcpServerOptions options = {});
     ~TcpServer();
     
     /**
@@ -289,13 +1028,21 @@ public:
     /**
      * @brief 开始监听
      * @param host 监听地址
-     * @param port 监听端口
+     * @param port 监听端口，0表示由系统分配（见port()）
      * @return 协程任务
      */
     Task<void> listen(const std::string& host, uint16_t port);
     
     /**
-     * @brief 停止服务器
+     * @brief 在指定地址上监听，支持IPv6和Unix域地址
+     * Unix域地址不支持SO_REUSEPORT分流，REUSE_PORT时按ROUND_ROBIN处理；
+     * 文件路径地址在bind前不能已存在，stop()时删除
+     * @return 协程任务
+     */
+    Task<void> listen(const Endpoint& endpoint);
+    
+    /**
+     * @brief 停止服务器：关闭监听socket，等待reactor线程退出
      */
     void stop();
     
@@ -304,9 +1051,29 @@ public:
      * @return 是否运行中
      */
     bool is_running() const { return running_.load(std::memory_order_acquire); }
+    
+    /**
+     * @brief 实际监听的端口，Unix域地址为0
+     */
+    uint16_t port() const { return port_; }
+    
+    /**
+     * @brief 实际监听的地址
+     */
+    const Endpoint& endpoint() const { return endpoint_; }
+    
+    /**
+     * @brief 各reactor当前的连接数
+     */
+    std::vector<size_t> reactor_loads() const;
 
 private:
-    Task<void> accept_loop();
+    void start(Endpoint endpoint);
+    Task<void> accept_loop(Reactor& reactor);
+    void run_reactor(Reactor& reactor);
+    void dispatch(Reactor& acceptor, std::unique_ptr<Socket> client);
+    Reactor& pick_reactor();
+    static void reap(Reactor& reactor);
 };
 
 /**
@@ -316,17 +1083,17 @@ private:
 class TcpConnection {
 private:
     std::unique_ptr<Socket> socket_;
-    std::string read_buffer_;
-    std::string write_buffer_;
+    BufferedReader reader_;
+    IOBuf write_queue_;  // 待发送的数据块，flush时一次writev
     bool closed_{false};
     
 public:
-    explicit TcpConnection(std::unique_ptr<Socket> socket);
+    explicit TcpConnection(std::unique_ptr<Socket> socket, size_t max_line = BufferedReader::DEFAULT_MAX_LINE);
     ~TcpConnection();
     
     /**
-     * @brief 读取一行
-     * @return 读取的字符串
+     * @brief 读取一行（包含\n），超过最大行长度时抛出异常
+     * @return 读取的字符串；需要避免复制时直接使用reader().read_line()
      */
     Task<std::string> read_line();
     
@@ -338,14 +1105,20 @@ public:
     Task<std::string> read(size_t size);
     
     /**
-     * @brief 写入数据
+     * @brief 写入数据（复制到发送队列，flush时发送）
      * @param data 要写入的数据
      * @return 协程任务
      */
     Task<void> write(const std::string& data);
     
     /**
-     * @brief 刷新写缓冲区
+     * @brief 把数据块链接到发送队列，不复制
+     * @param data 要写入的数据
+     */
+    void write(IOBuf data);
+    
+    /**
+     * @brief 发送队列中的所有数据：各块用一次writev写出，不拼接
      * @return 协程任务
      */
     Task<void> flush();
@@ -366,6 +1139,145 @@ public:
      * @return Socket指针
      */
     Socket* socket() { return socket_.get(); }
+    
+    /**
+     * @brief 连接的读缓冲区，返回指向缓冲区内部的视图
+     */
+    BufferedReader& reader() { return reader_; }
+};
+
+/**
+ * @brief 异步UDP socket
+ * recv_from/send_to收发单个数据报（io_uring模式以RECVMSG/SENDMSG提交），
+ * recv_many/send_many一次recvmmsg/sendmmsg批量收发。
+ * 内核支持UDP GSO时，send_many把发往同一地址、长度相同的连续数据报合并成一条消息由内核切分；
+ * enable_gro()之后，内核可能把同一来源的多个数据报合并到recv_many的一个缓冲区里，按segment_size切分。
+ * 同一方向同时只能有一个等待者。
+ */
+class UdpSocket {
+public:
+    // 批量收发的一个数据报
+    struct Datagram {
+        char* data{nullptr};
+        size_t capacity{0};         // 接收时缓冲区大小；开启GRO时应为64KB
+        size_t size{0};             // 发送时的长度；接收后为收到的字节数
+        Endpoint peer;              // 发送时的目标地址；接收后为来源地址
+        uint16_t segment_size{0};   // 接收后：GRO合并了多个数据报时为每个数据报的长度（最后一个可能更短），否则为0
+    };
+
+    // 收发单个数据报；地址和缓冲区在操作完成前必须保持有效
+    class MessageAwaiter : public Socket::IoAwaiterBase {
+    public:
+        MessageAwaiter(Socket* socket, const char* data, size_t size, Endpoint* peer, bool send);
+        bool await_ready() { return try_now(); }
+        ssize_t await_resume() { throw_if_failed(write_side_ ? "Sendto failed" : "Recvfrom failed"); return result_; }
+        bool retry() override;
+        void prepare(io_uring_sqe* sqe) override;
+        bool complete(int result, uint32_t) override;
+
+    private:
+        Endpoint* peer_;
+        iovec iov_;
+        msghdr msg_{};
+        ssize_t result_{0};
+    };
+
+    // recvmmsg批量接收，返回收到的数据报数
+    class RecvBatchAwaiter : public Socket::PolledAwaiterBase {
+    public:
+        RecvBatchAwaiter(UdpSocket* udp, std::span<Datagram> datagrams);
+        int await_resume() { throw_if_failed("Recvmmsg failed"); return result_; }
+        bool retry() override;
+
+    private:
+        UdpSocket* udp_;
+        std::span<Datagram> datagrams_;
+        int result_{0};
+    };
+
+    // sendmmsg批量发送，返回已发出的数据报数；少于请求数时调用者继续发送剩余部分
+    class SendBatchAwaiter : public Socket::PolledAwaiterBase {
+    public:
+        SendBatchAwaiter(UdpSocket* udp, std::span<const Datagram> datagrams);
+        int await_resume() { throw_if_failed("Sendmmsg failed"); return result_; }
+        bool retry() override;
+
+    private:
+        void build();
+
+        UdpSocket* udp_;
+        std::span<const Datagram> datagrams_;
+        int result_{0};
+    };
+
+    // family为AF_INET或AF_INET6
+    explicit UdpSocket(EventLoop* loop, int family = AF_INET);
+
+    /**
+     * @brief 绑定地址
+     * @param host 主机地址
+     * @param port 端口，0表示由内核分配
+     * @return 是否成功
+     */
+    bool bind(const std::string& host, uint16_t port);
+    bool bind(const Endpoint& endpoint) { return socket_.bind(endpoint); }
+
+    // 绑定后的本地地址和端口
+    Endpoint local_endpoint() const { return socket_.local_endpoint(); }
+    uint16_t local_port() const { return local_endpoint().port(); }
+
+    /**
+     * @brief 接收一个数据报
+     * @param from 写入来源地址
+     * @return 数据报长度，超过size的部分被丢弃
+     */
+    MessageAwaiter recv_from(char* buffer, size_t size, Endpoint& from);
+
+    /**
+     * @brief 发送一个数据报
+     * @return 发送的字节数
+     */
+    MessageAwaiter send_to(const char* data, size_t size, const Endpoint& to);
+
+    /**
+     * @brief 批量接收，至少收到一个数据报时返回
+     * @return 收到的数据报数，datagrams的前若干项被填写
+     */
+    RecvBatchAwaiter recv_many(std::span<Datagram> datagrams);
+
+    /**
+     * @brief 批量发送
+     * @return 发出的数据报数
+     */
+    SendBatchAwaiter send_many(std::span<const Datagram> datagrams);
+
+    /**
+     * @brief 开启UDP GRO（内核5.0+）
+     * @return 内核是否支持
+     */
+    bool enable_gro();
+
+    // send_many是否使用UDP GSO（内核4.18+，在构造时探测）
+    bool gso_enabled() const { return gso_; }
+
+    int fd() const { return socket_.fd(); }
+    Socket& socket() { return socket_; }
+    void close() { socket_.close(); }
+
+private:
+    Socket socket_;
+    bool gso_{false};
+    bool gro_{false};
+
+    // 批量收发的mmsghdr/iovec/控制消息，跨调用复用（每个方向同时只有一个等待者）
+    struct Batch {
+        std::vector<mmsghdr> messages;
+        std::vector<iovec> iov;
+        std::vector<char> control;
+        std::vector<size_t> first;  // 发送：每条消息对应的第一个数据报
+    };
+    Batch recv_batch_;
+    Batch send_batch_;
 };
 
 // 全局事件循环实例
@@ -1,36 +1,190 @@
 #pragma once
-#include <vector>
-#include <stack>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
-#include <mutex>
+#include "lockfree.h"
 
 namespace flowcoro {
 
+// 对象归还池时的重置钩子
+// 默认只调用对象显式提供的pool_reset()，否则不做任何处理：
+// 通用的reset()/clear()对unique_ptr、shared_ptr、optional等类型意味着销毁内容，不能隐式调用。
+// 其他类型需要重置时特化本模板
 template<typename T>
+struct ObjectPoolTraits {
+    static void reset(T& obj) {
+        if constexpr (requires { obj.pool_reset(); }) {
+            obj.pool_reset();
+        }
+    }
+};
+
+// 对象池
+// 每个线程缓存少量对象，批量与全局无锁仓库(BoundedQueue)交换；
+// 全局仓库最多保留MaxRetained个对象，超出的直接销毁，池不会无限增长。
+template<typename T, size_t MaxRetained = 1024>
 class ObjectPool {
 public:
-    ObjectPool(size_t initial = 16) {
-        for (size_t i = 0; i < initial; ++i) {
-            pool.push(std::make_unique<T>());
+    explicit ObjectPool(size_t initial = 16)
+        : depot_(std::make_shared<Depot>()) {
+        for (size_t i = 0; i < std::min(initial, MaxRetained); ++i) {
+            T* obj = new T();
+            if (!depot_->objects.try_push(obj)) {
+                delete obj;
+                break;
+            }
         }
     }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
     std::unique_ptr<T> acquire() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (pool.empty()) {
-            return std::make_unique<T>();
+        if (CacheSlot* slot = local_slot()) {
+            if (slot->count == 0) {
+                slot->count = depot_->objects.try_pop_bulk(slot->objects, TRANSFER_BATCH);
+            }
+            if (slot->count > 0) {
+                depot_->hits.fetch_add(1, std::memory_order_relaxed);
+                return std::unique_ptr<T>(slot->objects[--slot->count]);
+            }
         } else {
-            auto obj = std::move(pool.top());
-            pool.pop();
-            return obj;
+            T* obj = nullptr;
+            if (depot_->objects.try_pop(obj)) {
+                depot_->hits.fetch_add(1, std::memory_order_relaxed);
+                return std::unique_ptr<T>(obj);
+            }
         }
+        depot_->misses.fetch_add(1, std::memory_order_relaxed);
+        return std::make_unique<T>();
     }
+
     void release(std::unique_ptr<T> obj) {
-        std::lock_guard<std::mutex> lock(mtx);
-        pool.push(std::move(obj));
+        if (!obj) return;
+        ObjectPoolTraits<T>::reset(*obj);
+
+        if (CacheSlot* slot = local_slot()) {
+            if (slot->count == CACHE_SIZE) {
+                flush(*slot, TRANSFER_BATCH);
+            }
+            slot->objects[slot->count++] = obj.release();
+            return;
+        }
+        if (depot_->objects.try_push(obj.get())) {
+            obj.release();
+        } else {
+            depot_->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 将当前线程缓存的对象归还全局仓库
+    void flush_thread_cache() {
+        if (CacheSlot* slot = local_slot()) {
+            flush(*slot, slot->count);
+        }
     }
+
+    // 统计信息
+    struct PoolStats {
+        size_t hits;      // 从池中取得对象的次数
+        size_t misses;    // 池为空而新建对象的次数
+        size_t retained;  // 全局仓库中的对象数（不含线程缓存）
+        size_t dropped;   // 仓库已满而销毁的对象数
+        double hit_rate;
+    };
+
+    PoolStats get_stats() const {
+        size_t hits = depot_->hits.load(std::memory_order_relaxed);
+        size_t misses = depot_->misses.load(std::memory_order_relaxed);
+        size_t total = hits + misses;
+        return {
+            hits,
+            misses,
+            depot_->objects.size_approx(),
+            depot_->dropped.load(std::memory_order_relaxed),
+            total > 0 ? static_cast<double>(hits) / total : 0.0
+        };
+    }
+
+    static constexpr size_t max_retained() { return MaxRetained; }
+
 private:
-    std::stack<std::unique_ptr<T>> pool;
-    std::mutex mtx;
+    static constexpr size_t CACHE_SIZE = 32;
+    static constexpr size_t TRANSFER_BATCH = CACHE_SIZE / 2;
+    static constexpr size_t CACHE_SLOTS = 4;
+
+    // 全局仓库；线程缓存持有其shared_ptr，池先于线程销毁时缓存仍可安全归还
+    struct Depot {
+        lockfree::BoundedQueue<T*, MaxRetained> objects;
+        alignas(64) std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> dropped{0};
+
+        ~Depot() {
+            T* obj = nullptr;
+            while (objects.try_pop(obj)) {
+                delete obj;
+            }
+        }
+    };
+
+    struct CacheSlot {
+        std::shared_ptr<Depot> depot;
+        T* objects[CACHE_SIZE];
+        size_t count = 0;
+    };
+
+    struct ThreadCaches {
+        CacheSlot slots[CACHE_SLOTS];
+        size_t next_victim = 0;
+
+        ~ThreadCaches() {
+            for (auto& slot : slots) {
+                if (slot.depot) {
+                    flush(slot, slot.count);
+                }
+            }
+            tls_exited_ = true;
+        }
+    };
+
+    CacheSlot* local_slot() {
+        if (tls_exited_) return nullptr;
+        ThreadCaches& caches = tls_caches_;
+        CacheSlot* empty = nullptr;
+        for (auto& slot : caches.slots) {
+            if (slot.depot == depot_) return &slot;
+            if (!slot.depot && !empty) empty = &slot;
+        }
+        if (!empty) {
+            // 槽位用尽时轮换淘汰
+            empty = &caches.slots[caches.next_victim++ % CACHE_SLOTS];
+            flush(*empty, empty->count);
+        }
+        empty->depot = depot_;
+        empty->count = 0;
+        return empty;
+    }
+
+    // 把缓存顶部的count个对象归还仓库，仓库已满的部分直接销毁
+    static void flush(CacheSlot& slot, size_t count) {
+        count = std::min(count, slot.count);
+        T** first = slot.objects + (slot.count - count);
+        size_t pushed = slot.depot->objects.try_push_bulk(first, count);
+        for (size_t i = pushed; i < count; ++i) {
+            delete first[i];
+        }
+        if (pushed < count) {
+            slot.depot->dropped.fetch_add(count - pushed, std::memory_order_relaxed);
+        }
+        slot.count -= count;
+    }
+
+    std::shared_ptr<Depot> depot_;
+
+    static inline thread_local ThreadCaches tls_caches_;
+    static inline thread_local bool tls_exited_ = false;
 };
 
 } // namespace flowcoro
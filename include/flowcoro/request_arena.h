@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include "core.h"
+
+namespace flowcoro {
+
+// 请求级arena
+// 分配只是指针递增，deallocate为空操作，请求结束时一次性释放全部内存。
+// reset()保留最大的一块内存供下一个请求复用，适合放进ObjectPool按请求循环使用。
+// 非线程安全：同一时刻只应由一个请求（协程链）使用。
+class RequestArena : public std::pmr::memory_resource {
+public:
+    explicit RequestArena(size_t initial_block_size = 4096,
+                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream), next_block_size_(std::max(initial_block_size, MIN_BLOCK_SIZE)) {}
+
+    // 使用调用方提供的初始缓冲区（如栈上数组），用完后再向上游申请
+    RequestArena(void* buffer, size_t size,
+                 std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream),
+          initial_buffer_(static_cast<std::byte*>(buffer)),
+          initial_size_(size),
+          cursor_(static_cast<std::byte*>(buffer)),
+          limit_(static_cast<std::byte*>(buffer) + size),
+          next_block_size_(std::max(size * 2, MIN_BLOCK_SIZE)) {}
+
+    ~RequestArena() override {
+        free_blocks(nullptr);
+    }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // 释放全部内存；已分配对象的析构由调用方负责
+    void release() {
+        free_blocks(nullptr);
+        rewind(nullptr);
+    }
+
+    // 回到初始状态，保留最近申请的（最大的）一块内存
+    void reset() {
+        Block* keep = blocks_;
+        if (keep) {
+            free_blocks(keep);
+            keep->next = nullptr;
+        }
+        rewind(keep);
+    }
+
+    // 统计信息
+    size_t bytes_allocated() const { return bytes_allocated_; }
+    size_t allocation_count() const { return allocation_count_; }
+    size_t block_count() const {
+        size_t count = 0;
+        for (Block* b = blocks_; b; b = b->next) ++count;
+        return count;
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = bump(bytes, alignment);
+        if (!p) {
+            grow(bytes, alignment);
+            p = bump(bytes, alignment);
+        }
+        bytes_allocated_ += bytes;
+        ++allocation_count_;
+        return p;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // 单调分配：内存在release/reset时统一回收
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 256;
+    static constexpr size_t MAX_GROWTH_BLOCK = 1024 * 1024;
+
+    struct Block {
+        Block* next;
+        size_t size;  // 含头部的总字节数
+    };
+
+    static constexpr size_t HEADER_SIZE =
+        (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    void* bump(size_t bytes, size_t alignment) {
+        auto addr = reinterpret_cast<uintptr_t>(cursor_);
+        uintptr_t aligned = (addr + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (!cursor_ || aligned + bytes > reinterpret_cast<uintptr_t>(limit_)) {
+            return nullptr;
+        }
+        cursor_ = reinterpret_cast<std::byte*>(aligned + bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void grow(size_t bytes, size_t alignment) {
+        size_t needed = HEADER_SIZE + bytes + alignment;
+        size_t size = std::max(next_block_size_, needed);
+        void* memory = upstream_->allocate(size, alignof(std::max_align_t));
+        blocks_ = new (memory) Block{blocks_, size};
+        cursor_ = static_cast<std::byte*>(memory) + HEADER_SIZE;
+        limit_ = static_cast<std::byte*>(memory) + size;
+        // 几何增长，单块上限1MiB，超大请求单独成块
+        next_block_size_ = std::min(next_block_size_ * 2, std::max(MAX_GROWTH_BLOCK, next_block_size_));
+    }
+
+    // 释放keep之外的所有块
+    void free_blocks(Block* keep) {
+        Block* b = blocks_;
+        while (b) {
+            Block* next = b->next;
+            if (b != keep) {
+                upstream_->deallocate(b, b->size, alignof(std::max_align_t));
+            }
+            b = next;
+        }
+        blocks_ = keep;
+    }
+
+    void rewind(Block* keep) {
+        if (keep) {
+            cursor_ = reinterpret_cast<std::byte*>(keep) + HEADER_SIZE;
+            limit_ = reinterpret_cast<std::byte*>(keep) + keep->size;
+        } else {
+            cursor_ = initial_buffer_;
+            limit_ = initial_buffer_ ? initial_buffer_ + initial_size_ : nullptr;
+        }
+        bytes_allocated_ = 0;
+        allocation_count_ = 0;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::byte* initial_buffer_ = nullptr;
+    size_t initial_size_ = 0;
+    std::byte* cursor_ = nullptr;
+    std::byte* limit_ = nullptr;
+    Block* blocks_ = nullptr;
+    size_t next_block_size_;
+    size_t bytes_allocated_ = 0;
+    size_t allocation_count_ = 0;
+};
+
+} // namespace flowcoro
@@ -8,18 +8,42 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 
 namespace flowcoro::rpc {
 
 // RPC消息结构
-struct RpcMessage {
-    std::string id;           // 请求ID
-    std::string method;       // 方法名
-    std::string params;       // 参数（JSON格式）
-    std::string result;       // 结果（JSON格式）
-    std::string error;        // 错误信息
+// Allocator为std::pmr::polymorphic_allocator时所有字段从当前协程的arena分配（见pmr::RpcMessage）
+template<typename Allocator = std::allocator<char>>
+struct BasicRpcMessage {
+    using allocator_type = Allocator;
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+
+    string_type id;           // 请求ID
+    string_type method;       // 方法名
+    string_type params;       // 参数（JSON格式）
+    string_type result;       // 结果（JSON格式）
+    string_type error;        // 错误信息
     bool is_request = true;   // 是否为请求
-    
+
+    BasicRpcMessage() : BasicRpcMessage(default_allocator<Allocator>()) {}
+
+    explicit BasicRpcMessage(const allocator_type& alloc)
+        : id(alloc), method(alloc), params(alloc), result(alloc), error(alloc) {}
+
+    BasicRpcMessage(const BasicRpcMessage&) = default;
+    BasicRpcMessage(BasicRpcMessage&&) noexcept = default;
+    BasicRpcMessage& operator=(const BasicRpcMessage&) = default;
+    BasicRpcMessage& operator=(BasicRpcMessage&&) = default;
+
+    // 容器按uses-allocator构造时使用
+    BasicRpcMessage(const BasicRpcMessage& other, const allocator_type& alloc)
+        : id(other.id, alloc), method(other.method, alloc), params(other.params, alloc),
+          result(other.result, alloc), error(other.error, alloc), is_request(other.is_request) {}
+
+    allocator_type get_allocator() const { return id.get_allocator(); }
+
     // 序列化为JSON
     std::string to_json() const {
         std::ostringstream oss;
@@ -41,18 +65,26 @@ struct RpcMessage {
     }
     
     // 从JSON反序列化（简化版本）
-    static RpcMessage from_json(const std::string& json) {
-        RpcMessage msg;
-        
-        // 简单JSON解析（实际项目中应使用专业JSON库）
-        auto extract_field = [&json](const std::string& field) -> std::string {
-            std::string pattern = "\"" + field + "\":\"";
-            size_t start = json.find(pattern);
-            if (start == std::string::npos) return "";
-            start += pattern.length();
-            size_t end = json.find("\"", start);
-            if (end == std::string::npos) return "";
-            return json.substr(start, end - start);
+    static BasicRpcMessage from_json(std::string_view json,
+                                     const allocator_type& alloc = default_allocator<Allocator>()) {
+        BasicRpcMessage msg(alloc);
+        
+        // 简单JSON解析（实际项目中应使用专业JSON库），字段直接引用输入，不产生临时字符串
+        auto extract_field = [json](std::string_view field) -> std::string_view {
+            size_t start = 0;
+            while ((start = json.find(field, start)) != std::string_view::npos) {
+                size_t name_begin = start;
+                start += field.size();
+                if (name_begin == 0 || json[name_begin - 1] != '"' ||
+                    json.substr(start, 3) != "\":\"") {
+                    continue;
+                }
+                start += 3;
+                size_t end = json.find('"', start);
+                if (end == std::string_view::npos) return {};
+                return json.substr(start, end - start);
+            }
+            return {};
         };
         
         msg.id = extract_field("id");
@@ -61,21 +93,27 @@ struct RpcMessage {
         
         // 提取params和result（可能不是字符串）
         size_t params_pos = json.find("\"params\":");
-        if (params_pos != std::string::npos) {
+        if (params_pos != std::string_view::npos) {
             params_pos += 9;
             // 找到params值的结束位置（简化处理）
             size_t comma_pos = json.find(",", params_pos);
-            if (comma_pos != std::string::npos) {
+            if (comma_pos != std::string_view::npos) {
                 msg.params = json.substr(params_pos, comma_pos - params_pos);
             }
         }
         
-        msg.is_request = json.find("\"is_request\":true") != std::string::npos;
+        msg.is_request = json.find("\"is_request\":true") != std::string_view::npos;
         
         return msg;
     }
 };
 
+using RpcMessage = BasicRpcMessage<>;
+
+namespace pmr {
+using RpcMessage = BasicRpcMessage<std::pmr::polymorphic_allocator<char>>;
+}
+
 // RPC处理函数类型
 using RpcHandler = std::function<Task<std::string>(const std::string& params)>;
 
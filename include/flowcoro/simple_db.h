@@ -6,6 +6,8 @@
 #include <fstream>
 #include <mutex>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 #include <chrono>
 #include <sstream>
 #include <filesystem>
@@ -14,24 +16,61 @@
 
 namespace flowcoro::db {
 
+// 字段表的透明哈希：按std::string_view查找，不必为每次查找构造键字符串
+struct FieldKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
 // 简单的JSON-like数据格式
-struct SimpleDocument {
-    std::unordered_map<std::string, std::string> fields;
-    std::string id;
+// Allocator为std::pmr::polymorphic_allocator时字段表从当前协程的arena分配（见pmr::SimpleDocument）
+template<typename Allocator = std::allocator<char>>
+struct BasicSimpleDocument {
+    using allocator_type = Allocator;
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+    using field_map = std::unordered_map<
+        string_type, string_type, FieldKeyHash, std::equal_to<>,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const string_type, string_type>>>;
+
+    field_map fields;
+    string_type id;
     
-    SimpleDocument() = default;
-    SimpleDocument(const std::string& doc_id) : id(doc_id) {}
+    BasicSimpleDocument() : BasicSimpleDocument(default_allocator<Allocator>()) {}
+
+    explicit BasicSimpleDocument(const allocator_type& alloc) : fields(alloc), id(alloc) {}
+
+    BasicSimpleDocument(std::string_view doc_id, const allocator_type& alloc = default_allocator<Allocator>())
+        : fields(alloc), id(doc_id, alloc) {}
+
+    BasicSimpleDocument(const BasicSimpleDocument&) = default;
+    BasicSimpleDocument(BasicSimpleDocument&&) noexcept = default;
+    BasicSimpleDocument& operator=(const BasicSimpleDocument&) = default;
+    BasicSimpleDocument& operator=(BasicSimpleDocument&&) = default;
+
+    BasicSimpleDocument(const BasicSimpleDocument& other, const allocator_type& alloc)
+        : fields(other.fields.begin(), other.fields.end(), other.fields.bucket_count(),
+                 typename field_map::hasher(), typename field_map::key_equal(), alloc),
+          id(other.id, alloc) {}
+
+    allocator_type get_allocator() const { return id.get_allocator(); }
     
-    void set(const std::string& key, const std::string& value) {
-        fields[key] = value;
+    void set(std::string_view key, std::string_view value) {
+        auto it = fields.find(key);
+        if (it != fields.end()) {
+            it->second.assign(value);
+            return;
+        }
+        fields.emplace(string_type(key, get_allocator()), string_type(value, get_allocator()));
     }
     
-    std::string get(const std::string& key, const std::string& default_value = "") const {
+    string_type get(std::string_view key, std::string_view default_value = "") const {
         auto it = fields.find(key);
-        return (it != fields.end()) ? it->second : default_value;
+        return (it != fields.end()) ? it->second : string_type(default_value, get_allocator());
     }
     
-    bool has(const std::string& key) const {
+    bool has(std::string_view key) const {
         return fields.find(key) != fields.end();
     }
     
@@ -47,41 +86,42 @@ struct SimpleDocument {
     }
     
     // 从简单格式反序列化
-    static SimpleDocument deserialize(const std::string& data) {
-        SimpleDocument doc;
+    static BasicSimpleDocument deserialize(std::string_view data,
+                                           const allocator_type& alloc = default_allocator<Allocator>()) {
+        BasicSimpleDocument doc(alloc);
         
         // 简单的JSON解析（仅支持字符串字段）
         size_t start = data.find("{");
         size_t end = data.find("}", start);
-        if (start == std::string::npos || end == std::string::npos) {
+        if (start == std::string_view::npos || end == std::string_view::npos) {
             return doc;
         }
         
-        std::string content = data.substr(start + 1, end - start - 1);
-        std::istringstream ss(content);
-        std::string item;
+        std::string_view content = data.substr(start + 1, end - start - 1);
+
+        // 去除引号
+        auto remove_quotes = [](std::string_view s) {
+            if (s.size() >= 2 && s.front() == '"' && s.back() == '"') {
+                s = s.substr(1, s.size() - 2);
+            }
+            return s;
+        };
         
-        while (std::getline(ss, item, ',')) {
+        while (!content.empty()) {
+            size_t comma = content.find(',');
+            std::string_view item = content.substr(0, comma);
+            content = comma == std::string_view::npos ? std::string_view{} : content.substr(comma + 1);
+
             size_t colon = item.find(':');
-            if (colon == std::string::npos) continue;
+            if (colon == std::string_view::npos) continue;
             
-            std::string key = item.substr(0, colon);
-            std::string value = item.substr(colon + 1);
-            
-            // 去除引号
-            auto remove_quotes = [](std::string& s) {
-                if (s.size() >= 2 && s.front() == '"' && s.back() == '"') {
-                    s = s.substr(1, s.size() - 2);
-                }
-            };
-            
-            remove_quotes(key);
-            remove_quotes(value);
+            std::string_view key = remove_quotes(item.substr(0, colon));
+            std::string_view value = remove_quotes(item.substr(colon + 1));
             
             if (key == "id") {
                 doc.id = value;
             } else {
-                doc.fields[key] = value;
+                doc.set(key, value);
             }
         }
         
@@ -89,6 +129,12 @@ struct SimpleDocument {
     }
 };
 
+using SimpleDocument = BasicSimpleDocument<>;
+
+namespace pmr {
+using SimpleDocument = BasicSimpleDocument<std::pmr::polymorphic_allocator<char>>;
+}
+
 // 文件数据库集合
 class FileCollection {
 private:
@@ -0,0 +1,168 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include "memory_pool.h"
+
+namespace flowcoro {
+
+// 分级slab分配器
+// 16B ~ 64KiB按2的幂划分尺寸等级，每个等级一个MemoryPool；更大的请求直接走operator new。
+// 每个等级的slab固定约64KiB，不随池扩展而变大；全部块空闲且超过空闲期的slab
+// 会被madvise(MADV_DONTNEED)归还操作系统，流量高峰后内存可以回落。
+class SlabAllocator : public std::pmr::memory_resource {
+public:
+    static constexpr size_t MIN_CLASS_SIZE = 16;
+    static constexpr size_t MAX_CLASS_SIZE = 64 * 1024;
+    static constexpr size_t CLASS_COUNT = 13;  // 16, 32, ..., 64KiB
+
+    explicit SlabAllocator(std::chrono::milliseconds idle_period = std::chrono::seconds(30))
+        : idle_period_(idle_period),
+          next_trim_(std::chrono::steady_clock::now() + idle_period) {
+        for (size_t i = 0; i < CLASS_COUNT; ++i) {
+            size_t size = class_size(i);
+            // 每个slab约64KiB，至少一个块
+            size_t blocks = std::max<size_t>(1, SLAB_BYTES / size);
+            pools_[i] = std::make_unique<MemoryPool>(size, blocks);
+            pools_[i]->set_max_chunk_blocks(blocks);
+            // 上限由系统内存决定，不在池内人为限制
+            pools_[i]->set_max_total_blocks(SIZE_MAX / size);
+        }
+    }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    void* allocate_bytes(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        return do_allocate(bytes, alignment);
+    }
+
+    void deallocate_bytes(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        do_deallocate(p, bytes, alignment);
+    }
+
+    // 空闲期配置
+    void set_idle_period(std::chrono::milliseconds idle_period) {
+        idle_period_.store(idle_period, std::memory_order_relaxed);
+    }
+
+    // 立即释放空闲期已满的slab，返回归还的字节数
+    // 调用线程的块缓存会先归还；其他线程在下次分配/释放时归还缓存，
+    // 因此它们缓存的块所在slab在之后的trim中才能释放
+    size_t trim() {
+        auto idle = idle_period_.load(std::memory_order_relaxed);
+        size_t released = 0;
+        for (auto& pool : pools_) {
+            pool->flush_thread_cache();
+            pool->request_thread_cache_flush();
+            released += pool->release_idle_chunks(idle);
+        }
+        next_trim_.store(std::chrono::steady_clock::now() + idle, std::memory_order_relaxed);
+        return released;
+    }
+
+    // 统计信息
+    struct SlabStats {
+        size_t total_memory_bytes;     // 各等级slab映射的总字节数
+        size_t released_memory_bytes;  // 其中已归还操作系统的字节数
+        size_t in_use_blocks;          // 已分配（含线程缓存）的块数
+        size_t large_allocations;      // 当前未释放的大块分配数
+    };
+
+    SlabStats get_stats() const {
+        SlabStats stats{0, 0, 0, large_allocations_.load(std::memory_order_relaxed)};
+        for (const auto& pool : pools_) {
+            auto pool_stats = pool->get_stats();
+            stats.total_memory_bytes += pool_stats.total_memory_bytes;
+            stats.released_memory_bytes += pool_stats.released_memory_bytes;
+            stats.in_use_blocks += pool_stats.allocated_blocks;
+        }
+        return stats;
+    }
+
+    static constexpr size_t class_size(size_t index) {
+        return MIN_CLASS_SIZE << index;
+    }
+
+    // 返回尺寸等级，超出范围返回CLASS_COUNT
+    static constexpr size_t class_index(size_t bytes) {
+        if (bytes > MAX_CLASS_SIZE) return CLASS_COUNT;
+        size_t index = 0;
+        size_t size = MIN_CLASS_SIZE;
+        while (size < bytes) {
+            size <<= 1;
+            ++index;
+        }
+        return index;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        size_t index = pool_index(bytes, alignment);
+        if (index < CLASS_COUNT) {
+            try {
+                return pools_[index]->allocate();
+            } catch (const std::bad_alloc&) {
+                // 映射失败时退回通用分配器
+            }
+        }
+        void* p = ::operator new(bytes, std::align_val_t{alignment});
+        large_allocations_.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        if (!p) return;
+        size_t index = pool_index(bytes, alignment);
+        if (index < CLASS_COUNT && pools_[index]->owns(p)) {
+            pools_[index]->deallocate(p);
+            maybe_trim();
+            return;
+        }
+        ::operator delete(p, bytes, std::align_val_t{alignment});
+        large_allocations_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t SLAB_BYTES = 64 * 1024;
+    static constexpr size_t TRIM_CHECK_INTERVAL = 256;
+
+    // 块在slab内按自身大小对齐（页对齐封顶），对齐要求更高的请求不走slab
+    static size_t pool_index(size_t bytes, size_t alignment) {
+        size_t index = class_index(std::max(bytes, alignment));
+        if (index < CLASS_COUNT && alignment > std::min<size_t>(class_size(index), 4096)) {
+            return CLASS_COUNT;
+        }
+        return index;
+    }
+
+    // 每个线程每TRIM_CHECK_INTERVAL次释放检查一次时钟，到期后由一个线程执行trim
+    void maybe_trim() {
+        thread_local size_t countdown = TRIM_CHECK_INTERVAL;
+        if (--countdown != 0) return;
+        countdown = TRIM_CHECK_INTERVAL;
+
+        auto now = std::chrono::steady_clock::now();
+        auto due = next_trim_.load(std::memory_order_relaxed);
+        if (now < due) return;
+        if (next_trim_.compare_exchange_strong(due, now + idle_period_.load(std::memory_order_relaxed),
+                                               std::memory_order_relaxed)) {
+            trim();
+        }
+    }
+
+    std::array<std::unique_ptr<MemoryPool>, CLASS_COUNT> pools_;
+    std::atomic<std::chrono::milliseconds> idle_period_;
+    std::atomic<std::chrono::steady_clock::time_point> next_trim_;
+    std::atomic<size_t> large_allocations_{0};
+};
+
+} // namespace flowcoro
@@ -152,6 +152,11 @@ public:
         }
     }
     
+    bool has_pending() {
+        std::lock_guard<std::mutex> lock(coroutine_mutex_);
+        return !coroutine_queue_.empty();
+    }
+    
     // 获取统计信息
     struct PoolStats {
         size_t thread_pool_workers;
@@ -236,6 +241,11 @@ void drive_coroutine_pool() {
     CoroutinePool::get_instance().drive();
 }
 
+// 是否有待恢复的协程
+bool coroutine_pool_has_pending() {
+    return CoroutinePool::get_instance().has_pending();
+}
+
 // 统计信息接口
 void print_pool_stats() {
     CoroutinePool::get_instance().print_stats();
@@ -247,6 +257,19 @@ void shutdown_coroutine_pool() {
 }
 
 // 运行协程直到完成的安全实现
+// 注意：GCC 12 在lambda协程中co_await捕获的Task左值时会尝试拷贝Task，因此使用独立的协程函数
+template<typename T>
+static Task<void> await_to_completion(Task<T>& task, std::atomic<bool>& completed,
+                                      std::exception_ptr& exception_holder) {
+    try {
+        co_await task;
+        completed.store(true);
+    } catch (...) {
+        exception_holder = std::current_exception();
+        completed.store(true);
+    }
+}
+
 void run_until_complete(Task<void>& task) {
     std::atomic<bool> completed{false};
     std::exception_ptr exception_holder = nullptr;
@@ -255,15 +278,7 @@ void run_until_complete(Task<void>& task) {
     auto& manager = CoroutineManager::get_instance();
     
     // 创建完成回调
-    auto completion_task = [&]() -> Task<void> {
-        try {
-            co_await task;
-            completed.store(true);
-        } catch (...) {
-            exception_holder = std::current_exception();
-            completed.store(true);
-        }
-    }();
+    auto completion_task = await_to_completion(task, completed, exception_holder);
     
     // 启动任务
     manager.schedule_resume(completion_task.handle);
@@ -292,15 +307,7 @@ void run_until_complete(Task<T>& task) {
     auto& manager = CoroutineManager::get_instance();
     
     // 创建完成回调
-    auto completion_task = [&]() -> Task<void> {
-        try {
-            co_await task;
-            completed.store(true);
-        } catch (...) {
-            exception_holder = std::current_exception();
-            completed.store(true);
-        }
-    }();
+    auto completion_task = await_to_completion(task, completed, exception_holder);
     
     // 启动任务
     manager.schedule_resume(completion_task.handle);
@@ -9,9 +9,9 @@
 
 namespace flowcoro {
 
-// GlobalLogger 静态成员定义  
-std::unique_ptr<Logger> GlobalLogger::instance_;
-std::once_flag GlobalLogger::init_flag_;
+// GlobalLogger 静态成员定义
+std::atomic<Logger*> GlobalLogger::current_{nullptr};
+std::atomic<uint64_t> GlobalLogger::generation_{1};
 
 } // namespace flowcoro
 
@@ -0,0 +1,330 @@
+/**
+ * @file io_uring.cpp
+ * @brief io_uring封装实现
+ */
+
+#include "flowcoro/io_uring.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace flowcoro::net {
+
+namespace {
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// 网络后端用到的操作
+constexpr uint8_t REQUIRED_OPS[] = {
+    IORING_OP_RECV, IORING_OP_SEND, IORING_OP_ACCEPT, IORING_OP_CONNECT,
+    IORING_OP_POLL_ADD, IORING_OP_LINK_TIMEOUT, IORING_OP_ASYNC_CANCEL,
+    IORING_OP_SENDMSG, IORING_OP_RECVMSG,
+};
+
+bool probe_kernel() {
+    io_uring_params params{};
+    int fd = sys_io_uring_setup(4, &params);
+    if (fd < 0) {
+        return false; // ENOSYS、被seccomp或sysctl禁用
+    }
+
+    // 单次mmap、不丢弃CQE、io_uring_enter支持扩展参数（超时）
+    constexpr uint32_t required_features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    bool ok = (params.features & required_features) == required_features;
+
+    if (ok) {
+        constexpr unsigned probe_ops = 256;
+        std::vector<std::byte> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        ok = sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, probe_ops) == 0;
+        for (uint8_t op : REQUIRED_OPS) {
+            ok = ok && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+// ============================================================================
+// IoUring 实现
+// ============================================================================
+
+bool IoUring::supported() {
+    static const bool result = probe_kernel();
+    return result;
+}
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params{};
+    // 协作式任务处理：完成事件只在进入内核时处理，不打断用户态
+    params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    ring_fd_ = sys_io_uring_setup(entries, &params);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        params = io_uring_params{};
+        ring_fd_ = sys_io_uring_setup(entries, &params);
+    }
+    if (ring_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup failed");
+    }
+
+    // SQ和CQ共用一次映射
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring_size_ = std::max(sq_size, cq_size);
+    ring_ptr_ = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_SQ_RING);
+    if (ring_ptr_ == MAP_FAILED) {
+        int err = errno;
+        ::close(ring_fd_);
+        throw std::system_error(err, std::generic_category(), "io_uring ring mmap failed");
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        int err = errno;
+        ::munmap(ring_ptr_, ring_size_);
+        ::close(ring_fd_);
+        throw std::system_error(err, std::generic_category(), "io_uring sqe mmap failed");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* base = static_cast<char*>(ring_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+
+    cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    ::munmap(sqes_, sqes_size_);
+    ::munmap(ring_ptr_, ring_size_);
+    ::close(ring_fd_);
+}
+
+void IoUring::make_room(unsigned count) {
+    // 队列满时绝不能交出槽位：那会覆盖内核尚未取走的SQE，并让tail越过head
+    while (sq_entries_ - unsubmitted() < count) {
+        if (submit() >= 0) {
+            continue;
+        }
+        int err = errno;
+        if (err == EINTR) {
+            continue;
+        }
+        if (err != EBUSY && err != EAGAIN) {
+            throw std::system_error(err, std::generic_category(), "io_uring submit failed");
+        }
+        // 腾出CQ后内核才能把溢出的完成事件写回并继续接受提交
+        if (reap_completions() == 0) {
+            enter(0, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+            reap_completions();
+        }
+    }
+}
+
+unsigned IoUring::reap_completions() {
+    unsigned count = 0;
+    unsigned head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        reaped_.push_back(cqes_[head & cq_mask_]);
+        __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+        ++count;
+    }
+    return count;
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    make_room(1);
+    unsigned index = sqe_tail_ & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    return sqe;
+}
+
+int IoUring::enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size) {
+    // 发布本地填写的SQE
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    ++enter_calls_;
+    int result;
+    do {
+        result = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                            flags, arg, arg_size));
+    } while (result < 0 && errno == EINTR && min_complete == 0);
+    if (result > 0) {
+        submitted_ += static_cast<uint64_t>(result);
+    }
+    return result;
+}
+
+int IoUring::submit() {
+    unsigned to_submit = unsubmitted();
+    if (to_submit == 0) {
+        return 0;
+    }
+    return enter(to_submit, 0, 0, nullptr, 0);
+}
+
+int IoUring::submit_and_wait(int timeout_ms) {
+    unsigned to_submit = unsubmitted();
+    bool has_completions = !reaped_.empty() || *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (has_completions || timeout_ms == 0) {
+        return to_submit ? enter(to_submit, 0, 0, nullptr, 0) : 0;
+    }
+
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    if (timeout_ms > 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    // 超时(ETIME)和信号中断(EINTR)都只是提前返回
+    return enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+bool IoUring::register_buffer_ring(io_uring_buf_ring* ring, unsigned entries, uint16_t group) {
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = entries;
+    reg.bgid = group;
+    return sys_io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+}
+
+void IoUring::unregister_buffer_ring(uint16_t group) {
+    io_uring_buf_reg reg{};
+    reg.bgid = group;
+    sys_io_uring_register(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+// ============================================================================
+// IoUringBufferRing 实现
+// ============================================================================
+
+IoUringBufferRing* IoUringBufferRing::create(IoUring& ring, uint16_t group, unsigned count, size_t buffer_size) {
+    // ring条目数必须是2的幂，bid为16位
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return nullptr;
+    }
+    auto* self = new IoUringBufferRing(group, count, buffer_size);
+    if (!self->ring_ || !self->buffers_ || !ring.register_buffer_ring(self->ring_, count, group)) {
+        delete self;
+        return nullptr;
+    }
+    for (unsigned bid = 0; bid < count; ++bid) {
+        self->push(static_cast<uint16_t>(bid));
+    }
+    __atomic_store_n(&self->ring_->tail, self->tail_, __ATOMIC_RELEASE);
+    return self;
+}
+
+IoUringBufferRing::IoUringBufferRing(uint16_t group, unsigned count, size_t buffer_size)
+    : group_(group), count_(count), buffer_size_(buffer_size) {
+    // ring内存必须页对齐，直接mmap
+    ring_bytes_ = count * sizeof(io_uring_buf);
+    void* ring = ::mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring_ = ring == MAP_FAILED ? nullptr : static_cast<io_uring_buf_ring*>(ring);
+
+    buffer_bytes_ = count * buffer_size;
+    void* buffers = ::mmap(nullptr, buffer_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffers_ = buffers == MAP_FAILED ? nullptr : static_cast<std::byte*>(buffers);
+}
+
+IoUringBufferRing::~IoUringBufferRing() {
+    if (ring_) ::munmap(ring_, ring_bytes_);
+    if (buffers_) ::munmap(buffers_, buffer_bytes_);
+}
+
+void IoUringBufferRing::push(uint16_t bid) {
+    // tail与bufs[0].resv重叠，只能逐字段写
+    io_uring_buf& buf = ring_->bufs[tail_ & (count_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(bid) * buffer_size_);
+    buf.len = static_cast<uint32_t>(buffer_size_);
+    buf.bid = bid;
+    ++tail_;
+}
+
+IOBuf IoUringBufferRing::adopt(uint16_t bid, size_t length) {
+    {
+        std::lock_guard<std::mutex> lock(returned_mutex_);
+        ++outstanding_;
+    }
+    return IOBuf::wrap(buffers_ + static_cast<size_t>(bid) * buffer_size_, length, &IoUringBufferRing::release, this);
+}
+
+void IoUringBufferRing::recycle(uint16_t bid) {
+    push(bid);
+    __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+}
+
+void IoUringBufferRing::replenish() {
+    if (!has_returned_.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::vector<uint16_t> returned;
+    {
+        std::lock_guard<std::mutex> lock(returned_mutex_);
+        returned.swap(returned_);
+        has_returned_.store(false, std::memory_order_relaxed);
+    }
+    for (uint16_t bid : returned) {
+        push(bid);
+    }
+    __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+}
+
+void IoUringBufferRing::release(void* context, void* data) {
+    auto* self = static_cast<IoUringBufferRing*>(context);
+    auto bid = static_cast<uint16_t>((static_cast<std::byte*>(data) - self->buffers_) / self->buffer_size_);
+    bool destroy;
+    {
+        std::lock_guard<std::mutex> lock(self->returned_mutex_);
+        --self->outstanding_;
+        destroy = self->retired_ && self->outstanding_ == 0;
+        if (!self->retired_) {
+            self->returned_.push_back(bid);
+            self->has_returned_.store(true, std::memory_order_release);
+        }
+    }
+    if (destroy) {
+        delete self;
+    }
+}
+
+void IoUringBufferRing::retire(IoUring& ring) {
+    ring.unregister_buffer_ring(group_);
+    bool destroy;
+    {
+        std::lock_guard<std::mutex> lock(returned_mutex_);
+        retired_ = true;
+        destroy = outstanding_ == 0;
+    }
+    if (destroy) {
+        delete this;
+    }
+}
+
+} // namespace flowcoro::net
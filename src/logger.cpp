@@ -0,0 +1,893 @@
+/**
+ * @file logger.cpp
+ * @brief FlowCoro 日志写入线程与格式化实现
+ */
+
+#include "flowcoro/logger.h"
+#include "flowcoro/buffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace flowcoro {
+
+namespace {
+
+// 按类型读取一个已编码的参数
+struct DecodedArg {
+    LogArgType type;
+    int64_t i;
+    uint64_t u;
+    double d;
+    long double ld;
+    const void* p;
+    std::string_view str;
+};
+
+DecodedArg decode_arg(LogArgType type, const std::byte*& in) {
+    DecodedArg arg{};
+    arg.type = type;
+    switch (type) {
+        case LogArgType::INT:
+            std::memcpy(&arg.i, in, sizeof(arg.i));
+            in += sizeof(arg.i);
+            break;
+        case LogArgType::UINT:
+            std::memcpy(&arg.u, in, sizeof(arg.u));
+            in += sizeof(arg.u);
+            break;
+        case LogArgType::DOUBLE:
+            std::memcpy(&arg.d, in, sizeof(arg.d));
+            in += sizeof(arg.d);
+            break;
+        case LogArgType::LONG_DOUBLE:
+            std::memcpy(&arg.ld, in, sizeof(arg.ld));
+            in += sizeof(arg.ld);
+            break;
+        case LogArgType::POINTER:
+            std::memcpy(&arg.p, in, sizeof(arg.p));
+            in += sizeof(arg.p);
+            break;
+        case LogArgType::STRING: {
+            uint32_t len = 0;
+            std::memcpy(&len, in, sizeof(len));
+            in += sizeof(len);
+            arg.str = std::string_view(reinterpret_cast<const char*>(in), len);
+            in += len + 1;
+            break;
+        }
+    }
+    return arg;
+}
+
+int64_t arg_as_int(const DecodedArg& arg) {
+    switch (arg.type) {
+        case LogArgType::INT: return arg.i;
+        case LogArgType::UINT: return static_cast<int64_t>(arg.u);
+        case LogArgType::DOUBLE: return static_cast<int64_t>(arg.d);
+        case LogArgType::LONG_DOUBLE: return static_cast<int64_t>(arg.ld);
+        case LogArgType::POINTER: return static_cast<int64_t>(reinterpret_cast<uintptr_t>(arg.p));
+        case LogArgType::STRING: return 0;
+    }
+    return 0;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+
+// spec为去掉长度修饰符的转换说明（不含转换字符），按实际编码类型补上修饰符后格式化
+void append_converted(StringBuffer& out, std::string& spec, char conv, const DecodedArg& arg) {
+    switch (conv) {
+        case 'd': case 'i':
+            spec += "lld";
+            out.append_format(spec.c_str(), static_cast<long long>(arg_as_int(arg)));
+            return;
+        case 'u': case 'o': case 'x': case 'X':
+            spec += "ll";
+            spec += conv;
+            out.append_format(spec.c_str(), static_cast<unsigned long long>(arg_as_int(arg)));
+            return;
+        case 'c':
+            spec += 'c';
+            out.append_format(spec.c_str(), static_cast<int>(arg_as_int(arg)));
+            return;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (arg.type == LogArgType::LONG_DOUBLE) {
+                spec += 'L';
+                spec += conv;
+                out.append_format(spec.c_str(), arg.ld);
+            } else {
+                double value = arg.type == LogArgType::DOUBLE ? arg.d : static_cast<double>(arg_as_int(arg));
+                spec += conv;
+                out.append_format(spec.c_str(), value);
+            }
+            return;
+        case 'p':
+            spec += 'p';
+            out.append_format(spec.c_str(), arg.type == LogArgType::POINTER
+                ? arg.p : reinterpret_cast<const void*>(static_cast<uintptr_t>(arg_as_int(arg))));
+            return;
+        case 's':
+            if (arg.type == LogArgType::STRING) {
+                if (spec.size() == 1) {
+                    out.append(arg.str);  // 最常见的%s直接追加
+                } else {
+                    spec += 's';
+                    out.append_format(spec.c_str(), arg.str.data());
+                }
+            } else {
+                out.append("(non-string)");
+            }
+            return;
+        default:
+            out.append('%');
+            out.append(conv);
+            return;
+    }
+}
+
+#pragma GCC diagnostic pop
+
+const char* basename_of(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+} // namespace
+
+// ============================================================================
+// LogFileSink 实现
+// ============================================================================
+
+int LogFileSink::open_fd(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+bool LogFileSink::open(const std::string& path) {
+    int fd = open_fd(path);
+    if (fd < 0) {
+        return false;
+    }
+    close();
+
+    struct stat st{};
+    file_bytes_ = ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    fd_ = fd;
+    path_ = path;
+    opened_at_ = last_sync_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void LogFileSink::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    write_out();
+    if (policy_.fsync != LogFsyncPolicy::NEVER && unsynced_) {
+        sync(std::chrono::steady_clock::now());
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void LogFileSink::append(const char* data, size_t size) {
+    if (pending_ > 0 && pending_ + size > policy_.buffer_size) {
+        write_out();
+    }
+    if (pending_ == 0) {
+        first_pending_ = std::chrono::steady_clock::now();
+    }
+    pending_ += size;
+    while (size > 0) {
+        if (chunk_index_ == chunks_.size()) {
+            chunks_.emplace_back(static_cast<char*>(std::aligned_alloc(4096, CHUNK_SIZE)));
+            if (!chunks_.back()) {
+                chunks_.pop_back();
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                pending_ -= size;
+                return;
+            }
+        }
+        size_t n = std::min(size, CHUNK_SIZE - chunk_used_);
+        std::memcpy(chunks_[chunk_index_].get() + chunk_used_, data, n);
+        chunk_used_ += n;
+        data += n;
+        size -= n;
+        if (chunk_used_ == CHUNK_SIZE) {
+            ++chunk_index_;
+            chunk_used_ = 0;
+        }
+    }
+}
+
+bool LogFileSink::should_write(std::chrono::steady_clock::time_point now) const {
+    return pending_ > 0 && (pending_ >= policy_.buffer_size || now - first_pending_ >= policy_.flush_interval);
+}
+
+void LogFileSink::write_out() {
+    if (pending_ == 0) {
+        return;
+    }
+    if (fd_ >= 0) {
+        // 所有缓冲块一次writev写出；部分写入时跳过已写部分继续
+        std::vector<iovec> iov;
+        iov.reserve(chunk_index_ + 1);
+        for (size_t i = 0; i < chunk_index_; ++i) {
+            iov.push_back({chunks_[i].get(), CHUNK_SIZE});
+        }
+        if (chunk_used_ > 0) {
+            iov.push_back({chunks_[chunk_index_].get(), chunk_used_});
+        }
+        size_t first = 0;
+        while (first < iov.size()) {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t n = ::writev(fd_, iov.data() + first, count);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            write_calls_.fetch_add(1, std::memory_order_relaxed);
+            bytes_written_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            file_bytes_ += static_cast<uint64_t>(n);
+            unsynced_ = true;
+            auto remaining = static_cast<size_t>(n);
+            while (first < iov.size() && remaining >= iov[first].iov_len) {
+                remaining -= iov[first].iov_len;
+                ++first;
+            }
+            if (first < iov.size()) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+                iov[first].iov_len -= remaining;
+            }
+        }
+    }
+    chunk_index_ = 0;
+    chunk_used_ = 0;
+    pending_ = 0;
+
+    // 缓冲块只保留buffer_size所需的数量，超长行临时分配的块随即释放
+    size_t keep = std::max<size_t>(1, (policy_.buffer_size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    if (chunks_.size() > keep) {
+        chunks_.resize(keep);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (policy_.fsync == LogFsyncPolicy::ALWAYS ||
+        (policy_.fsync == LogFsyncPolicy::INTERVAL && now - last_sync_ >= policy_.fsync_interval)) {
+        sync(now);
+    }
+    maybe_rotate(now);
+}
+
+void LogFileSink::tick(std::chrono::steady_clock::time_point now) {
+    if (should_write(now)) {
+        write_out();
+        return;
+    }
+    if (policy_.fsync == LogFsyncPolicy::INTERVAL && unsynced_ && now - last_sync_ >= policy_.fsync_interval) {
+        sync(now);
+    }
+    maybe_rotate(now);
+}
+
+void LogFileSink::sync(std::chrono::steady_clock::time_point now) {
+    if (fd_ >= 0 && ::fdatasync(fd_) == 0) {
+        syncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    unsynced_ = false;
+    last_sync_ = now;
+}
+
+void LogFileSink::maybe_rotate(std::chrono::steady_clock::time_point now) {
+    if (fd_ < 0 || pending_ > 0 || file_bytes_ == 0) {
+        return;
+    }
+    bool by_size = policy_.rotate_bytes > 0 && file_bytes_ >= policy_.rotate_bytes;
+    bool by_time = policy_.rotate_interval.count() > 0 && now - opened_at_ >= policy_.rotate_interval;
+    if (by_size || by_time) {
+        rotate(now);
+    }
+}
+
+void LogFileSink::rotate(std::chrono::steady_clock::time_point now) {
+    // 先改名再打开新文件：已写出的数据随原inode留在path.1，新数据写入新的path
+    if (policy_.fsync != LogFsyncPolicy::NEVER && unsynced_) {
+        sync(now);
+    }
+    if (policy_.max_files == 0) {
+        ::unlink(path_.c_str());
+    } else {
+        std::string oldest = path_ + "." + std::to_string(policy_.max_files);
+        ::unlink(oldest.c_str());
+        for (size_t i = policy_.max_files; i > 1; --i) {
+            std::string from = path_ + "." + std::to_string(i - 1);
+            std::string to = path_ + "." + std::to_string(i);
+            ::rename(from.c_str(), to.c_str());
+        }
+        std::string first = path_ + ".1";
+        ::rename(path_.c_str(), first.c_str());
+    }
+
+    int fd = open_fd(path_);
+    if (fd < 0) {
+        // 新文件打不开时继续写原文件，下次再试
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        opened_at_ = now;
+        return;
+    }
+    ::close(fd_);
+    fd_ = fd;
+    file_bytes_ = 0;
+    opened_at_ = last_sync_ = now;
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+LogFileStats LogFileSink::stats() const {
+    return {
+        bytes_written_.load(std::memory_order_relaxed),
+        write_calls_.load(std::memory_order_relaxed),
+        rotations_.load(std::memory_order_relaxed),
+        syncs_.load(std::memory_order_relaxed),
+        errors_.load(std::memory_order_relaxed)
+    };
+}
+
+// ============================================================================
+// Logger 实现
+// ============================================================================
+
+void Logger::format_message(const LogRecordHeader& record, StringBuffer& out) {
+    const char* format = record.site->format;
+    const std::byte* in = record.args();
+    uint32_t next_arg = 0;
+    std::string spec;
+
+    auto next = [&]() -> DecodedArg {
+        if (next_arg >= record.arg_count) {
+            DecodedArg missing{};
+            missing.type = LogArgType::STRING;
+            missing.str = "<missing>";
+            return missing;
+        }
+        return decode_arg(record.arg_types[next_arg++], in);
+    };
+
+    while (*format) {
+        const char* percent = std::strchr(format, '%');
+        if (!percent) {
+            out.append(std::string_view(format));
+            break;
+        }
+        out.append(format, static_cast<size_t>(percent - format));
+        const char* p = percent + 1;
+        if (*p == '%') {
+            out.append('%');
+            format = p + 1;
+            continue;
+        }
+
+        // 解析 flags / width / precision，*从参数中取值
+        spec.clear();
+        spec.push_back('%');
+        while (*p && std::strchr("-+ #0", *p)) spec += *p++;
+        if (*p == '*') {
+            spec += std::to_string(arg_as_int(next()));
+            ++p;
+        } else {
+            while (*p >= '0' && *p <= '9') spec += *p++;
+        }
+        if (*p == '.') {
+            spec += *p++;
+            if (*p == '*') {
+                spec += std::to_string(arg_as_int(next()));
+                ++p;
+            } else {
+                while (*p >= '0' && *p <= '9') spec += *p++;
+            }
+        }
+        // 长度修饰符由参数的编码类型决定，这里跳过
+        while (*p && std::strchr("hlLqjzt", *p)) ++p;
+        if (!*p) {
+            out.append(std::string_view(percent));
+            break;
+        }
+        char conv = *p++;
+        append_converted(out, spec, conv, next());
+        format = p;
+    }
+}
+
+Logger::Logger() : id_(next_id_.fetch_add(1, std::memory_order_relaxed)) {
+    static constexpr LogLevelPolicy defaults[LOG_LEVEL_COUNT] = {
+        {0.50, LogOverflowPolicy::DROP, 1},   // TRACE
+        {0.50, LogOverflowPolicy::DROP, 1},   // DEBUG
+        {0.75, LogOverflowPolicy::DROP, 1},   // INFO
+        {0.90, LogOverflowPolicy::DROP, 1},   // WARN
+        {1.00, LogOverflowPolicy::BLOCK, 1},  // ERROR
+        {1.00, LogOverflowPolicy::BLOCK, 1},  // FATAL
+    };
+    for (size_t i = 0; i < LOG_LEVEL_COUNT; ++i) {
+        set_level_policy(static_cast<LogLevel>(i), defaults[i]);
+    }
+}
+
+void Logger::set_level_policy(LogLevel level, LogLevelPolicy policy) {
+    auto index = static_cast<size_t>(level);
+    double fill = std::clamp(policy.max_fill, 0.0, 1.0);
+    fill_permille_[index].store(static_cast<uint32_t>(fill * 1000.0), std::memory_order_relaxed);
+    overflow_policy_[index].store(static_cast<int>(policy.overflow), std::memory_order_relaxed);
+    sample_every_[index].store(std::max<uint32_t>(policy.sample_every, 1), std::memory_order_relaxed);
+}
+
+LogLevelPolicy Logger::level_policy(LogLevel level) const {
+    auto index = static_cast<size_t>(level);
+    return {
+        fill_permille_[index].load(std::memory_order_relaxed) / 1000.0,
+        static_cast<LogOverflowPolicy>(overflow_policy_[index].load(std::memory_order_relaxed)),
+        sample_every_[index].load(std::memory_order_relaxed)
+    };
+}
+
+std::byte* Logger::reserve_on_overflow(LogStagingBuffer& buffer, LogLevel level, size_t size) {
+    auto index = static_cast<size_t>(level);
+    switch (static_cast<LogOverflowPolicy>(overflow_policy_[index].load(std::memory_order_relaxed))) {
+        case LogOverflowPolicy::SAMPLE:
+            if (++buffer.overflow_counts[index] % sample_every_[index].load(std::memory_order_relaxed) == 0) {
+                if (std::byte* out = buffer.reserve(size)) {
+                    return out;
+                }
+            }
+            break;
+        case LogOverflowPolicy::BLOCK: {
+            if (size > buffer.capacity() || !writer_thread_) {
+                break;
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (!shutdown_.load(std::memory_order_acquire)) {
+                if (std::byte* out = buffer.reserve(size)) {
+                    return out;
+                }
+                wake_writer();
+                if (std::chrono::steady_clock::now() > deadline) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+            break;
+        }
+        case LogOverflowPolicy::DROP:
+            break;
+    }
+    count_dropped(level);
+    return nullptr;
+}
+
+void Logger::count_dropped(LogLevel level) {
+    dropped_logs_.fetch_add(1, std::memory_order_relaxed);
+    dropped_by_level_[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Logger::wake_writer() {
+    if (writer_sleeping_.exchange(false, std::memory_order_acq_rel) && event_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(event_fd_, &one, sizeof(one));
+    }
+}
+
+bool Logger::initialize(const std::string& filename, LogLevel min_level, LogOutput output) {
+    min_level_.store(min_level, std::memory_order_release);
+    output_type_.store(output, std::memory_order_release);
+    log_file_path_ = filename;
+    fallback_buffer_ = std::make_shared<LogStagingBuffer>(DEFAULT_THREAD_BUFFER_SIZE, 0);
+    buffers_.push_back(fallback_buffer_);
+
+    // 根据输出类型打开日志文件
+    if (output == LogOutput::FILE || output == LogOutput::BOTH) {
+        if (filename.empty() && output == LogOutput::FILE) {
+            // 如果要求文件输出但没有提供文件名，使用默认文件名
+            log_file_path_ = "flowcoro.log";
+        }
+        if (!log_file_path_.empty()) {
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            if (!file_sink_.open(log_file_path_)) {
+                std::cerr << "Failed to open log file: " << log_file_path_ << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // 启动后台写入线程
+    event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    writer_thread_ = std::make_unique<std::thread>([this] { writer_loop(); });
+    return true;
+}
+
+void Logger::shutdown() {
+    if (shutdown_.exchange(true, std::memory_order_acq_rel)) {
+        return; // 已经关闭
+    }
+
+    if (event_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(event_fd_, &one, sizeof(one));
+    }
+    if (writer_thread_ && writer_thread_->joinable()) {
+        writer_thread_->join();
+    }
+    if (event_fd_ >= 0) {
+        ::close(event_fd_);
+        event_fd_ = -1;
+    }
+
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    file_sink_.close();
+    written_logs_.fetch_add(unflushed_records_, std::memory_order_release);
+    unflushed_records_ = 0;
+}
+
+void Logger::flush() {
+    uint64_t target = total_logs();
+    while (written_logs_.load(std::memory_order_acquire) < target &&
+           writer_thread_ && !shutdown_.load(std::memory_order_acquire)) {
+        // 要求写入线程立即写出文件缓冲，不等flush_interval
+        flush_requested_.store(true, std::memory_order_release);
+        wake_writer();
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+bool Logger::set_log_file(const std::string& filename) {
+    if (filename.empty()) {
+        return false;
+    }
+
+    // 先让调用前的日志落到原文件，再在两次写出之间切换
+    flush();
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    if (!file_sink_.open(filename)) {
+        std::cerr << "Failed to open new log file: " << filename << std::endl;
+        return false;
+    }
+    written_logs_.fetch_add(unflushed_records_, std::memory_order_release);
+    unflushed_records_ = 0;
+    log_file_path_ = filename;
+    return true;
+}
+
+void Logger::set_file_policy(const LogFilePolicy& policy) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    file_sink_.set_policy(policy);
+}
+
+LogFilePolicy Logger::file_policy() const {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    return file_sink_.policy();
+}
+
+Logger::Stats Logger::get_stats() const {
+    uint64_t total = total_logs();
+    uint64_t dropped = dropped_logs_.load(std::memory_order_acquire);
+    double drop_rate = total > 0 ? (double)dropped / total * 100.0 : 0.0;
+
+    std::string output_info;
+    LogOutput output = output_type_.load(std::memory_order_acquire);
+    switch (output) {
+        case LogOutput::CONSOLE:
+            output_info = "Console only";
+            break;
+        case LogOutput::FILE:
+            output_info = "File: " + log_file_path_;
+            break;
+        case LogOutput::BOTH:
+            output_info = "Console + File: " + log_file_path_;
+            break;
+    }
+
+    std::array<uint64_t, LOG_LEVEL_COUNT> by_level{};
+    for (size_t i = 0; i < LOG_LEVEL_COUNT; ++i) {
+        by_level[i] = dropped_by_level_[i].load(std::memory_order_relaxed);
+    }
+    return {total, dropped, drop_rate, output_info, by_level, file_sink_.stats()};
+}
+
+uint64_t Logger::total_logs() const {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    uint64_t total = removed_records_;
+    for (const auto& buffer : buffers_) {
+        total += buffer->records();
+    }
+    return total;
+}
+
+LogStagingBuffer* Logger::register_thread_buffer(ThreadBuffers& tls) {
+    size_t slot = ThreadBuffers::SLOTS;
+    for (size_t i = 0; i < ThreadBuffers::SLOTS; ++i) {
+        if (!tls.buffers[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == ThreadBuffers::SLOTS) {
+        // 槽位用尽时轮换淘汰，被淘汰的缓冲区排空后由写入线程移除
+        slot = tls.next_victim++ % ThreadBuffers::SLOTS;
+        tls.buffers[slot]->retired.store(true, std::memory_order_release);
+    }
+
+    auto buffer = std::make_shared<LogStagingBuffer>(
+        thread_buffer_size_.load(std::memory_order_relaxed),
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(buffer);
+    }
+    tls.logger_ids[slot] = id_;
+    tls.buffers[slot] = std::move(buffer);
+    return tls.buffers[slot].get();
+}
+
+const LogSite& Logger::dynamic_site(LogLevel level) {
+    // file为空表示文件名和行号作为前两个参数记录
+    static constexpr LogSite sites[] = {
+        {LogLevel::TRACE, nullptr, 0, "%s"},
+        {LogLevel::LOG_DEBUG, nullptr, 0, "%s"},
+        {LogLevel::LOG_INFO, nullptr, 0, "%s"},
+        {LogLevel::LOG_WARN, nullptr, 0, "%s"},
+        {LogLevel::LOG_ERROR, nullptr, 0, "%s"},
+        {LogLevel::LOG_FATAL, nullptr, 0, "%s"},
+    };
+    return sites[static_cast<int>(level)];
+}
+
+void Logger::writer_loop() {
+    while (!shutdown_.load(std::memory_order_acquire)) {
+        size_t drained = drain_buffers();
+        service_file(flush_requested_.exchange(false, std::memory_order_acq_rel));
+        if (drained == 0) {
+            wait_for_records();
+        }
+    }
+
+    // 处理剩余的日志
+    while (drain_buffers() > 0) {
+    }
+    service_file(true);
+}
+
+void Logger::service_file(bool force) {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (force || file_sink_.should_write(now)) {
+        write_out_file();
+    }
+    file_sink_.tick(now);
+}
+
+void Logger::write_out_file() {
+    file_sink_.write_out();
+    written_logs_.fetch_add(unflushed_records_, std::memory_order_release);
+    unflushed_records_ = 0;
+}
+
+void Logger::wait_for_records() {
+    // 先声明即将休眠再检查一次，避免与记录日志的线程错过唤醒；
+    // 生产者一侧只做relaxed读取，极小概率的漏唤醒由超时兜底
+    static constexpr int IDLE_TIMEOUT_MS = 10;
+    writer_sleeping_.store(true, std::memory_order_seq_cst);
+    if (has_pending_records() || shutdown_.load(std::memory_order_acquire)) {
+        writer_sleeping_.store(false, std::memory_order_relaxed);
+        return;
+    }
+    pollfd pfd{event_fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, IDLE_TIMEOUT_MS) > 0) {
+        uint64_t value = 0;
+        [[maybe_unused]] ssize_t n = ::read(event_fd_, &value, sizeof(value));
+    }
+    writer_sleeping_.store(false, std::memory_order_relaxed);
+}
+
+bool Logger::has_pending_records() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    return std::any_of(buffers_.begin(), buffers_.end(),
+                       [](const auto& buffer) { return !buffer->empty(); });
+}
+
+size_t Logger::drain_buffers() {
+    static constexpr size_t BATCH_SIZE = 1024;
+
+    std::vector<std::shared_ptr<LogStagingBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        // 移除所属线程已退出且已排空的缓冲区
+        std::erase_if(buffers_, [this](const auto& buffer) {
+            if (buffer->retired.load(std::memory_order_acquire) && buffer->empty()) {
+                removed_records_ += buffer->records();
+                return true;
+            }
+            return false;
+        });
+        buffers = buffers_;
+    }
+
+    // 以各缓冲区的首条记录建立最小堆，按时间戳归并输出
+    struct Cursor {
+        LogStagingBuffer* buffer;
+        const LogRecordHeader* record;
+    };
+    auto later = [](const Cursor& a, const Cursor& b) {
+        return a.record->timestamp_ns > b.record->timestamp_ns;
+    };
+    std::vector<Cursor> heap;
+    heap.reserve(buffers.size());
+    for (auto& buffer : buffers) {
+        if (const LogRecordHeader* record = buffer->peek()) {
+            heap.push_back({buffer.get(), record});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    StringBuffer line(1024);
+    size_t written = 0;
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    LogOutput output = output_type_.load(std::memory_order_acquire);
+    while (!heap.empty() && written < BATCH_SIZE) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Cursor& cursor = heap.back();
+        line.clear();
+        write_record(*cursor.record, cursor.buffer->thread_hash(), line);
+        cursor.buffer->consume(cursor.record);
+        write_line(line.data(), line.size(), output);
+        ++written;
+
+        if ((cursor.record = cursor.buffer->peek())) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    if (written > 0) {
+        if (output == LogOutput::CONSOLE || output == LogOutput::BOTH) {
+            std::cout.flush();
+        }
+        // 文件数据由service_file按策略写出后才计入已输出
+        if (file_sink_.pending_bytes() > 0) {
+            unflushed_records_ += written;
+        } else {
+            written_logs_.fetch_add(written, std::memory_order_release);
+        }
+    }
+    return written;
+}
+
+void Logger::write_record(const LogRecordHeader& record, size_t thread_hash, StringBuffer& line) {
+    // 时间前缀"[YYYY-mm-dd HH:MM:SS."按秒缓存，同一秒内的记录只追加毫秒
+    int64_t second = record.timestamp_ns / 1000000000;
+    if (second != cached_second_) {
+        time_t seconds = static_cast<time_t>(second);
+        std::tm tm_info{};
+        localtime_r(&seconds, &tm_info);
+        cached_prefix_size_ = std::strftime(cached_prefix_, sizeof(cached_prefix_), "[%Y-%m-%d %H:%M:%S.", &tm_info);
+        cached_second_ = second;
+    }
+    auto ms = static_cast<int>((record.timestamp_ns / 1000000) % 1000);
+    char ms_text[3] = {static_cast<char>('0' + ms / 100), static_cast<char>('0' + ms / 10 % 10),
+                       static_cast<char>('0' + ms % 10)};
+
+    const LogSite& site = *record.site;
+    line.append(cached_prefix_, cached_prefix_size_);
+    line.append(ms_text, sizeof(ms_text));
+    line.append("] [");
+    line.append(level_to_string(site.level));
+    line.append("] [");
+    if (site.file) {
+        line.append(basename_of(site.file));
+        line.append(':');
+        line.append_number(site.line);
+        line.append("] [tid:");
+        line.append_number(thread_hash);
+        line.append("] ");
+        format_message(record, line);
+    } else {
+        // 兼容接口：参数依次为文件名、行号、已格式化的消息
+        const std::byte* in = record.args();
+        DecodedArg file = decode_arg(record.arg_types[0], in);
+        DecodedArg file_line = decode_arg(record.arg_types[1], in);
+        DecodedArg message = decode_arg(record.arg_types[2], in);
+        std::string_view file_name = file.str;
+        if (size_t slash = file_name.rfind('/'); slash != std::string_view::npos) {
+            file_name.remove_prefix(slash + 1);
+        }
+        line.append(file_name);
+        line.append(':');
+        line.append_number(arg_as_int(file_line));
+        line.append("] [tid:");
+        line.append_number(thread_hash);
+        line.append("] ");
+        line.append(message.str);
+    }
+    line.append('\n');
+}
+
+void Logger::write_line(const char* data, size_t size, LogOutput output) {
+    // 根据输出类型决定输出位置
+    if (output == LogOutput::CONSOLE || output == LogOutput::BOTH) {
+        std::cout.write(data, static_cast<std::streamsize>(size));
+    }
+    if ((output == LogOutput::FILE || output == LogOutput::BOTH) && file_sink_.is_open()) {
+        file_sink_.append(data, size);
+    }
+}
+
+const char* Logger::level_to_string(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::LOG_DEBUG: return "DEBUG";
+        case LogLevel::LOG_INFO:  return "INFO ";
+        case LogLevel::LOG_WARN:  return "WARN ";
+        case LogLevel::LOG_ERROR: return "ERROR";
+        case LogLevel::LOG_FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+namespace {
+
+// 全局日志器的创建与替换；被替换的实例只关闭不释放，缓存了旧指针的线程仍可安全调用
+std::mutex& global_logger_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<Logger*>& retired_loggers() {
+    static auto* loggers = new std::vector<Logger*>();
+    return *loggers;
+}
+
+} // namespace
+
+Logger& GlobalLogger::refresh(Cache& cache) {
+    std::lock_guard<std::mutex> lock(global_logger_mutex());
+    Logger* logger = current_.load(std::memory_order_acquire);
+    if (!logger) {
+        logger = new Logger();
+        // 默认输出到文件
+        logger->initialize("flowcoro.log", LogLevel::LOG_INFO, LogOutput::FILE);
+        current_.store(logger, std::memory_order_release);
+    }
+    cache.logger = logger;
+    cache.generation = generation_.load(std::memory_order_acquire);
+    return *logger;
+}
+
+bool GlobalLogger::reinitialize(const std::string& filename, LogLevel min_level, LogOutput output) {
+    std::lock_guard<std::mutex> lock(global_logger_mutex());
+    auto* logger = new Logger();
+    bool ok = logger->initialize(filename, min_level, output);
+    Logger* old = current_.exchange(logger, std::memory_order_acq_rel);
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+    if (old) {
+        old->shutdown();
+        retired_loggers().push_back(old);
+    }
+    return ok;
+}
+
+void GlobalLogger::shutdown() {
+    std::lock_guard<std::mutex> lock(global_logger_mutex());
+    if (Logger* logger = current_.load(std::memory_order_acquire)) {
+        logger->shutdown();
+    }
+}
+
+} // namespace flowcoro
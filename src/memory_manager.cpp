@@ -0,0 +1,42 @@
+/**
+ * @file memory_manager.cpp
+ * @brief FlowCoro 全局内存管理器实现
+ */
+
+#include "flowcoro/memory.h"
+
+namespace flowcoro {
+namespace memory {
+
+GlobalMemoryManager& GlobalMemoryManager::instance() {
+    static GlobalMemoryManager manager;
+    return manager;
+}
+
+size_t GlobalMemoryManager::cleanup_all_pools() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t released = 0;
+    for (auto& [type, entry] : pools_) {
+        released += entry->trim();
+    }
+    return released;
+}
+
+GlobalMemoryManager::MemoryStats GlobalMemoryManager::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryStats stats{0, 0, pools_.size(), 0.0};
+    size_t in_use_bytes = 0;
+    for (const auto& [type, entry] : pools_) {
+        stats.total_allocated_bytes += entry->held_bytes();
+        stats.total_objects += entry->in_use_objects();
+        in_use_bytes += entry->in_use_bytes();
+    }
+    if (stats.total_allocated_bytes > 0) {
+        stats.fragmentation_ratio =
+            1.0 - static_cast<double>(in_use_bytes) / static_cast<double>(stats.total_allocated_bytes);
+    }
+    return stats;
+}
+
+} // namespace memory
+} // namespace flowcoro
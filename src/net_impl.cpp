@@ -4,9 +4,22 @@
  */
 
 #include "flowcoro/net.h"
+#include "flowcoro/io_uring.h"
+#include <poll.h>
+#include <climits>
+#include <linux/errqueue.h>
+#include <netinet/udp.h>
+#include <net/if.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #include <stdexcept>
+#include <system_error>
 #include <algorithm>
+#include <charconv>
 #include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <string_view>
 
 namespace flowcoro::net {
 
@@ -14,140 +27,625 @@ namespace flowcoro::net {
 std::unique_ptr<EventLoop> GlobalEventLoop::instance_;
 std::once_flag GlobalEventLoop::init_flag_;
 
+// io_uring请求，user_data指向它；等待者先离开（关闭或协程销毁）时waiter置空，完成事件到达后只做清理
+struct UringOp {
+    EventLoop* loop{nullptr};
+    IoWaiter* waiter{nullptr};
+    SocketIoState* acceptor{nullptr};  // 监听socket上的accept请求，socket关闭后置空
+    int fd{-1};
+    bool accept{false};
+    bool has_timeout{false};
+    __kernel_timespec timeout{};       // 链接超时，提交前必须保持有效
+    UringOp* prev{nullptr};
+    UringOp* next{nullptr};
+};
+
+namespace {
+
+// 不需要回调的请求（取消、链接超时）
+constexpr uint64_t IGNORED_USER_DATA = 0;
+// epoll fd上的multishot poll，add_fd注册的处理器由它驱动
+constexpr uint64_t EPOLL_POLL_USER_DATA = 1;
+
+// 唤醒eventfd在epoll中的data，不与任何fd/代数组合重合
+constexpr uint64_t WAKE_EVENT_DATA = ~uint64_t{0};
+
+uint64_t event_data(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+} // namespace
+
+// ============================================================================
+// IoWaiter 实现
+// ============================================================================
+
+IoWaiter::~IoWaiter() {
+    // 协程帧在操作完成前被销毁：解除登记，分离并取消进行中的请求
+    if (slot) {
+        *slot = nullptr;
+    }
+    if (op) {
+        op->waiter = nullptr;
+        op->loop->cancel_op(op);
+    }
+    if (deferred_loop) {
+        deferred_loop->forget_deferred(this);
+    }
+}
+
 // ============================================================================
 // EventLoop 实现
 // ============================================================================
 
-EventLoop::EventLoop() {
+EventLoop::EventLoop(IoBackend backend) {
     epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
     if (epoll_fd_ == -1) {
         throw std::runtime_error("Failed to create epoll fd: " + std::string(strerror(errno)));
     }
+    
+    // 唤醒fd直接注册，不经过处理器表
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.u64 = WAKE_EVENT_DATA;
+    if (wake_fd_ == -1 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) == -1) {
+        int err = errno;
+        if (wake_fd_ != -1) ::close(wake_fd_);
+        ::close(epoll_fd_);
+        throw std::runtime_error("Failed to create wakeup fd: " + std::string(strerror(err)));
+    }
+    
+    if (backend != IoBackend::EPOLL && IoUring::supported()) {
+        try {
+            uring_ = std::make_unique<IoUring>(URING_ENTRIES);
+            buffer_ring_ = IoUringBufferRing::create(*uring_, 0, RECV_BUFFER_COUNT, RECV_BUFFER_SIZE);
+            backend_ = IoBackend::IO_URING;
+        } catch (const std::system_error&) {
+            // 受资源限制等原因创建失败，回退到epoll
+            uring_.reset();
+        }
+    }
 }
 
 EventLoop::~EventLoop() {
     stop();
+    for (IoWaiter* waiter : deferred_resumes_) {
+        waiter->deferred_loop = nullptr;
+    }
+    if (uring_) {
+        // 分离所有等待者并取消进行中的请求，尽量回收完成事件后释放请求对象
+        for (UringOp* op = live_ops_; op; op = op->next) {
+            if (op->waiter) {
+                op->waiter->op = nullptr;
+                op->waiter = nullptr;
+            }
+            if (op->acceptor) {
+                op->acceptor->accept_op = nullptr;
+                op->acceptor = nullptr;
+            }
+            cancel_op(op);
+        }
+        for (int round = 0; round < 10 && live_ops_; ++round) {
+            uring_->submit_and_wait(10);
+            uring_->drain_completions([this](const io_uring_cqe& cqe) {
+                if (cqe.user_data != EPOLL_POLL_USER_DATA) {
+                    handle_completion(cqe);
+                }
+            });
+        }
+        while (live_ops_) {
+            release_op(live_ops_);
+        }
+        if (buffer_ring_) {
+            buffer_ring_->retire(*uring_);
+        }
+        uring_.reset();
+    }
+    ::close(wake_fd_);
     if (epoll_fd_ != -1) {
         ::close(epoll_fd_);
     }
 }
 
-Task<void> EventLoop::run() {
+IoBackend EventLoop::default_backend() {
+    const char* value = std::getenv("FLOWCORO_IO_BACKEND");
+    if (!value) {
+        return IoBackend::AUTO;
+    }
+    std::string_view name(value);
+    if (name == "epoll") {
+        return IoBackend::EPOLL;
+    }
+    if (name == "io_uring" || name == "uring") {
+        return IoBackend::IO_URING;
+    }
+    return IoBackend::AUTO;
+}
+
+namespace {
+
+// 合并两个epoll超时，-1表示无限
+int min_timeout(int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return std::min(a, b);
+}
+
+// 距deadline的毫秒数（向上取整，避免截断成0后空转）
+int timeout_until(std::chrono::steady_clock::time_point deadline) {
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        return -1;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (deadline <= now) {
+        return 0;
+    }
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    return static_cast<int>(std::min<int64_t>(ms, std::numeric_limits<int>::max()));
+}
+
+} // namespace
+
+void EventLoop::run() {
+    auto& scheduler = CoroutineManager::get_instance();
+    if (!scheduler.set_waker([this]() { wakeup(); })) {
+        throw std::logic_error("another EventLoop is already driving the coroutine scheduler");
+    }
+    struct WakerGuard {
+        CoroutineManager& scheduler;
+        ~WakerGuard() { scheduler.clear_waker(); }
+    } guard{scheduler};
+    
     running_.store(true, std::memory_order_release);
+    scheduler.drive();
+    while (running_.load(std::memory_order_acquire)) {
+        iterate(-1, &scheduler);
+    }
+}
+
+int EventLoop::run_once(int timeout_ms) {
+    return iterate(timeout_ms, nullptr);
+}
+
+int EventLoop::iterate(int timeout_ms, CoroutineManager* scheduler) {
+    ++iterations_;
+    
+    // 处理定时器、待执行任务和被取消的操作
+    process_timers();
+    process_pending_tasks();
+    process_deferred_resumes();
+    
+    // 等待时间：本循环和调度器最近的定时器，有立即可做的工作时不等待
+    int timeout = min_timeout(get_next_timeout(), timeout_ms);
+    if (!deferred_resumes_.empty()) {
+        timeout = 0;
+    }
+    if (scheduler && timeout != 0) {
+        timeout = scheduler->has_ready_work()
+            ? 0 : min_timeout(timeout, timeout_until(scheduler->next_timer_deadline()));
+    }
+    
+    int events = uring_ ? run_uring(timeout) : dispatch_epoll(timeout);
     
+    // IO唤醒的协程、到期的定时器在本轮恢复
+    if (scheduler) {
+        scheduler->drive();
+    }
+    return events;
+}
+
+int EventLoop::dispatch_epoll(int timeout) {
     const int max_events = 1024;
     epoll_event events[max_events];
     
-    while (running_.load(std::memory_order_acquire)) {
-        // 处理定时器和待执行任务
-        process_timers();
-        process_pending_tasks();
-        
-        // 获取下次超时时间
-        int timeout = get_next_timeout();
+    // 等待IO事件
+    int event_count = epoll_wait(epoll_fd_, events, max_events, timeout);
+    
+    if (event_count == -1) {
+        if (errno == EINTR) {
+            return 0; // 被信号中断
+        }
+        throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+    }
+    
+    // 处理IO事件：按fd直接取槽位，代数不符（已移除或fd已被重用）的事件丢弃；
+    // 回调中移除的处理器延后释放，回调后重新检查槽位
+    dispatching_ = true;
+    for (int i = 0; i < event_count; ++i) {
+        const auto& event = events[i];
         
-        // 等待IO事件
-        int event_count = epoll_wait(epoll_fd_, events, max_events, timeout);
+        if (event.data.u64 == WAKE_EVENT_DATA) {
+            // 先读再清标志：清标志之前的wakeup没有写入，但它投递的工作在下一轮开始时处理；
+            // 反过来会读掉清标志之后的写入，标志留在true，之后的wakeup全部丢失
+            uint64_t value;
+            [[maybe_unused]] ssize_t n = ::read(wake_fd_, &value, sizeof(value));
+            wake_pending_.store(false, std::memory_order_release);
+            continue;
+        }
         
-        if (event_count == -1) {
-            if (errno == EINTR) {
-                continue; // 被信号中断，继续循环
-            }
-            throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+        int fd = static_cast<int>(event.data.u64 & 0xffffffffu);
+        uint32_t generation = static_cast<uint32_t>(event.data.u64 >> 32);
+        if (!is_live(fd, generation)) {
+            continue;
         }
         
-        // 处理IO事件
-        for (int i = 0; i < event_count; ++i) {
-            const auto& event = events[i];
-            int fd = event.data.fd;
-            
-            auto handler_it = handlers_.find(fd);
-            if (handler_it == handlers_.end()) {
-                continue; // 处理器已被移除
-            }
-            
-            auto& handler = handler_it->second;
-            
-            // 处理错误和挂断事件
-            if (event.events & (EPOLLERR | EPOLLHUP)) {
-                if (handler->on_error) {
-                    handler->on_error();
-                }
-                continue;
+        bool error = event.events & (EPOLLERR | EPOLLHUP);
+        bool readable = event.events & (EPOLLIN | EPOLLRDHUP);  // 包括对端关闭写方向
+        bool writable = event.events & EPOLLOUT;
+        
+        if (SocketIoState* io = handlers_[fd].socket) {
+            // 错误和挂断对两个方向都可见，重试时由系统调用返回具体错误。
+            // 开启SO_ZEROCOPY后每个完成通知都会进入错误队列并报告EPOLLERR，socket本身并无错误：
+            // 这时只唤醒等待者（由ZeroCopyAwaiter读取错误队列），只有挂断才锁定关闭状态
+            bool failed = (event.events & EPOLLHUP) || ((event.events & EPOLLERR) && io->zerocopy != 1);
+            if (failed) {
+                io->read_closed = true;
+                io->write_closed = true;
+            } else if (event.events & EPOLLRDHUP) {
+                io->read_closed = true;
             }
-            
-            // 处理读事件
-            if (event.events & EPOLLIN) {
-                if (handler->on_read) {
-                    handler->on_read();
-                }
+            if (error || readable) {
+                io->notify(false);
             }
-            
-            // 处理写事件
-            if (event.events & EPOLLOUT) {
-                if (handler->on_write) {
-                    handler->on_write();
-                }
+            if ((error || writable) && is_live(fd, generation)) {
+                io->notify(true);
+            }
+            continue;
+        }
+        
+        IoEventHandler* handler = handlers_[fd].handler.get();
+        
+        // 处理错误和挂断事件
+        if (error) {
+            if (handler->on_error) {
+                handler->on_error();
             }
+            continue;
+        }
+        
+        if (readable && handler->on_read) {
+            handler->on_read();
         }
         
-        // 让出控制权给其他协程
-        co_await std::suspend_always{};
+        if (writable && is_live(fd, generation) && handler->on_write) {
+            handler->on_write();
+        }
     }
+    dispatching_ = false;
+    retired_handlers_.clear();
+    events_dispatched_ += static_cast<uint64_t>(event_count);
     
-    co_return;
+    return event_count;
+}
+
+int EventLoop::run_uring(int timeout) {
+    if (!epoll_poll_armed_) {
+        arm_epoll_poll();
+    }
+    if (buffer_ring_) {
+        buffer_ring_->replenish();
+    }
+    
+    // 本轮累积的SQE与等待合并为一次io_uring_enter
+    uring_->submit_and_wait(timeout);
+    unsigned count = uring_->drain_completions([this](const io_uring_cqe& cqe) {
+        handle_completion(cqe);
+    });
+    events_dispatched_ += count;
+    
+    return static_cast<int>(count);
+}
+
+EventLoop::Stats EventLoop::get_stats() const {
+    size_t timers;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        timers = timer_queue_.size();
+    }
+    return {ctl_calls_, events_dispatched_, uring_ ? uring_->get_stats().enter_calls : 0, iterations_, timers};
+}
+
+UringOp* EventLoop::new_op(IoWaiter* waiter) {
+    auto* op = new UringOp();
+    op->loop = this;
+    op->waiter = waiter;
+    op->next = live_ops_;
+    if (live_ops_) {
+        live_ops_->prev = op;
+    }
+    live_ops_ = op;
+    return op;
+}
+
+void EventLoop::release_op(UringOp* op) {
+    if (op->prev) {
+        op->prev->next = op->next;
+    } else {
+        live_ops_ = op->next;
+    }
+    if (op->next) {
+        op->next->prev = op->prev;
+    }
+    delete op;
+}
+
+void EventLoop::submit_io(IoWaiter* waiter) {
+    // 带超时的请求后面紧跟链接超时，两个SQE必须在同一次提交里
+    uring_->reserve(waiter->timeout_ms >= 0 ? 2 : 1);
+    
+    UringOp* op = new_op(waiter);
+    waiter->op = op;
+    io_uring_sqe* sqe = uring_->get_sqe();
+    waiter->prepare(sqe);
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+    
+    if (waiter->timeout_ms >= 0) {
+        op->has_timeout = true;
+        op->timeout.tv_sec = waiter->timeout_ms / 1000;
+        op->timeout.tv_nsec = static_cast<long long>(waiter->timeout_ms % 1000) * 1000000;
+        sqe->flags |= IOSQE_IO_LINK;
+        
+        io_uring_sqe* timeout_sqe = uring_->get_sqe();
+        timeout_sqe->opcode = IORING_OP_LINK_TIMEOUT;
+        timeout_sqe->fd = -1;
+        timeout_sqe->addr = reinterpret_cast<uint64_t>(&op->timeout);
+        timeout_sqe->len = 1;
+        timeout_sqe->user_data = IGNORED_USER_DATA;
+    }
+}
+
+void EventLoop::arm_accept(SocketIoState* io, int fd) {
+    UringOp* op = new_op(nullptr);
+    op->accept = true;
+    op->acceptor = io;
+    op->fd = fd;
+    io->accept_op = op;
+    
+    io_uring_sqe* sqe = uring_->get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->ioprio = multishot_accept_ ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+}
+
+void EventLoop::cancel_op(UringOp* op) {
+    io_uring_sqe* sqe = uring_->get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(op);
+    sqe->user_data = IGNORED_USER_DATA;
+}
+
+void EventLoop::arm_epoll_poll() {
+    io_uring_sqe* sqe = uring_->get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = epoll_fd_;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = EPOLL_POLL_USER_DATA;
+    epoll_poll_armed_ = true;
+}
+
+void EventLoop::handle_completion(const io_uring_cqe& cqe) {
+    if (cqe.user_data == IGNORED_USER_DATA) {
+        return;
+    }
+    if (cqe.user_data == EPOLL_POLL_USER_DATA) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            epoll_poll_armed_ = false;
+        }
+        dispatch_epoll(0);
+        return;
+    }
+    
+    auto* op = reinterpret_cast<UringOp*>(cqe.user_data);
+    if (op->accept) {
+        complete_accept(op, cqe.res, cqe.flags);
+        return;
+    }
+    
+    IoWaiter* waiter = op->waiter;
+    int result = cqe.res;
+    if (result == -ECANCELED && op->has_timeout) {
+        result = -ETIMEDOUT; // 等待者还在时只有链接超时会取消请求
+    }
+    release_op(op);
+    
+    if (!waiter) {
+        // 等待者已离开，归还内核挑选的接收缓冲区
+        if ((cqe.flags & IORING_CQE_F_BUFFER) && buffer_ring_) {
+            buffer_ring_->recycle(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+    
+    waiter->op = nullptr;
+    if (!waiter->complete(result, cqe.flags)) {
+        submit_io(waiter);
+        return;
+    }
+    waiter->resume();
+}
+
+void EventLoop::complete_accept(UringOp* op, int result, uint32_t flags) {
+    SocketIoState* io = op->acceptor;
+    int fd = op->fd;
+    if (!(flags & IORING_CQE_F_MORE)) {
+        // 请求已结束，下一次accept时重新提交
+        if (io) {
+            io->accept_op = nullptr;
+        }
+        release_op(op);
+    }
+    
+    if (!io) {
+        if (result >= 0) {
+            ::close(result); // 监听socket已关闭
+        }
+        return;
+    }
+    
+    IoWaiter* waiter = io->read_waiter;
+    if (result == -EINVAL && multishot_accept_) {
+        // 内核不支持multishot accept，改为每次accept提交一个请求
+        multishot_accept_ = false;
+        if (waiter && !io->accept_op) {
+            arm_accept(io, fd);
+        }
+        return;
+    }
+    if (result == -ECONNABORTED || result == -EINTR) {
+        if (waiter && !io->accept_op) {
+            arm_accept(io, fd);
+        }
+        return;
+    }
+    
+    if (!waiter) {
+        if (result >= 0) {
+            io->accepted.push_back(result);
+        }
+        return; // 没有等待者时的错误直接丢弃，下一次accept会重新提交
+    }
+    waiter->complete(result, 0);
+    waiter->resume();
+}
+
+void EventLoop::defer_resume(IoWaiter* waiter) {
+    waiter->deferred_loop = this;
+    deferred_resumes_.push_back(waiter);
+}
+
+void EventLoop::forget_deferred(IoWaiter* waiter) {
+    auto it = std::find(deferred_resumes_.begin(), deferred_resumes_.end(), waiter);
+    if (it != deferred_resumes_.end()) {
+        deferred_resumes_.erase(it);
+    }
+    waiter->deferred_loop = nullptr;
+}
+
+void EventLoop::process_deferred_resumes() {
+    // 恢复的协程可能关闭其他socket，继续追加到队列
+    while (!deferred_resumes_.empty()) {
+        IoWaiter* waiter = deferred_resumes_.front();
+        deferred_resumes_.erase(deferred_resumes_.begin());
+        waiter->deferred_loop = nullptr;
+        waiter->handle.resume();
+    }
 }
 
 void EventLoop::stop() {
     running_.store(false, std::memory_order_release);
+    wakeup();
+}
+
+void EventLoop::wakeup() {
+    // 一轮等待只需要一次写入
+    if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+    }
 }
 
 void EventLoop::add_fd(int fd, uint32_t events, std::unique_ptr<IoEventHandler> handler) {
+    handler->fd = fd;
+    handler->events = events;
+    register_fd(fd, events, nullptr, std::move(handler));
+}
+
+void EventLoop::register_fd(int fd, uint32_t events, SocketIoState* socket, std::unique_ptr<IoEventHandler> handler) {
+    if (fd < 0) {
+        throw std::invalid_argument("Invalid fd: " + std::to_string(fd));
+    }
+    if (static_cast<size_t>(fd) >= handlers_.size()) {
+        handlers_.resize(std::max({static_cast<size_t>(fd) + 1, handlers_.size() * 2, size_t{64}}));
+    }
+    HandlerSlot& slot = handlers_[fd];
+    
     epoll_event event{};
     event.events = events;
-    event.data.fd = fd;
+    event.data.u64 = event_data(fd, slot.generation);
     
+    ++ctl_calls_;
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
         throw std::runtime_error("Failed to add fd to epoll: " + std::string(strerror(errno)));
     }
     
-    handler->fd = fd;
-    handler->events = events;
-    handlers_[fd] = std::move(handler);
+    slot.socket = socket;
+    slot.handler = std::move(handler);
+}
+
+bool EventLoop::is_live(int fd, uint32_t generation) const {
+    if (fd < 0 || static_cast<size_t>(fd) >= handlers_.size()) {
+        return false;
+    }
+    const HandlerSlot& slot = handlers_[fd];
+    return slot.generation == generation && (slot.socket || slot.handler);
 }
 
 void EventLoop::modify_fd(int fd, uint32_t events) {
+    bool known = fd >= 0 && static_cast<size_t>(fd) < handlers_.size();
+    
     epoll_event event{};
     event.events = events;
-    event.data.fd = fd;
+    event.data.u64 = event_data(fd, known ? handlers_[fd].generation : 0);
     
+    ++ctl_calls_;
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) == -1) {
         throw std::runtime_error("Failed to modify fd in epoll: " + std::string(strerror(errno)));
     }
     
-    auto handler_it = handlers_.find(fd);
-    if (handler_it != handlers_.end()) {
-        handler_it->second->events = events;
+    if (known && handlers_[fd].handler) {
+        handlers_[fd].handler->events = events;
     }
 }
 
 void EventLoop::remove_fd(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= handlers_.size()) {
+        return;
+    }
+    HandlerSlot& slot = handlers_[fd];
+    if (!slot.socket && !slot.handler) {
+        return;
+    }
+    
+    ++ctl_calls_;
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == -1) {
         // 可能fd已经关闭，这里不抛异常
     }
     
-    handlers_.erase(fd);
+    // 本批中尚未分发的事件随代数失效
+    ++slot.generation;
+    slot.socket = nullptr;
+    if (slot.handler) {
+        slot.handler->fd = -1;
+        if (dispatching_) {
+            // 正在分发事件，处理器可能正在执行
+            retired_handlers_.push_back(std::move(slot.handler));
+        }
+        slot.handler.reset();
+    }
 }
 
 void EventLoop::post_task(std::function<void()> task) {
     pending_tasks_.enqueue(std::move(task));
+    wakeup();
 }
 
 void EventLoop::schedule_timer(std::chrono::milliseconds delay, std::function<void()> callback) {
     auto when = std::chrono::steady_clock::now() + delay;
     
-    std::lock_guard<std::mutex> lock(timer_mutex_);
-    timer_queue_.push({when, std::move(callback)});
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        earliest = timer_queue_.empty() || when < timer_queue_.top().when;
+        timer_queue_.push({when, std::move(callback)});
+    }
+    if (earliest) {
+        wakeup(); // 事件循环可能正以更长的超时等待
+    }
 }
 
 void EventLoop::process_pending_tasks() {
@@ -164,15 +662,25 @@ void EventLoop::process_pending_tasks() {
         }
         ++processed;
     }
+    if (processed == max_process) {
+        wakeup(); // 还有剩余任务，下一轮不等待
+    }
 }
 
 void EventLoop::process_timers() {
     auto now = std::chrono::steady_clock::now();
     
-    std::lock_guard<std::mutex> lock(timer_mutex_);
-    while (!timer_queue_.empty() && timer_queue_.top().when <= now) {
-        auto timer = timer_queue_.top();
-        timer_queue_.pop();
+    // 回调在锁外执行，回调中可以继续schedule_timer
+    while (true) {
+        TimerEvent timer;
+        {
+            std::lock_guard<std::mutex> lock(timer_mutex_);
+            if (timer_queue_.empty() || timer_queue_.top().when > now) {
+                break;
+            }
+            timer = timer_queue_.top();
+            timer_queue_.pop();
+        }
         
         try {
             timer.callback();
@@ -186,35 +694,210 @@ int EventLoop::get_next_timeout() {
     std::lock_guard<std::mutex> lock(timer_mutex_);
     
     if (timer_queue_.empty()) {
-        return 100; // 默认100ms超时
+        return -1; // 没有定时器，等到IO事件或被唤醒
+    }
+    return timeout_until(timer_queue_.top().when);
+}
+
+// ============================================================================
+// Endpoint 实现
+// ============================================================================
+
+Endpoint Endpoint::ipv4(const std::string& host, uint16_t port) {
+    Endpoint endpoint;
+    auto* addr = reinterpret_cast<sockaddr_in*>(&endpoint.storage_);
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (host.empty() || host == "0.0.0.0") {
+        addr->sin_addr.s_addr = INADDR_ANY;
+    } else if (inet_pton(AF_INET, host.c_str(), &addr->sin_addr) != 1) {
+        throw std::invalid_argument("Invalid IP address: " + host);
+    }
+    endpoint.size_ = sizeof(sockaddr_in);
+    return endpoint;
+}
+
+Endpoint Endpoint::ipv6(const std::string& host, uint16_t port) {
+    std::string address = host;
+    if (address.size() >= 2 && address.front() == '[' && address.back() == ']') {
+        address = address.substr(1, address.size() - 2);
     }
     
-    auto now = std::chrono::steady_clock::now();
-    auto next_timeout = timer_queue_.top().when;
-    
-    if (next_timeout <= now) {
-        return 0; // 立即超时
+    Endpoint endpoint;
+    auto* addr = reinterpret_cast<sockaddr_in6*>(&endpoint.storage_);
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(port);
+    
+    // 链路本地地址的scope：接口名或序号
+    size_t percent = address.find('%');
+    if (percent != std::string::npos) {
+        std::string scope = address.substr(percent + 1);
+        address.resize(percent);
+        unsigned index = 0;
+        auto [end, ec] = std::from_chars(scope.data(), scope.data() + scope.size(), index);
+        if (ec != std::errc() || end != scope.data() + scope.size()) {
+            index = if_nametoindex(scope.c_str());
+        }
+        if (index == 0) {
+            throw std::invalid_argument("Invalid IPv6 scope: " + scope);
+        }
+        addr->sin6_scope_id = index;
     }
     
-    auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        next_timeout - now).count();
+    if (address.empty() || address == "::") {
+        addr->sin6_addr = in6addr_any;
+    } else if (inet_pton(AF_INET6, address.c_str(), &addr->sin6_addr) != 1) {
+        throw std::invalid_argument("Invalid IPv6 address: " + host);
+    }
+    endpoint.size_ = sizeof(sockaddr_in6);
+    return endpoint;
+}
+
+Endpoint Endpoint::ip(const std::string& host, uint16_t port) {
+    return host.find(':') != std::string::npos ? ipv6(host, port) : ipv4(host, port);
+}
+
+Endpoint Endpoint::unix_path(const std::string& path) {
+    Endpoint endpoint;
+    auto* addr = reinterpret_cast<sockaddr_un*>(&endpoint.storage_);
+    if (path.empty() || path.size() >= sizeof(addr->sun_path) || path.find('\0') != std::string::npos) {
+        throw std::invalid_argument("Invalid unix socket path: " + path);
+    }
+    addr->sun_family = AF_UNIX;
+    std::memcpy(addr->sun_path, path.data(), path.size());
+    endpoint.size_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+    return endpoint;
+}
+
+Endpoint Endpoint::unix_abstract(const std::string& name) {
+    Endpoint endpoint;
+    auto* addr = reinterpret_cast<sockaddr_un*>(&endpoint.storage_);
+    if (name.size() + 1 > sizeof(addr->sun_path)) {
+        throw std::invalid_argument("Abstract socket name too long: " + name);
+    }
+    // 开头的'\0'表示抽象命名空间，名称按长度计算，不以'\0'结尾
+    addr->sun_family = AF_UNIX;
+    std::memcpy(addr->sun_path + 1, name.data(), name.size());
+    endpoint.size_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size());
+    return endpoint;
+}
+
+Endpoint Endpoint::parse(const std::string& text) {
+    if (text.starts_with("unix:")) {
+        std::string path = text.substr(5);
+        if (!path.empty() && path.front() == '@') {
+            return unix_abstract(path.substr(1));
+        }
+        return unix_path(path);
+    }
     
-    return std::min(static_cast<int>(timeout_ms), 100);
+    // "[v6]:port" 或 "v4:port"
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos || (text.front() == '[' && (colon == 0 || text[colon - 1] != ']'))) {
+        throw std::invalid_argument("Invalid endpoint: " + text);
+    }
+    std::string host = text.substr(0, colon);
+    std::string port_text = text.substr(colon + 1);
+    uint16_t port = 0;
+    auto [end, ec] = std::from_chars(port_text.data(), port_text.data() + port_text.size(), port);
+    if (host.empty() || port_text.empty() || ec != std::errc() || end != port_text.data() + port_text.size()) {
+        throw std::invalid_argument("Invalid endpoint: " + text);
+    }
+    if (host.front() == '[') {
+        return ipv6(host, port);
+    }
+    if (host.find(':') != std::string::npos) {
+        throw std::invalid_argument("IPv6 endpoint needs brackets: " + text);
+    }
+    return ipv4(host, port);
+}
+
+Endpoint Endpoint::from_sockaddr(const sockaddr* addr, socklen_t size) {
+    if (size > capacity()) {
+        throw std::invalid_argument("Socket address too long");
+    }
+    Endpoint endpoint;
+    std::memcpy(&endpoint.storage_, addr, size);
+    endpoint.size_ = size;
+    return endpoint;
+}
+
+bool Endpoint::is_abstract() const {
+    auto* addr = reinterpret_cast<const sockaddr_un*>(&storage_);
+    return is_unix() && size_ > offsetof(sockaddr_un, sun_path) && addr->sun_path[0] == '\0';
+}
+
+uint16_t Endpoint::port() const {
+    switch (family()) {
+    case AF_INET:
+        return ntohs(reinterpret_cast<const sockaddr_in*>(&storage_)->sin_port);
+    case AF_INET6:
+        return ntohs(reinterpret_cast<const sockaddr_in6*>(&storage_)->sin6_port);
+    default:
+        return 0;
+    }
+}
+
+void Endpoint::set_port(uint16_t port) {
+    if (family() == AF_INET) {
+        reinterpret_cast<sockaddr_in*>(&storage_)->sin_port = htons(port);
+    } else if (family() == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&storage_)->sin6_port = htons(port);
+    }
+}
+
+std::string Endpoint::path() const {
+    if (!is_unix() || size_ <= offsetof(sockaddr_un, sun_path)) {
+        return {}; // 未命名的Unix域socket（如socketpair）
+    }
+    auto* addr = reinterpret_cast<const sockaddr_un*>(&storage_);
+    size_t length = size_ - offsetof(sockaddr_un, sun_path);
+    if (addr->sun_path[0] == '\0') {
+        return std::string(addr->sun_path + 1, length - 1);
+    }
+    return std::string(addr->sun_path, strnlen(addr->sun_path, length));
+}
+
+std::string Endpoint::to_string() const {
+    char buffer[INET6_ADDRSTRLEN] = {};
+    switch (family()) {
+    case AF_INET: {
+        auto* addr = reinterpret_cast<const sockaddr_in*>(&storage_);
+        inet_ntop(AF_INET, &addr->sin_addr, buffer, sizeof(buffer));
+        return std::string(buffer) + ":" + std::to_string(port());
+    }
+    case AF_INET6: {
+        auto* addr = reinterpret_cast<const sockaddr_in6*>(&storage_);
+        inet_ntop(AF_INET6, &addr->sin6_addr, buffer, sizeof(buffer));
+        std::string host = buffer;
+        if (addr->sin6_scope_id != 0) {
+            host += "%" + std::to_string(addr->sin6_scope_id);
+        }
+        return "[" + host + "]:" + std::to_string(port());
+    }
+    case AF_UNIX:
+        return (is_abstract() ? "unix:@" : "unix:") + path();
+    default:
+        return {};
+    }
 }
 
 // ============================================================================
 // Socket 实现
 // ============================================================================
 
-Socket::Socket(EventLoop* loop) : loop_(loop) {
-    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+Socket::Socket(EventLoop* loop) : Socket(loop, AF_INET) {}
+
+Socket::Socket(EventLoop* loop, int family, int type) : loop_(loop), io_(std::make_shared<SocketIoState>()) {
+    fd_ = socket(family, type | SOCK_CLOEXEC, 0);
     if (fd_ == -1) {
         throw std::runtime_error("Failed to create socket: " + std::string(strerror(errno)));
     }
     make_non_blocking();
 }
 
-Socket::Socket(int fd, EventLoop* loop) : fd_(fd), loop_(loop), connected_(true) {
+Socket::Socket(int fd, EventLoop* loop)
+    : fd_(fd), loop_(loop), connected_(true), io_(std::make_shared<SocketIoState>()) {
     if (fd_ == -1) {
         throw std::invalid_argument("Invalid file descriptor");
     }
@@ -226,7 +909,7 @@ Socket::~Socket() {
 }
 
 Socket::Socket(Socket&& other) noexcept 
-    : fd_(other.fd_), loop_(other.loop_), connected_(other.connected_) {
+    : fd_(other.fd_), loop_(other.loop_), connected_(other.connected_), io_(std::move(other.io_)) {
     other.fd_ = -1;
     other.loop_ = nullptr;
     other.connected_ = false;
@@ -238,6 +921,7 @@ Socket& Socket::operator=(Socket&& other) noexcept {
         fd_ = other.fd_;
         loop_ = other.loop_;
         connected_ = other.connected_;
+        io_ = std::move(other.io_);
         other.fd_ = -1;
         other.loop_ = nullptr;
         other.connected_ = false;
@@ -245,220 +929,838 @@ Socket& Socket::operator=(Socket&& other) noexcept {
     return *this;
 }
 
-Task<void> Socket::connect(const std::string& host, uint16_t port) {
-    auto addr = create_address(host, port);
+Socket::ConnectAwaiter Socket::connect(const std::string& host, uint16_t port) {
+    return connect(Endpoint::ip(host, port));
+}
+
+Socket::ConnectAwaiter Socket::connect(const Endpoint& addr) {
+    if (uses_uring()) {
+        return ConnectAwaiter(this, addr, false, 0); // 挂起时提交IORING_OP_CONNECT
+    }
     
-    int result = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int result = ::connect(fd_, addr.data(), addr.size());
     
     if (result == 0) {
         connected_ = true;
-        co_return;
+        return ConnectAwaiter(this, addr, true, 0);
     }
     
     if (errno != EINPROGRESS) {
-        throw std::runtime_error("Connect failed: " + std::string(strerror(errno)));
+        return ConnectAwaiter(this, addr, true, errno);
     }
     
-    // 等待连接完成
-    AsyncPromise<void> connect_promise;
-    
-    auto handler = std::make_unique<IoEventHandler>();
-    handler->on_write = [&connect_promise, this]() {
-        // 检查连接状态
-        int error = 0;
-        socklen_t len = sizeof(error);
-        if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
-            connected_ = true;
-            connect_promise.set_value();
-        } else {
-            connect_promise.set_exception(
-                std::make_exception_ptr(
-                    std::runtime_error("Connect failed: " + std::string(strerror(error)))
-                )
-            );
-        }
-        loop_->remove_fd(fd_);
-    };
-    
-    handler->on_error = [&connect_promise, this]() {
-        connect_promise.set_exception(
-            std::make_exception_ptr(std::runtime_error("Connect error"))
-        );
-        loop_->remove_fd(fd_);
-    };
-    
-    loop_->add_fd(fd_, static_cast<uint32_t>(IoEvent::WRITE), std::move(handler));
-    
-    co_await connect_promise;
+    // 等待连接完成：连接建立时产生可写边沿
+    io_->write_ready = false;
+    return ConnectAwaiter(this, addr, false, 0);
 }
 
 bool Socket::bind(const std::string& host, uint16_t port) {
-    auto addr = create_address(host, port);
-    
+    return bind(Endpoint::ip(host, port));
+}
+
+bool Socket::bind(const Endpoint& endpoint) {
     // 设置地址重用
-    set_option(SO_REUSEADDR, 1);
+    if (endpoint.is_ip()) {
+        set_option(SO_REUSEADDR, 1);
+    }
     
-    return ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    return ::bind(fd_, endpoint.data(), endpoint.size()) == 0;
+}
+
+Endpoint Socket::local_endpoint() const {
+    Endpoint endpoint;
+    socklen_t size = Endpoint::capacity();
+    if (::getsockname(fd_, endpoint.data(), &size) == 0) {
+        endpoint.resize(size);
+    }
+    return endpoint;
+}
+
+Endpoint Socket::peer_endpoint() const {
+    Endpoint endpoint;
+    socklen_t size = Endpoint::capacity();
+    if (::getpeername(fd_, endpoint.data(), &size) == 0) {
+        endpoint.resize(size);
+    }
+    return endpoint;
 }
 
 bool Socket::listen(int backlog) {
     return ::listen(fd_, backlog) == 0;
 }
 
-Task<std::unique_ptr<Socket>> Socket::accept() {
-    sockaddr_in client_addr{};
-    socklen_t addr_len = sizeof(client_addr);
-    
-    int client_fd = ::accept4(fd_, reinterpret_cast<sockaddr*>(&client_addr), 
-                             &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
-    
-    if (client_fd >= 0) {
-        auto client_socket = std::make_unique<Socket>(client_fd, loop_);
-        co_return std::move(client_socket);
-    }
-    
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-        throw std::runtime_error("Accept failed: " + std::string(strerror(errno)));
-    }
-    
-    // 等待新连接
-    AsyncPromise<std::unique_ptr<Socket>> accept_promise;
-    
-    auto handler = std::make_unique<IoEventHandler>();
-    handler->on_read = [&accept_promise, this]() {
-        sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int client_fd = ::accept4(fd_, reinterpret_cast<sockaddr*>(&client_addr), 
-                                 &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
-        
-        if (client_fd >= 0) {
-            auto client_socket = std::make_unique<Socket>(client_fd, loop_);
-            accept_promise.set_value(std::move(client_socket));
+Socket::AcceptAwaiter Socket::accept() {
+    return AcceptAwaiter(this);
+}
+
+Socket::ReadAwaiter Socket::read(char* buffer, size_t size) {
+    return ReadAwaiter(this, buffer, size);
+}
+
+Socket::ReadAwaiter Socket::read(char* buffer, size_t size, std::chrono::milliseconds timeout) {
+    return ReadAwaiter(this, buffer, size, static_cast<int>(std::max<int64_t>(timeout.count(), 0)));
+}
+
+Socket::ReceiveAwaiter Socket::receive(size_t max_size) {
+    return ReceiveAwaiter(this, max_size);
+}
+
+Socket::WriteAwaiter Socket::write(const char* data, size_t size) {
+    return WriteAwaiter(this, data, size);
+}
+
+Socket::ReadvAwaiter Socket::readv(std::span<const iovec> iov) {
+    return ReadvAwaiter(this, iov);
+}
+
+Socket::WritevAwaiter Socket::writev(std::span<const iovec> iov) {
+    return WritevAwaiter(this, iov);
+}
+
+Socket::ZeroCopyAwaiter Socket::send_zerocopy(std::span<const iovec> iov) {
+    return ZeroCopyAwaiter(this, iov);
+}
+
+Socket::SendfileAwaiter Socket::sendfile(int file_fd, off_t offset, size_t count) {
+    return SendfileAwaiter(this, file_fd, offset, count);
+}
+
+Socket::SpliceAwaiter Socket::splice_to(Socket& dest, size_t count) {
+    return SpliceAwaiter(this, &dest, count);
+}
+
+Socket::MmsgAwaiter Socket::recv_many(std::span<mmsghdr> messages) {
+    return MmsgAwaiter(this, messages, false);
+}
+
+Socket::MmsgAwaiter Socket::send_many(std::span<mmsghdr> messages) {
+    return MmsgAwaiter(this, messages, true);
+}
+
+void Socket::IoAwaiterBase::throw_if_failed(const char* what) const {
+    if (error != 0) {
+        throw std::runtime_error(std::string(what) + ": " + strerror(error));
+    }
+}
+
+bool Socket::ReadAwaiter::retry() {
+    while (true) {
+        ssize_t n = ::read(socket_->fd_, buffer_, size_);
+        if (n >= 0) {
+            // 读不满说明内核缓冲区已读空，下次直接等待边沿
+            if (n > 0 && static_cast<size_t>(n) < size_) {
+                socket_->io_->drained(false);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+void Socket::ReadAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer_);
+    sqe->len = static_cast<uint32_t>(size_);
+}
+
+bool Socket::PeekAwaiter::retry() {
+    while (true) {
+        ssize_t n = ::recv(socket_->fd_, buffer_, size_, MSG_PEEK | MSG_DONTWAIT);
+        if (n >= 0) {
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+bool Socket::ReceiveAwaiter::retry() {
+    iovec iov;
+    buffer_.prepare(&iov, 1, max_size_);
+    size_t want = std::min(iov.iov_len, max_size_);
+    while (true) {
+        ssize_t n = ::read(socket_->fd_, iov.iov_base, want);
+        if (n >= 0) {
+            if (n > 0 && static_cast<size_t>(n) < want) {
+                socket_->io_->drained(false);
+            }
+            buffer_.commit(static_cast<size_t>(n));
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        buffer_.commit(0);
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+void Socket::ReceiveAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket_->fd_;
+    IoUringBufferRing* ring = socket_->loop_->buffer_ring();
+    if (use_buffer_ring_ && ring) {
+        // 由内核在数据到达时挑选缓冲区，等待期间不占用内存
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = ring->group();
+        sqe->len = static_cast<uint32_t>(std::min(max_size_, ring->buffer_size()));
+    } else {
+        use_buffer_ring_ = false;
+        iovec iov;
+        buffer_.prepare(&iov, 1, max_size_);
+        sqe->addr = reinterpret_cast<uint64_t>(iov.iov_base);
+        sqe->len = static_cast<uint32_t>(std::min(iov.iov_len, max_size_));
+    }
+}
+
+bool Socket::ReceiveAwaiter::complete(int result, uint32_t flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        auto bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        IoUringBufferRing* ring = socket_->loop_->buffer_ring();
+        if (result > 0) {
+            buffer_ = ring->adopt(bid, static_cast<size_t>(result));
         } else {
-            accept_promise.set_exception(
-                std::make_exception_ptr(
-                    std::runtime_error("Accept failed: " + std::string(strerror(errno)))
-                )
-            );
+            ring->recycle(bid);
         }
-        
-        loop_->remove_fd(fd_);
-    };
-    
-    handler->on_error = [&accept_promise, this]() {
-        accept_promise.set_exception(
-            std::make_exception_ptr(std::runtime_error("Accept error"))
-        );
-        loop_->remove_fd(fd_);
-    };
-    
-    loop_->add_fd(fd_, static_cast<uint32_t>(IoEvent::READ), std::move(handler));
+    } else if (!use_buffer_ring_) {
+        buffer_.commit(result > 0 ? static_cast<size_t>(result) : 0);
+    }
     
-    co_return co_await accept_promise;
+    if (result == -ENOBUFS && use_buffer_ring_) {
+        // 缓冲区组暂时用完，改用自己的缓冲区重新提交
+        use_buffer_ring_ = false;
+        return false;
+    }
+    if (result < 0) {
+        error = -result;
+    }
+    return true;
 }
 
-Task<ssize_t> Socket::read(char* buffer, size_t size) {
-    ssize_t result = ::read(fd_, buffer, size);
-    
-    if (result > 0) {
-        co_return result;
+bool Socket::WriteAwaiter::retry() {
+    while (true) {
+        ssize_t n = ::send(socket_->fd_, data_, size_, MSG_NOSIGNAL);
+        if (n >= 0) {
+            // 写不完说明发送缓冲区已满
+            if (static_cast<size_t>(n) < size_) {
+                socket_->io_->drained(true);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->write_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
     }
-    
-    if (result == 0) {
-        co_return 0; // EOF
+}
+
+void Socket::WriteAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(data_);
+    sqe->len = static_cast<uint32_t>(size_);
+    sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+namespace {
+
+// msghdr只引用iovec数组，超过IOV_MAX的部分留给下一次调用
+msghdr make_msghdr(std::span<const iovec> iov, size_t& total) {
+    msghdr msg{};
+    msg.msg_iov = const_cast<iovec*>(iov.data());
+    msg.msg_iovlen = std::min<size_t>(iov.size(), IOV_MAX);
+    total = 0;
+    for (size_t i = 0; i < msg.msg_iovlen; ++i) {
+        total += iov[i].iov_len;
+    }
+    return msg;
+}
+
+} // namespace
+
+Socket::ReadvAwaiter::ReadvAwaiter(Socket* socket, std::span<const iovec> iov)
+    : IoAwaiterBase(socket, false), msg_(make_msghdr(iov, size_)) {}
+
+bool Socket::ReadvAwaiter::retry() {
+    while (true) {
+        ssize_t n = ::readv(socket_->fd_, msg_.msg_iov, static_cast<int>(msg_.msg_iovlen));
+        if (n >= 0) {
+            if (n > 0 && static_cast<size_t>(n) < size_) {
+                socket_->io_->drained(false);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
     }
+}
+
+void Socket::ReadvAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg_);
+    sqe->len = 1;
+}
+
+Socket::WritevAwaiter::WritevAwaiter(Socket* socket, std::span<const iovec> iov)
+    : IoAwaiterBase(socket, true), msg_(make_msghdr(iov, size_)) {}
+
+bool Socket::WritevAwaiter::retry() {
+    while (true) {
+        ssize_t n = ::sendmsg(socket_->fd_, &msg_, MSG_NOSIGNAL);
+        if (n >= 0) {
+            if (static_cast<size_t>(n) < size_) {
+                socket_->io_->drained(true);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->write_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+void Socket::WritevAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg_);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+uint32_t Socket::PolledAwaiterBase::poll_events() const {
+    return write_side_ ? POLLOUT : POLLIN;
+}
+
+void Socket::PolledAwaiterBase::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = socket_->fd_;
+    sqe->poll32_events = poll_events();
+}
+
+bool Socket::PolledAwaiterBase::complete(int result, uint32_t) {
+    if (result < 0) {
+        error = -result;
+        return true;
+    }
+    return retry(); // 仍然EAGAIN时重新提交POLL_ADD
+}
+
+Socket::ZeroCopyAwaiter::ZeroCopyAwaiter(Socket* socket, std::span<const iovec> iov)
+    : PolledAwaiterBase(socket, true), iov_(iov.begin(), iov.end()) {
+    SocketIoState& io = *socket_->io_;
+    if (io.zerocopy == 0) {
+        int one = 1;
+        io.zerocopy = ::setsockopt(socket_->fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0 ? 1 : -1;
+    }
+}
+
+uint32_t Socket::ZeroCopyAwaiter::poll_events() const {
+    // 完成通知在错误队列里，POLLERR总会报告
+    return sending_ ? POLLOUT : POLLERR;
+}
+
+bool Socket::ZeroCopyAwaiter::retry() {
+    if (sending_ && !send_remaining()) {
+        return false;
+    }
+    sending_ = false;
     
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-        throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
+    // 出错时同样等已发出部分的通知，之后才能复用缓冲区
+    drain_notifications();
+    SocketIoState& io = *socket_->io_;
+    return io.zerocopy != 1 || io.zerocopy_acked == io.zerocopy_sent;
+}
+
+bool Socket::ZeroCopyAwaiter::send_remaining() {
+    SocketIoState& io = *socket_->io_;
+    while (next_ < iov_.size()) {
+        std::span<const iovec> rest(iov_.data() + next_, iov_.size() - next_);
+        size_t size = 0;
+        msghdr msg = make_msghdr(rest, size);
+        int flags = MSG_NOSIGNAL | (io.zerocopy == 1 ? MSG_ZEROCOPY : 0);
+        ssize_t n = ::sendmsg(socket_->fd_, &msg, flags);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                io.write_ready = false;
+                return false;
+            }
+            if (errno == ENOBUFS && io.zerocopy == 1) {
+                // 超过optmem限制：有未确认的发送时等通知，否则这一次改为普通发送
+                drain_notifications();
+                if (io.zerocopy_acked != io.zerocopy_sent) {
+                    return false;
+                }
+                flags &= ~MSG_ZEROCOPY;
+                n = ::sendmsg(socket_->fd_, &msg, flags);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    io.write_ready = false;
+                    return false;
+                }
+            }
+            if (n < 0) {
+                error = errno;
+                return true;
+            }
+        }
+        if (flags & MSG_ZEROCOPY) {
+            ++io.zerocopy_sent;
+        }
+        
+        // 跳过已发出的部分
+        sent_ += static_cast<size_t>(n);
+        size_t remaining = static_cast<size_t>(n);
+        while (next_ < iov_.size() && remaining >= iov_[next_].iov_len) {
+            remaining -= iov_[next_].iov_len;
+            ++next_;
+        }
+        if (remaining > 0) {
+            iov_[next_].iov_base = static_cast<char*>(iov_[next_].iov_base) + remaining;
+            iov_[next_].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+void Socket::ZeroCopyAwaiter::drain_notifications() {
+    SocketIoState& io = *socket_->io_;
+    if (io.zerocopy != 1) {
+        return;
+    }
+    while (io.zerocopy_acked != io.zerocopy_sent) {
+        alignas(cmsghdr) char control[128];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(socket_->fd_, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // 队列已空
+        }
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool recverr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                           (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recverr) {
+                continue;
+            }
+            sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_errno == 0 && err.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                // ee_info..ee_data为确认的序号区间（含两端）
+                io.zerocopy_acked += err.ee_data - err.ee_info + 1;
+                if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    ++io.zerocopy_copied;
+                }
+            }
+        }
+    }
+}
+
+bool Socket::SendfileAwaiter::retry() {
+    while (remaining_ > 0) {
+        ssize_t n = ::sendfile(socket_->fd_, file_fd_, &offset_, remaining_);
+        if (n > 0) {
+            sent_ += static_cast<size_t>(n);
+            remaining_ -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n == 0) {
+            break; // 文件结束
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->write_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+    return true;
+}
+
+Socket::SpliceAwaiter::~SpliceAwaiter() {
+    if (pipe_[0] != -1) {
+        ::close(pipe_[0]);
+        ::close(pipe_[1]);
+    }
+}
+
+bool Socket::SpliceAwaiter::retry() {
+    // 每次最多搬一管道的数据；长度过大时splice直接返回EINVAL
+    constexpr size_t PIPE_CAPACITY = 1 << 20;
+    constexpr unsigned FLAGS = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+    if (pipe_[0] == -1) {
+        if (::pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) == -1) {
+            error = errno;
+            return true;
+        }
+        ::fcntl(pipe_[1], F_SETPIPE_SZ, static_cast<int>(PIPE_CAPACITY)); // 失败时沿用默认的64KB
+    }
+    while (true) {
+        // 先把管道里的数据写到目标
+        if (buffered_ > 0) {
+            ssize_t n = ::splice(pipe_[0], nullptr, dest_->fd_, nullptr, buffered_, FLAGS);
+            if (n > 0) {
+                buffered_ -= static_cast<size_t>(n);
+                moved_ += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                dest_->io_->write_ready = false;
+                return wait_on(dest_, true);
+            }
+            error = n < 0 ? errno : EPIPE;
+            return true;
+        }
+        if (remaining_ == 0 || eof_) {
+            return true;
+        }
+        
+        // 管道为空时EAGAIN只能是源socket没有数据
+        ssize_t n = ::splice(source_->fd_, nullptr, pipe_[1], nullptr,
+                             std::min(remaining_, PIPE_CAPACITY), FLAGS);
+        if (n > 0) {
+            remaining_ -= static_cast<size_t>(n);
+            buffered_ += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == 0) {
+            eof_ = true;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            source_->io_->read_ready = false;
+            return wait_on(source_, false);
+        }
+        error = errno;
+        return true;
+    }
+}
+
+bool Socket::SpliceAwaiter::wait_on(Socket* target, bool write_side) {
+    if (target == socket_ && write_side == write_side_) {
+        return false; // 继续在原处等待
+    }
+    if (!slot) {
+        // 还没有挂起：await_suspend按新的目标登记
+        socket_ = target;
+        write_side_ = write_side;
+        return false;
     }
     
-    // 等待数据可读
-    AsyncPromise<ssize_t> read_promise;
+    // 已挂起：从原socket上摘下，登记到目标socket的对应方向；io_uring模式由调用者按新目标重新提交
+    IoWaiter*& target_slot = write_side ? target->io_->write_waiter : target->io_->read_waiter;
+    if (target_slot) {
+        error = EBUSY;
+        return true;
+    }
+    *slot = nullptr;
+    socket_ = target;
+    write_side_ = write_side;
+    target_slot = this;
+    slot = &target_slot;
+    if (!target->uses_uring() && !target->io_->registered) {
+        target->register_with_loop();
+    }
+    return false;
+}
+
+bool Socket::MmsgAwaiter::retry() {
+    unsigned count = static_cast<unsigned>(std::min<size_t>(messages_.size(), UIO_MAXIOV));
+    while (true) {
+        int n = write_side_
+            ? ::sendmmsg(socket_->fd_, messages_.data(), count, MSG_NOSIGNAL | MSG_DONTWAIT)
+            : ::recvmmsg(socket_->fd_, messages_.data(), count, MSG_DONTWAIT, nullptr);
+        if (n >= 0) {
+            if (static_cast<unsigned>(n) < count) {
+                socket_->io_->drained(write_side_);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            (write_side_ ? socket_->io_->write_ready : socket_->io_->read_ready) = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+bool Socket::AcceptAwaiter::await_ready() {
+    if (!socket_->uses_uring()) {
+        return try_now();
+    }
+    // multishot accept先到的连接
+    SocketIoState& io = *socket_->io_;
+    if (io.accepted_head == io.accepted.size()) {
+        return false;
+    }
+    client_fd_ = io.accepted[io.accepted_head++];
+    if (io.accepted_head == io.accepted.size()) {
+        io.accepted.clear();
+        io.accepted_head = 0;
+    }
+    return true;
+}
+
+bool Socket::AcceptAwaiter::complete(int result, uint32_t) {
+    if (result < 0) {
+        error = -result;
+    } else {
+        client_fd_ = result;
+    }
+    return true;
+}
+
+bool Socket::AcceptAwaiter::retry() {
+    while (true) {
+        int client_fd = ::accept4(socket_->fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd >= 0) {
+            client_fd_ = client_fd;
+            return true;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+std::unique_ptr<Socket> Socket::AcceptAwaiter::await_resume() {
+    throw_if_failed("Accept failed");
+    return std::make_unique<Socket>(client_fd_, loop_);
+}
+
+bool Socket::ConnectAwaiter::retry() {
+    int so_error = 0;
+    socklen_t len = sizeof(so_error);
+    if (getsockopt(socket_->fd_, SOL_SOCKET, SO_ERROR, &so_error, &len) == -1) {
+        so_error = errno;
+    }
+    error = so_error;
+    socket_->connected_ = (so_error == 0);
+    return true;
+}
+
+void Socket::ConnectAwaiter::prepare(io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(addr_.data());
+    sqe->off = addr_.size();
+}
+
+bool Socket::ConnectAwaiter::complete(int result, uint32_t) {
+    error = result < 0 ? -result : 0;
+    socket_->connected_ = (result == 0);
+    return true;
+}
+
+void Socket::register_with_loop() {
+    if (!loop_) {
+        throw std::runtime_error("Socket is not attached to an event loop");
+    }
     
-    auto handler = std::make_unique<IoEventHandler>();
-    handler->on_read = [&read_promise, this, buffer, size]() {
-        ssize_t result = ::read(fd_, buffer, size);
-        if (result >= 0) {
-            read_promise.set_value(result);
+    // 整个生命周期只注册一次，事件只更新就绪位并恢复等待者
+    loop_->register_fd(fd_, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, io_.get(), nullptr);
+    io_->registered = true;
+}
+
+namespace {
+
+// 为socket的一个方向挂上到期时间为deadline的超时定时器；定时器只持有弱引用，
+// 到期时若已被更早的定时器取代则忽略，当前等待未到截止时间则按剩余时间重新挂上
+void arm_deadline_timer(EventLoop* loop, const std::shared_ptr<SocketIoState>& io, bool write_side,
+                        std::chrono::steady_clock::time_point deadline) {
+    (write_side ? io->write_timer_at : io->read_timer_at) = deadline;
+    std::weak_ptr<SocketIoState> weak_io = io;
+    auto delay = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    loop->schedule_timer(std::max(delay, std::chrono::milliseconds(0)), [loop, weak_io, write_side, deadline]() {
+        auto io = weak_io.lock();
+        if (!io) {
+            return;
+        }
+        auto& timer_at = write_side ? io->write_timer_at : io->read_timer_at;
+        if (timer_at != deadline) {
+            return;
+        }
+        timer_at = {};
+        IoWaiter* current = write_side ? io->write_waiter : io->read_waiter;
+        auto current_deadline = write_side ? io->write_deadline : io->read_deadline;
+        if (!current || current_deadline == std::chrono::steady_clock::time_point::max()) {
+            return;
+        }
+        if (current_deadline <= std::chrono::steady_clock::now()) {
+            current->error = ETIMEDOUT;
+            current->resume();
         } else {
-            read_promise.set_exception(
-                std::make_exception_ptr(
-                    std::runtime_error("Read failed: " + std::string(strerror(errno)))
-                )
-            );
+            arm_deadline_timer(loop, io, write_side, current_deadline);
         }
-        loop_->remove_fd(fd_);
-    };
-    
-    handler->on_error = [&read_promise, this]() {
-        read_promise.set_exception(
-            std::make_exception_ptr(std::runtime_error("Read error"))
-        );
-        loop_->remove_fd(fd_);
-    };
-    
-    loop_->add_fd(fd_, static_cast<uint32_t>(IoEvent::READ), std::move(handler));
-    
-    co_return co_await read_promise;
+    });
 }
 
-Task<ssize_t> Socket::write(const char* data, size_t size) {
-    ssize_t result = ::write(fd_, data, size);
-    
-    if (result > 0) {
-        co_return result;
+} // namespace
+
+void Socket::wait(IoWaiter* waiter, bool write_side) {
+    IoWaiter*& slot = write_side ? io_->write_waiter : io_->read_waiter;
+    if (slot) {
+        throw std::logic_error("Socket already has a pending operation in this direction");
     }
     
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-        throw std::runtime_error("Write failed: " + std::string(strerror(errno)));
+    if (uses_uring()) {
+        slot = waiter;
+        waiter->slot = &slot;
+        loop_->submit_io(waiter);
+        return;
     }
     
-    // 等待可写
-    AsyncPromise<ssize_t> write_promise;
+    if (!io_->registered) {
+        register_with_loop();
+    }
+    slot = waiter;
+    waiter->slot = &slot;
     
-    auto handler = std::make_unique<IoEventHandler>();
-    handler->on_write = [&write_promise, this, data, size]() {
-        ssize_t result = ::write(fd_, data, size);
-        if (result >= 0) {
-            write_promise.set_value(result);
-        } else {
-            write_promise.set_exception(
-                std::make_exception_ptr(
-                    std::runtime_error("Write failed: " + std::string(strerror(errno)))
-                )
-            );
+    auto& deadline = write_side ? io_->write_deadline : io_->read_deadline;
+    if (waiter->timeout_ms < 0) {
+        deadline = std::chrono::steady_clock::time_point::max();
+        return;
+    }
+    // 已挂的定时器不晚于新的截止时间时由它到期后顺延，否则挂一个更早的
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waiter->timeout_ms);
+    auto timer_at = write_side ? io_->write_timer_at : io_->read_timer_at;
+    if (timer_at == std::chrono::steady_clock::time_point{} || timer_at > deadline) {
+        arm_deadline_timer(loop_, io_, write_side, deadline);
+    }
+}
+
+void Socket::wait_accept(IoWaiter* waiter) {
+    if (!uses_uring()) {
+        wait(waiter, false);
+        return;
+    }
+    if (io_->read_waiter) {
+        throw std::logic_error("Socket already has a pending operation in this direction");
+    }
+    io_->read_waiter = waiter;
+    waiter->slot = &io_->read_waiter;
+    if (!io_->accept_op) {
+        loop_->arm_accept(io_.get(), fd_);
+    }
+}
+
+void Socket::cancel_waiters() {
+    // 关闭时仍在等待的操作以ECANCELED结束，在下一轮事件循环中恢复，避免在close()调用栈里重入
+    for (IoWaiter** slot : {&io_->read_waiter, &io_->write_waiter}) {
+        if (IoWaiter* waiter = *slot) {
+            *slot = nullptr;
+            waiter->slot = nullptr;
+            if (waiter->op) {
+                // io_uring请求先分离再取消，完成事件只做清理
+                waiter->op->waiter = nullptr;
+                loop_->cancel_op(waiter->op);
+                waiter->op = nullptr;
+            }
+            waiter->error = ECANCELED;
+            loop_->defer_resume(waiter);
         }
-        loop_->remove_fd(fd_);
-    };
-    
-    handler->on_error = [&write_promise, this]() {
-        write_promise.set_exception(
-            std::make_exception_ptr(std::runtime_error("Write error"))
-        );
-        loop_->remove_fd(fd_);
-    };
-    
-    loop_->add_fd(fd_, static_cast<uint32_t>(IoEvent::WRITE), std::move(handler));
+    }
     
-    co_return co_await write_promise;
+    if (io_->accept_op) {
+        io_->accept_op->acceptor = nullptr;
+        loop_->cancel_op(io_->accept_op);
+        io_->accept_op = nullptr;
+    }
+    for (size_t i = io_->accepted_head; i < io_->accepted.size(); ++i) {
+        ::close(io_->accepted[i]);
+    }
+    io_->accepted.clear();
+    io_->accepted_head = 0;
 }
 
 Task<std::string> Socket::read_line() {
     std::string line;
-    char ch;
     
     while (true) {
-        ssize_t n = co_await read(&ch, 1);
+        // 先查看内核缓冲区，只读走到行尾为止的数据
+        char buffer[4096];
+        ssize_t n = co_await PeekAwaiter(this, buffer, sizeof(buffer));
         if (n == 0) {
             break; // EOF
         }
-        if (n < 0) {
-            throw std::runtime_error("Read failed");
+        
+        auto* newline = static_cast<const char*>(std::memchr(buffer, '\n', static_cast<size_t>(n)));
+        size_t take = newline ? static_cast<size_t>(newline - buffer) + 1 : static_cast<size_t>(n);
+        ssize_t got = ::recv(fd_, buffer, take, MSG_DONTWAIT);
+        if (got < 0) {
+            throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
         }
         
-        line += ch;
-        if (ch == '\n') {
+        line.append(buffer, static_cast<size_t>(got));
+        if (newline && static_cast<size_t>(got) == take) {
             break;
         }
     }
@@ -506,7 +1808,11 @@ Task<size_t> Socket::write_string(const std::string& data) {
 void Socket::close() {
     if (fd_ != -1) {
         if (loop_) {
-            loop_->remove_fd(fd_);
+            cancel_waiters();
+            if (io_->registered) {
+                loop_->remove_fd(fd_);
+                io_->registered = false;
+            }
         }
         ::close(fd_);
         fd_ = -1;
@@ -514,6 +1820,20 @@ void Socket::close() {
     }
 }
 
+int Socket::release() {
+    if (io_ && (io_->read_waiter || io_->write_waiter || io_->accept_op)) {
+        throw std::logic_error("Cannot release a socket with pending operations");
+    }
+    if (fd_ != -1 && loop_ && io_->registered) {
+        loop_->remove_fd(fd_);
+        io_->registered = false;
+    }
+    int fd = fd_;
+    fd_ = -1;
+    connected_ = false;
+    return fd;
+}
+
 void Socket::set_option(int option, int value) {
     if (setsockopt(fd_, SOL_SOCKET, option, &value, sizeof(value)) == -1) {
         throw std::runtime_error("Set socket option failed: " + std::string(strerror(errno)));
@@ -531,167 +1851,703 @@ void Socket::make_non_blocking() {
     }
 }
 
-sockaddr_in Socket::create_address(const std::string& host, uint16_t port) {
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    
-    if (host == "0.0.0.0" || host.empty()) {
-        addr.sin_addr.s_addr = INADDR_ANY;
-    } else {
-        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
-            throw std::invalid_argument("Invalid IP address: " + host);
+// ============================================================================
+// UdpSocket 实现
+// ============================================================================
+
+namespace {
+
+// 一条GSO消息最多的分段数（内核UDP_MAX_SEGMENTS，较老的内核为64）和IPv4下UDP载荷的上限
+constexpr size_t MAX_GSO_SEGMENTS = 64;
+constexpr size_t MAX_UDP_PAYLOAD = 65507;
+
+int open_udp_socket(int family) {
+    if (family != AF_INET && family != AF_INET6) {
+        throw std::invalid_argument("UdpSocket needs AF_INET or AF_INET6");
+    }
+    int fd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create socket: " + std::string(strerror(errno)));
+    }
+    return fd;
+}
+
+} // namespace
+
+UdpSocket::UdpSocket(EventLoop* loop, int family) : socket_(open_udp_socket(family), loop) {
+    socket_.connected_ = false;
+    int value = 0;
+    socklen_t len = sizeof(value);
+    gso_ = ::getsockopt(socket_.fd_, SOL_UDP, UDP_SEGMENT, &value, &len) == 0;
+}
+
+bool UdpSocket::bind(const std::string& host, uint16_t port) {
+    return socket_.bind(host, port);
+}
+
+bool UdpSocket::enable_gro() {
+    int on = 1;
+    gro_ = gro_ || ::setsockopt(socket_.fd_, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+    return gro_;
+}
+
+UdpSocket::MessageAwaiter UdpSocket::recv_from(char* buffer, size_t size, Endpoint& from) {
+    return MessageAwaiter(&socket_, buffer, size, &from, false);
+}
+
+UdpSocket::MessageAwaiter UdpSocket::send_to(const char* data, size_t size, const Endpoint& to) {
+    return MessageAwaiter(&socket_, data, size, const_cast<Endpoint*>(&to), true);
+}
+
+UdpSocket::RecvBatchAwaiter UdpSocket::recv_many(std::span<Datagram> datagrams) {
+    return RecvBatchAwaiter(this, datagrams);
+}
+
+UdpSocket::SendBatchAwaiter UdpSocket::send_many(std::span<const Datagram> datagrams) {
+    return SendBatchAwaiter(this, datagrams);
+}
+
+UdpSocket::MessageAwaiter::MessageAwaiter(Socket* socket, const char* data, size_t size, Endpoint* peer, bool send)
+    : IoAwaiterBase(socket, send), peer_(peer), iov_{const_cast<char*>(data), size} {
+    msg_.msg_name = peer->data();
+    msg_.msg_namelen = send ? peer->size() : Endpoint::capacity();
+    msg_.msg_iov = &iov_;
+    msg_.msg_iovlen = 1;
+}
+
+bool UdpSocket::MessageAwaiter::retry() {
+    while (true) {
+        if (!write_side_) {
+            msg_.msg_namelen = Endpoint::capacity();
+        }
+        // 数据报socket每次只收发一个数据报，成功后不清除就绪位，直到EAGAIN
+        ssize_t n = write_side_ ? ::sendmsg(socket_->fd_, &msg_, MSG_NOSIGNAL)
+                                : ::recvmsg(socket_->fd_, &msg_, 0);
+        if (n >= 0) {
+            return complete(static_cast<int>(n), 0);
+        }
+        if (errno == EINTR) {
+            continue;
         }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            (write_side_ ? socket_->io_->write_ready : socket_->io_->read_ready) = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+bool UdpSocket::MessageAwaiter::complete(int result, uint32_t) {
+    if (result >= 0 && !write_side_) {
+        peer_->resize(msg_.msg_namelen);
+    }
+    return take_result(result, result_);
+}
+
+void UdpSocket::MessageAwaiter::prepare(io_uring_sqe* sqe) {
+    if (!write_side_) {
+        msg_.msg_namelen = Endpoint::capacity();
+    }
+    sqe->opcode = write_side_ ? IORING_OP_SENDMSG : IORING_OP_RECVMSG;
+    sqe->fd = socket_->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg_);
+    sqe->len = 1;
+    sqe->msg_flags = write_side_ ? MSG_NOSIGNAL : 0;
+}
+
+UdpSocket::RecvBatchAwaiter::RecvBatchAwaiter(UdpSocket* udp, std::span<Datagram> datagrams)
+    : PolledAwaiterBase(&udp->socket_, false), udp_(udp),
+      datagrams_(datagrams.first(std::min<size_t>(datagrams.size(), UIO_MAXIOV))) {
+    Batch& batch = udp_->recv_batch_;
+    batch.messages.assign(datagrams_.size(), mmsghdr{});
+    batch.iov.resize(datagrams_.size());
+    batch.control.assign(udp_->gro_ ? datagrams_.size() * CMSG_SPACE(sizeof(int)) : 0, 0);
+    for (size_t i = 0; i < datagrams_.size(); ++i) {
+        batch.iov[i] = {datagrams_[i].data, datagrams_[i].capacity};
+        msghdr& msg = batch.messages[i].msg_hdr;
+        msg.msg_name = datagrams_[i].peer.data();
+        msg.msg_iov = &batch.iov[i];
+        msg.msg_iovlen = 1;
+    }
+}
+
+bool UdpSocket::RecvBatchAwaiter::retry() {
+    Batch& batch = udp_->recv_batch_;
+    size_t control_space = udp_->gro_ ? CMSG_SPACE(sizeof(int)) : 0;
+    while (true) {
+        // 内核会改写地址长度和控制消息长度，每次调用前重置
+        for (size_t i = 0; i < batch.messages.size(); ++i) {
+            msghdr& msg = batch.messages[i].msg_hdr;
+            msg.msg_namelen = Endpoint::capacity();
+            msg.msg_control = control_space ? &batch.control[i * control_space] : nullptr;
+            msg.msg_controllen = control_space;
+        }
+        int n = ::recvmmsg(socket_->fd_, batch.messages.data(), static_cast<unsigned>(batch.messages.size()),
+                           MSG_DONTWAIT, nullptr);
+        if (n >= 0) {
+            for (int i = 0; i < n; ++i) {
+                msghdr& msg = batch.messages[i].msg_hdr;
+                Datagram& datagram = datagrams_[i];
+                datagram.size = batch.messages[i].msg_len;
+                datagram.peer.resize(msg.msg_namelen);
+                datagram.segment_size = 0;
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                        int segment = 0;
+                        std::memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+                        if (segment > 0 && datagram.size > static_cast<size_t>(segment)) {
+                            datagram.segment_size = static_cast<uint16_t>(segment);
+                        }
+                    }
+                }
+            }
+            if (static_cast<size_t>(n) < batch.messages.size()) {
+                socket_->io_->drained(false);
+            }
+            result_ = n;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->read_ready = false;
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+UdpSocket::SendBatchAwaiter::SendBatchAwaiter(UdpSocket* udp, std::span<const Datagram> datagrams)
+    : PolledAwaiterBase(&udp->socket_, true), udp_(udp),
+      datagrams_(datagrams.first(std::min<size_t>(datagrams.size(), UIO_MAXIOV))) {
+    build();
+}
+
+void UdpSocket::SendBatchAwaiter::build() {
+    Batch& batch = udp_->send_batch_;
+    constexpr size_t CONTROL_SPACE = CMSG_SPACE(sizeof(uint16_t));
+    batch.messages.clear();
+    batch.first.clear();
+    batch.iov.resize(datagrams_.size());
+    batch.control.assign(datagrams_.size() * CONTROL_SPACE, 0);
+    
+    size_t i = 0;
+    while (i < datagrams_.size()) {
+        const Datagram& head = datagrams_[i];
+        size_t end = i + 1;
+        // GSO：后续数据报发往同一地址且与第一个等长，只有最后一个可以更短
+        if (udp_->gso_ && head.size > 0) {
+            size_t total = head.size;
+            while (end < datagrams_.size() && end - i < MAX_GSO_SEGMENTS) {
+                const Datagram& next = datagrams_[end];
+                if (!(next.peer == head.peer) || next.size == 0 || next.size > head.size ||
+                    total + next.size > MAX_UDP_PAYLOAD) {
+                    break;
+                }
+                total += next.size;
+                ++end;
+                if (next.size < head.size) {
+                    break;
+                }
+            }
+        }
+        for (size_t k = i; k < end; ++k) {
+            batch.iov[k] = {datagrams_[k].data, datagrams_[k].size};
+        }
+        
+        mmsghdr message{};
+        msghdr& msg = message.msg_hdr;
+        msg.msg_name = const_cast<sockaddr*>(head.peer.data());
+        msg.msg_namelen = head.peer.size();
+        msg.msg_iov = &batch.iov[i];
+        msg.msg_iovlen = end - i;
+        if (end - i > 1) {
+            msg.msg_control = &batch.control[batch.messages.size() * CONTROL_SPACE];
+            msg.msg_controllen = CONTROL_SPACE;
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment = static_cast<uint16_t>(head.size);
+            std::memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+        }
+        batch.messages.push_back(message);
+        batch.first.push_back(i);
+        i = end;
+    }
+    batch.first.push_back(datagrams_.size());
+}
+
+bool UdpSocket::SendBatchAwaiter::retry() {
+    Batch& batch = udp_->send_batch_;
+    if (batch.messages.empty()) {
+        return true;
+    }
+    while (true) {
+        int n = ::sendmmsg(socket_->fd_, batch.messages.data(), static_cast<unsigned>(batch.messages.size()),
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n >= 0) {
+            if (static_cast<size_t>(n) < batch.messages.size()) {
+                socket_->io_->drained(true);
+            }
+            result_ = static_cast<int>(batch.first[n]);
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket_->io_->write_ready = false;
+            return false;
+        }
+        // 路径不支持GSO（EIO：网卡不能做校验和卸载；EINVAL：分段超过MTU等）时逐个发送
+        if ((errno == EIO || errno == EINVAL) && batch.messages.size() < datagrams_.size()) {
+            bool keep_gso = errno != EIO;
+            udp_->gso_ = false;
+            build();
+            udp_->gso_ = keep_gso;
+            continue;
+        }
+        error = errno;
+        return true;
     }
-    
-    return addr;
 }
 
 // ============================================================================
 // TcpServer 实现
 // ============================================================================
 
-TcpServer::TcpServer(EventLoop* loop) : loop_(loop) {}
+namespace {
+
+// 投递给其他reactor的已接受连接：投递的任务没有执行就随事件循环销毁时（目标reactor已退出）关闭fd
+struct PostedFd {
+    int fd;
+    explicit PostedFd(int f) : fd(f) {}
+    ~PostedFd() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    PostedFd(const PostedFd&) = delete;
+    PostedFd& operator=(const PostedFd&) = delete;
+    int release() { return std::exchange(fd, -1); }
+};
+
+} // namespace
+
+TcpServer::TcpServer(EventLoop* loop, TcpServerOptions options) : loop_(loop), options_(options) {}
 
 TcpServer::~TcpServer() {
     stop();
+    // 单事件循环模式下连接协程在这里（调用者线程）销毁
+    reactors_.clear();
 }
 
 Task<void> TcpServer::listen(const std::string& host, uint16_t port) {
-    listen_socket_ = std::make_unique<Socket>(loop_);
+    start(Endpoint::ip(host, port));
+    co_return;
+}
+
+Task<void> TcpServer::listen(const Endpoint& endpoint) {
+    start(endpoint);
+    co_return;
+}
+
+void TcpServer::start(Endpoint endpoint) {
+    if (!reactors_.empty()) {
+        throw std::logic_error("TcpServer is already listening");
+    }
     
-    if (!listen_socket_->bind(host, port)) {
-        throw std::runtime_error("Failed to bind to " + host + ":" + std::to_string(port));
+    if (options_.reactors == 0) {
+        auto reactor = std::make_shared<Reactor>();
+        reactor->loop = loop_;
+        reactors_.push_back(std::move(reactor));
+    } else {
+        for (size_t i = 0; i < options_.reactors; ++i) {
+            auto reactor = std::make_shared<Reactor>();
+            reactor->owned_loop = std::make_unique<EventLoop>(options_.backend);
+            reactor->loop = reactor->owned_loop.get();
+            reactors_.push_back(std::move(reactor));
+        }
     }
     
-    if (!listen_socket_->listen()) {
-        throw std::runtime_error("Failed to listen on " + host + ":" + std::to_string(port));
+    // REUSE_PORT下每个reactor一个监听socket，其余情况只有reactor 0监听；Unix域socket不能重复绑定同一地址
+    reuse_port_ = options_.reactors > 0 && options_.balance == TcpServerOptions::Balance::REUSE_PORT &&
+                  endpoint.is_ip();
+    size_t listeners = reuse_port_ ? reactors_.size() : 1;
+    try {
+        for (size_t i = 0; i < listeners; ++i) {
+            auto socket = std::make_unique<Socket>(reactors_[i]->loop, endpoint.family());
+            if (reuse_port_) {
+                socket->set_option(SO_REUSEPORT, 1);
+            }
+            if (!socket->bind(endpoint)) {
+                throw std::runtime_error("Failed to bind to " + endpoint.to_string() + ": " + strerror(errno));
+            }
+            if (!socket->listen()) {
+                throw std::runtime_error("Failed to listen on " + endpoint.to_string() + ": " + strerror(errno));
+            }
+            if (i == 0) {
+                // 端口为0时由内核分配，其余监听socket绑定到同一端口
+                endpoint = socket->local_endpoint();
+                port_ = endpoint.port();
+            }
+            reactors_[i]->listener = std::move(socket);
+        }
+    } catch (...) {
+        reactors_.clear();
+        port_ = 0;
+        throw;
     }
+    endpoint_ = endpoint;
     
     running_.store(true, std::memory_order_release);
     
-    // 启动接受连接的协程
-    auto accept_task = accept_loop();
-    // Task会自己管理其执行
-    
-    co_return;
+    if (options_.reactors == 0) {
+        // 接受连接的协程由服务器持有，随事件循环推进
+        Reactor& reactor = *reactors_.front();
+        reactor.accept_task.emplace(accept_loop(reactor));
+    } else {
+        for (auto& reactor : reactors_) {
+            Reactor* r = reactor.get();
+            r->thread = std::thread([this, r]() { run_reactor(*r); });
+        }
+    }
 }
 
 void TcpServer::stop() {
-    running_.store(false, std::memory_order_release);
-    if (listen_socket_) {
-        listen_socket_->close();
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->loop->wakeup();
+        } else if (reactor->listener) {
+            reactor->listener->close();
+        }
+    }
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+    }
+    // 线程都已退出，不会再有新的投递：释放reactor自己的事件循环，
+    // 退出后才投递到的连接随未执行的任务一起销毁，fd在这里关闭
+    for (auto& reactor : reactors_) {
+        if (reactor->owned_loop) {
+            reactor->owned_loop.reset();
+            reactor->loop = nullptr;
+        }
+    }
+    // 删除listen时创建的socket文件
+    if (endpoint_.is_unix() && !endpoint_.is_abstract()) {
+        ::unlink(endpoint_.path().c_str());
+    }
+}
+
+std::vector<size_t> TcpServer::reactor_loads() const {
+    std::vector<size_t> loads;
+    loads.reserve(reactors_.size());
+    for (const auto& reactor : reactors_) {
+        loads.push_back(reactor->active.load(std::memory_order_relaxed));
+    }
+    return loads;
+}
+
+void TcpServer::run_reactor(Reactor& reactor) {
+    if (reactor.listener) {
+        reactor.accept_task.emplace(accept_loop(reactor));
     }
+    
+    while (running_.load(std::memory_order_acquire)) {
+        reactor.loop->run_once();
+        reap(reactor);
+    }
+    
+    // 监听socket和连接协程在本线程上释放，先处理掉已投递的连接（服务器已停止，直接关闭fd）；
+    // 事件循环留给TcpServer在join之后释放，stop()可能还在唤醒它
+    reactor.accept_task.reset();
+    reactor.listener.reset();
+    reactor.loop->run_once(0);
+    reactor.connections.clear();
+    reactor.active.store(0, std::memory_order_relaxed);
 }
 
-Task<void> TcpServer::accept_loop() {
+Task<void> TcpServer::accept_loop(Reactor& reactor) {
     while (running_.load(std::memory_order_acquire)) {
         try {
-            auto client_socket = co_await listen_socket_->accept();
-            
-            if (connection_handler_) {
-                // 创建连接处理任务并立即启动
-                auto task = connection_handler_(std::move(client_socket));
-                // Task会自己管理其执行
-            }
+            auto client_socket = co_await reactor.listener->accept();
+            dispatch(reactor, std::move(client_socket));
         } catch (const std::exception& e) {
-            if (running_.load(std::memory_order_acquire)) {
-                // 记录错误但继续运行
-                // TODO: 使用日志系统
+            if (!running_.load(std::memory_order_acquire)) {
+                break; // 监听socket已关闭
             }
+            // 记录错误但继续运行
+            // TODO: 使用日志系统
         }
     }
     
     co_return;
 }
 
+void TcpServer::dispatch(Reactor& acceptor, std::unique_ptr<Socket> client) {
+    if (!connection_handler_) {
+        return;
+    }
+    
+    Reactor& target = options_.reactors > 0 && !reuse_port_ ? pick_reactor() : acceptor;
+    target.active.fetch_add(1, std::memory_order_relaxed);
+    
+    if (&target == &acceptor) {
+        acceptor.connections.push_back(connection_handler_(std::move(client)));
+        reap(acceptor);
+        return;
+    }
+    
+    // 交给其他reactor：只传fd，Socket在目标线程上重建，之后的IO都在目标事件循环上
+    auto fd = std::make_shared<PostedFd>(client->release());
+    Reactor* r = &target;
+    target.loop->post_task([this, r, fd]() {
+        if (!running_.load(std::memory_order_acquire)) {
+            return; // fd随任务销毁时关闭
+        }
+        r->connections.push_back(connection_handler_(std::make_unique<Socket>(fd->release(), r->loop)));
+    });
+}
+
+TcpServer::Reactor& TcpServer::pick_reactor() {
+    if (options_.balance == TcpServerOptions::Balance::LEAST_LOADED) {
+        Reactor* best = reactors_.front().get();
+        for (auto& reactor : reactors_) {
+            if (reactor->active.load(std::memory_order_relaxed) < best->active.load(std::memory_order_relaxed)) {
+                best = reactor.get();
+            }
+        }
+        return *best;
+    }
+    return *reactors_[next_reactor_++ % reactors_.size()];
+}
+
+void TcpServer::reap(Reactor& reactor) {
+    // 已结束的连接协程定期回收，避免每轮都扫描全部连接；
+    // 被跳过的回收由定时器补上，否则run_once阻塞期间active停留在旧值，LEAST_LOADED会按过期负载分配
+    auto now = std::chrono::steady_clock::now();
+    if (now < reactor.next_reap) {
+        if (!reactor.reap_scheduled) {
+            reactor.reap_scheduled = true;
+            std::weak_ptr<Reactor> weak = reactor.weak_from_this();
+            auto delay = std::chrono::ceil<std::chrono::milliseconds>(reactor.next_reap - now);
+            reactor.loop->schedule_timer(delay, [weak]() {
+                if (auto r = weak.lock()) {
+                    r->reap_scheduled = false;
+                    reap(*r);
+                }
+            });
+        }
+        return;
+    }
+    reactor.next_reap = now + std::chrono::milliseconds(10);
+    
+    size_t before = reactor.connections.size();
+    std::erase_if(reactor.connections, [](const Task<void>& task) {
+        return !task.handle || task.handle.done();
+    });
+    reactor.active.fetch_sub(before - reactor.connections.size(), std::memory_order_relaxed);
+}
+
 // ============================================================================
-// TcpConnection 实现
+// BufferedReader 实现
 // ============================================================================
 
-TcpConnection::TcpConnection(std::unique_ptr<Socket> socket) 
-    : socket_(std::move(socket)) {}
+namespace {
 
-TcpConnection::~TcpConnection() {
-    close();
+// 每次读取至少留出的空间，也是缓冲区的初始大小
+constexpr size_t MIN_READ_SPACE = 16 * 1024;
+
+} // namespace
+
+BufferedReader::BufferedReader(Socket& socket, size_t max_line) : socket_(&socket), max_line_(max_line) {}
+
+BufferedReader::LineAwaiter BufferedReader::read_line(char delimiter) {
+    return LineAwaiter(this, delimiter);
 }
 
-Task<std::string> TcpConnection::read_line() {
-    // 先从缓冲区查找
-    auto pos = read_buffer_.find('\n');
-    if (pos != std::string::npos) {
-        std::string line = read_buffer_.substr(0, pos + 1);
-        read_buffer_.erase(0, pos + 1);
-        co_return line;
+BufferedReader::ExactAwaiter BufferedReader::read_exactly(size_t size) {
+    return ExactAwaiter(this, size);
+}
+
+void BufferedReader::consume() {
+    begin_ += pending_;
+    pending_ = 0;
+    if (begin_ == end_) {
+        begin_ = end_ = 0; // 读空时回到开头，不需要移动数据
+    }
+    scan_ = std::max(scan_, begin_);
+    scan_ = std::min(scan_, end_);
+}
+
+ssize_t BufferedReader::fill(size_t wanted) {
+    if (capacity_ - end_ < MIN_READ_SPACE) {
+        size_t size = end_ - begin_;
+        size_t needed = std::max(size + MIN_READ_SPACE, wanted);
+        if (begin_ > 0 && capacity_ >= needed) {
+            // 未消费的数据最多一行，移到开头的代价由之后读入的整块数据分摊
+            std::memmove(buffer_.get(), buffer_.get() + begin_, size);
+        } else {
+            size_t capacity = std::max(needed, capacity_ * 2);
+            auto buffer = std::make_unique<char[]>(capacity);
+            if (size > 0) {
+                std::memcpy(buffer.get(), buffer_.get() + begin_, size);
+            }
+            buffer_ = std::move(buffer);
+            capacity_ = capacity;
+        }
+        scan_ -= begin_;
+        end_ = size;
+        begin_ = 0;
     }
     
-    // 需要读取更多数据
     while (true) {
-        char buffer[4096];
-        ssize_t n = co_await socket_->read(buffer, sizeof(buffer));
-        
-        if (n == 0) {
-            // EOF，返回剩余数据
-            std::string line = std::move(read_buffer_);
-            read_buffer_.clear();
-            co_return line;
+        ssize_t n = ::read(socket_->fd_, buffer_.get() + end_, capacity_ - end_);
+        if (n > 0) {
+            end_ += static_cast<size_t>(n);
+            return n;
         }
-        
-        if (n < 0) {
-            throw std::runtime_error("Read failed");
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
-        
-        read_buffer_.append(buffer, n);
-        
-        // 查找换行符
-        pos = read_buffer_.find('\n');
-        if (pos != std::string::npos) {
-            std::string line = read_buffer_.substr(0, pos + 1);
-            read_buffer_.erase(0, pos + 1);
-            co_return line;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            socket_->io_->read_ready = false;
         }
+        return n;
     }
 }
 
-Task<std::string> TcpConnection::read(size_t size) {
-    if (read_buffer_.size() >= size) {
-        std::string data = read_buffer_.substr(0, size);
-        read_buffer_.erase(0, size);
-        co_return data;
+std::string_view BufferedReader::take(size_t size) {
+    pending_ = size;
+    return {buffer_.get() + begin_, size};
+}
+
+BufferedReader::LineAwaiter::LineAwaiter(BufferedReader* reader, char delimiter)
+    : PolledAwaiterBase(reader->socket_, false), reader_(reader), delimiter_(delimiter) {
+    reader_->consume();
+    if (reader_->scan_delimiter_ != delimiter) {
+        reader_->scan_delimiter_ = delimiter;
+        reader_->scan_ = reader_->begin_;
     }
-    
-    std::string data = std::move(read_buffer_);
-    read_buffer_.clear();
-    
-    while (data.size() < size) {
-        char buffer[4096];
-        size_t to_read = std::min(sizeof(buffer), size - data.size());
+}
+
+bool BufferedReader::LineAwaiter::retry() {
+    BufferedReader& r = *reader_;
+    while (true) {
+        // 只扫描上次之后新读入的数据
+        const char* base = r.buffer_.get();
+        if (r.scan_ < r.end_) {
+            auto* found = static_cast<const char*>(std::memchr(base + r.scan_, delimiter_, r.end_ - r.scan_));
+            if (found) {
+                size_t end = static_cast<size_t>(found - base) + 1;
+                if (end - r.begin_ > r.max_line_) {
+                    // 超长行和分隔符可能一次读入，找到分隔符时同样检查长度
+                    error = EMSGSIZE;
+                    return true;
+                }
+                r.scan_ = end;
+                result_ = r.take(end - r.begin_);
+                return true;
+            }
+            r.scan_ = r.end_;
+        }
+        if (r.end_ - r.begin_ >= r.max_line_) {
+            error = EMSGSIZE;
+            return true;
+        }
         
-        ssize_t n = co_await socket_->read(buffer, to_read);
+        ssize_t n = r.fill(0);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            result_ = r.take(r.end_ - r.begin_); // EOF：剩余的不完整行
+            return true;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        error = errno;
+        return true;
+    }
+}
+
+BufferedReader::ExactAwaiter::ExactAwaiter(BufferedReader* reader, size_t size)
+    : PolledAwaiterBase(reader->socket_, false), reader_(reader), size_(size) {
+    reader_->consume();
+}
+
+bool BufferedReader::ExactAwaiter::retry() {
+    BufferedReader& r = *reader_;
+    while (r.end_ - r.begin_ < size_) {
+        ssize_t n = r.fill(size_);
+        if (n > 0) {
+            continue;
+        }
         if (n == 0) {
             break; // EOF
         }
-        if (n < 0) {
-            throw std::runtime_error("Read failed");
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
         }
-        
-        data.append(buffer, n);
+        error = errno;
+        return true;
     }
-    
-    co_return data;
+    result_ = r.take(std::min(size_, r.end_ - r.begin_));
+    return true;
+}
+
+// ============================================================================
+// TcpConnection 实现
+// ============================================================================
+
+TcpConnection::TcpConnection(std::unique_ptr<Socket> socket, size_t max_line)
+    : socket_(std::move(socket)), reader_(*socket_, max_line) {}
+
+TcpConnection::~TcpConnection() {
+    close();
+}
+
+Task<std::string> TcpConnection::read_line() {
+    std::string_view line = co_await reader_.read_line();
+    co_return std::string(line);
+}
+
+Task<std::string> TcpConnection::read(size_t size) {
+    std::string_view data = co_await reader_.read_exactly(size);
+    co_return std::string(data);
 }
 
 Task<void> TcpConnection::write(const std::string& data) {
-    write_buffer_ += data;
+    write_queue_.append(data);
     co_return;
 }
 
+void TcpConnection::write(IOBuf data) {
+    write_queue_.append(std::move(data));
+}
+
 Task<void> TcpConnection::flush() {
-    if (!write_buffer_.empty()) {
-        co_await socket_->write_string(write_buffer_);
-        write_buffer_.clear();
+    // 队列中的各块直接作为iovec写出；写不完时丢弃已发送部分再继续
+    constexpr size_t MAX_SEGMENTS = 64;
+    iovec iov[MAX_SEGMENTS];
+    while (!write_queue_.empty()) {
+        size_t count = write_queue_.fill_iovec(iov, MAX_SEGMENTS);
+        ssize_t n = co_await socket_->writev(std::span<const iovec>(iov, count));
+        if (n <= 0) {
+            throw std::runtime_error("Write failed");
+        }
+        write_queue_.trim_start(static_cast<size_t>(n));
     }
-    co_return;
 }
 
 void TcpConnection::close() {
@@ -5,6 +5,11 @@
 #include <chrono>
 #include <vector>
 #include <memory>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
 
 #include "flowcoro.hpp"
 #include "test_framework.h"
@@ -81,6 +86,706 @@ TEST_CASE(memory_pool) {
     pool.deallocate(ptr);
 }
 
+// 测试内存池线程缓存与地址检查
+TEST_CASE(memory_pool_thread_cache) {
+    MemoryPool pool(64, 64);
+
+    int foreign = 0;
+    bool threw = false;
+    try {
+        pool.deallocate(&foreign);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_EXPECT_TRUE(threw);
+
+    void* block = pool.allocate();
+    TEST_EXPECT_TRUE(pool.owns(block));
+    TEST_EXPECT_FALSE(pool.owns(static_cast<char*>(block) + 1));
+    pool.deallocate(block);
+
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, &errors]() {
+            std::vector<void*> blocks;
+            for (int round = 0; round < 50; ++round) {
+                for (int i = 0; i < 100; ++i) {
+                    void* p = pool.allocate();
+                    *static_cast<uint64_t*>(p) = reinterpret_cast<uintptr_t>(p);
+                    blocks.push_back(p);
+                }
+                for (void* p : blocks) {
+                    if (*static_cast<uint64_t*>(p) != reinterpret_cast<uintptr_t>(p)) errors++;
+                    pool.deallocate(p);
+                }
+                blocks.clear();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    TEST_EXPECT_EQ(errors.load(), 0);
+
+    // 线程退出时缓存已归还共享池
+    pool.flush_thread_cache();
+    auto stats = pool.get_stats();
+    TEST_EXPECT_EQ(stats.allocated_blocks, 0u);
+    TEST_EXPECT_EQ(stats.free_blocks, stats.total_blocks);
+
+    // 同时存活的池数量不受限制，每个池都使用线程缓存（归还的块留在缓存中）
+    std::vector<std::unique_ptr<MemoryPool>> pools;
+    for (int i = 0; i < 200; ++i) {
+        pools.push_back(std::make_unique<MemoryPool>(32, 64));
+    }
+    for (auto& p : pools) {
+        p->deallocate(p->allocate());
+        TEST_EXPECT_TRUE(p->get_stats().allocated_blocks > 0);
+    }
+    std::thread([&pools]() {
+        for (auto& p : pools) p->deallocate(p->allocate());
+    }).join();
+    for (auto& p : pools) {
+        p->flush_thread_cache();
+        TEST_EXPECT_EQ(p->get_stats().allocated_blocks, 0u);
+    }
+}
+
+// 测试分级slab分配器
+TEST_CASE(slab_allocator) {
+    SlabAllocator slab(std::chrono::milliseconds(0));
+
+    TEST_EXPECT_EQ(SlabAllocator::class_index(1), 0u);
+    TEST_EXPECT_EQ(SlabAllocator::class_index(17), 1u);
+    TEST_EXPECT_EQ(SlabAllocator::class_index(64 * 1024), SlabAllocator::CLASS_COUNT - 1);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 2000; ++i) {
+        void* p = slab.allocate_bytes(100);
+        std::memset(p, 0xab, 100);
+        blocks.push_back(p);
+    }
+    void* large = slab.allocate_bytes(256 * 1024);
+    TEST_EXPECT_EQ(slab.get_stats().large_allocations, 1u);
+    slab.deallocate_bytes(large, 256 * 1024);
+
+    for (void* p : blocks) {
+        slab.deallocate_bytes(p, 100);
+    }
+    TEST_EXPECT_TRUE(slab.trim() > 0);
+    auto stats = slab.get_stats();
+    TEST_EXPECT_TRUE(stats.released_memory_bytes > 0);
+    TEST_EXPECT_EQ(stats.large_allocations, 0u);
+
+    // 归还后的slab仍可继续使用
+    void* p = slab.allocate_bytes(100);
+    std::memset(p, 0, 100);
+    slab.deallocate_bytes(p, 100);
+
+    // 作为pmr内存资源
+    std::pmr::vector<std::pmr::string> strings(&slab);
+    for (int i = 0; i < 100; ++i) {
+        strings.emplace_back("slab allocated string number " + std::to_string(i));
+    }
+    TEST_EXPECT_EQ(strings[42], std::pmr::string("slab allocated string number 42"));
+
+    // 其他线程缓存的块在trim请求后的下一次访问时归还，之后的trim可以释放这些slab
+    SlabAllocator shared(std::chrono::milliseconds(0));
+    std::atomic<int> step{0};
+    std::thread worker([&shared, &step]() {
+        std::vector<void*> local;
+        for (int i = 0; i < 5000; ++i) local.push_back(shared.allocate_bytes(100));
+        for (void* q : local) shared.deallocate_bytes(q, 100);
+        step = 1;
+        while (step.load() != 2) std::this_thread::yield();
+        shared.deallocate_bytes(shared.allocate_bytes(100), 100);
+        step = 3;
+        while (step.load() != 4) std::this_thread::yield();
+    });
+    while (step.load() != 1) std::this_thread::yield();
+    shared.trim();
+    step = 2;
+    while (step.load() != 3) std::this_thread::yield();
+    shared.trim();
+    auto shared_stats = shared.get_stats();
+    // 只有worker缓存中剩余的块所在的一个slab仍驻留
+    TEST_EXPECT_TRUE(shared_stats.total_memory_bytes - shared_stats.released_memory_bytes <= 64 * 1024);
+    step = 4;
+    worker.join();
+}
+
+// 测试缓存友好内存池 - 无状态句柄、紧凑排列与跨线程归还
+TEST_CASE(iobuf) {
+    IOBuf buf;
+    buf.append("world");
+    buf.prepend("hello ");
+    TEST_EXPECT_EQ(buf.to_string(), std::string("hello world"));
+
+    // 大块数据跨越多个内存块
+    std::string big(100 * 1024, 'x');
+    buf.append(big);
+    TEST_EXPECT_EQ(buf.size(), 11u + big.size());
+    TEST_EXPECT_TRUE(buf.segment_count() >= 2u);
+
+    // split共享边界块，之后在原缓冲区追加不会影响已取出的部分
+    IOBuf head = buf.split(5);
+    TEST_EXPECT_EQ(head.to_string(), std::string("hello"));
+    TEST_EXPECT_EQ(buf.size(), 6u + big.size());
+    head.append("!");
+    TEST_EXPECT_EQ(head.to_string(), std::string("hello!"));
+    TEST_EXPECT_EQ(buf.to_string().substr(0, 6), std::string(" world"));
+
+    IOBuf view = buf.slice(1, 5);
+    TEST_EXPECT_EQ(view.to_string(), std::string("world"));
+    TEST_EXPECT_EQ(buf.find('x'), 6u);
+    TEST_EXPECT_EQ(buf.find('y'), IOBuf::npos);
+
+    buf.trim_end(big.size() - 10);
+    buf.append(std::move(head));
+    TEST_EXPECT_EQ(buf.to_string(), std::string(" world") + std::string(10, 'x') + "hello!");
+    TEST_EXPECT_TRUE(buf.segment_count() > 1u);
+    std::string_view flat = buf.coalesce();
+    TEST_EXPECT_EQ(buf.segment_count(), 1u);
+    TEST_EXPECT_EQ(std::string(flat), buf.to_string());
+
+    // std::string零拷贝接管
+    std::string owned(64, 'z');
+    const char* raw = owned.data();
+    IOBuf adopted = IOBuf::from_string(std::move(owned));
+    TEST_EXPECT_TRUE(adopted.segment(0).data() == raw);
+
+    // readv/writev接口
+    int fds[2];
+    TEST_EXPECT_EQ(::pipe(fds), 0);
+    iovec out[8];
+    size_t out_count = buf.fill_iovec(out, 8);
+    TEST_EXPECT_EQ(static_cast<size_t>(::writev(fds[1], out, static_cast<int>(out_count))), buf.size());
+    IOBuf received;
+    iovec in[4];
+    size_t in_count = received.prepare(in, 4, 16);
+    ssize_t n = ::readv(fds[0], in, static_cast<int>(in_count));
+    received.commit(static_cast<size_t>(n));
+    ::close(fds[0]);
+    ::close(fds[1]);
+    TEST_EXPECT_EQ(received.to_string(), buf.to_string());
+}
+
+TEST_CASE(string_buffer) {
+    StringBuffer sb(16);
+    sb.append("id=");
+    sb.append_number(42);
+    sb.append(',');
+    sb.append_number(-7L);
+    TEST_EXPECT_EQ(std::string(sb.view()), std::string("id=42,-7"));
+
+    // 超过剩余空间和旧的1KiB临时缓冲区的格式化结果不会被截断
+    std::string long_text(3000, 'a');
+    sb.append_format("[%s|%d]", long_text.c_str(), 5);
+    TEST_EXPECT_EQ(sb.size(), 8u + long_text.size() + 4u);
+    TEST_EXPECT_EQ(std::strlen(sb.c_str()), sb.size());
+
+    // 移动后数据仍然有效（包括短字符串）
+    StringBuffer small(8);
+    small.append("hi");
+    StringBuffer moved(std::move(small));
+    TEST_EXPECT_EQ(std::string(moved.c_str()), std::string("hi"));
+
+    // release不复制底层内存
+    const char* raw = sb.data();
+    std::string released = sb.release();
+    TEST_EXPECT_TRUE(released.data() == raw);
+    TEST_EXPECT_EQ(released.size(), 8u + long_text.size() + 4u);
+    TEST_EXPECT_TRUE(sb.empty());
+
+    sb.append("payload");
+    raw = sb.data();
+    IOBuf buf = sb.release_iobuf();
+    TEST_EXPECT_EQ(buf.to_string(), std::string("payload"));
+    TEST_EXPECT_TRUE(buf.segment(0).data() == raw);
+}
+
+TEST_CASE(cache_friendly_memory_pool) {
+    struct Small {
+        int a;
+        int b;
+        Small(int x, int y) : a(x), b(y) {}
+    };
+
+    using PaddedPool = CacheFriendlyMemoryPool<Small>;
+    using DensePool = CacheFriendlyMemoryPool<Small, 256, true>;
+    TEST_EXPECT_EQ(sizeof(PaddedPool::Handle), sizeof(Small*));
+    TEST_EXPECT_EQ(PaddedPool::block_size(), CACHE_LINE_SIZE);
+    TEST_EXPECT_EQ(DensePool::block_size(), sizeof(Small));
+    TEST_EXPECT_TRUE(DensePool::objects_per_chunk() >= 256u);
+
+    DensePool pool;
+    auto first = pool.acquire(1, 2);
+    TEST_EXPECT_EQ(first->a + first->b, 3);
+    first.reset();
+
+    // 一个线程分配，另一个线程释放
+    const int count = 5000;
+    lockfree::BoundedQueue<DensePool::Handle, 8192> handoff;
+    std::atomic<int> errors{0};
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            auto obj = pool.acquire(i, -i);
+            while (!handoff.try_push(std::move(obj))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread consumer([&]() {
+        for (int received = 0; received < count;) {
+            DensePool::Handle obj;
+            if (handoff.try_pop(obj)) {
+                if (obj->a + obj->b != 0) errors++;
+                obj.reset();
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    producer.join();
+    consumer.join();
+    TEST_EXPECT_EQ(errors.load(), 0);
+
+    pool.flush_thread_cache();
+    auto stats = pool.get_stats();
+    TEST_EXPECT_EQ(stats.allocated_count, 0u);
+    TEST_EXPECT_TRUE(pool.trim() > 0);
+}
+
+// 测试全局内存管理器
+TEST_CASE(global_memory_manager) {
+    struct Payload {
+        int id;
+        std::string name;
+        Payload(int i, std::string n) : id(i), name(std::move(n)) {}
+    };
+
+    auto& manager = memory::GlobalMemoryManager::instance();
+    auto pool = manager.get_pool<Payload>();
+    TEST_EXPECT_TRUE(pool == manager.get_pool<Payload>());
+
+    {
+        std::vector<decltype(pool->acquire(0, std::string()))> objects;
+        for (int i = 0; i < 200; ++i) {
+            objects.push_back(pool->acquire(i, "payload-" + std::to_string(i)));
+        }
+        TEST_EXPECT_EQ(objects[150]->name, std::string("payload-150"));
+
+        auto stats = manager.get_stats();
+        TEST_EXPECT_TRUE(stats.pool_count >= 1u);
+        TEST_EXPECT_TRUE(stats.total_objects >= 200u);
+        TEST_EXPECT_TRUE(stats.total_allocated_bytes >= 200 * sizeof(Payload));
+    }
+
+    size_t before = manager.get_stats().total_allocated_bytes;
+    TEST_EXPECT_TRUE(manager.cleanup_all_pools() > 0);
+    TEST_EXPECT_TRUE(manager.get_stats().total_allocated_bytes < before);
+
+    // 回收后仍可继续分配
+    auto obj = pool->acquire(7, "again");
+    TEST_EXPECT_EQ(obj->id, 7);
+}
+
+// 只通过operator co_await提供awaiter的类型
+// await_suspend返回false：经过挂起路径但立即继续执行
+struct ValueAwaiter {
+    int value;
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<>) const noexcept { return false; }
+    int await_resume() const noexcept { return value; }
+};
+
+struct MemberCoAwait {
+    int value;
+    ValueAwaiter operator co_await() const noexcept { return {value}; }
+};
+
+struct FreeCoAwait {
+    int value;
+};
+
+ValueAwaiter operator co_await(FreeCoAwait awaitable) noexcept {
+    return {awaitable.value * 2};
+}
+
+// 测试请求级arena及其在协程间的传递
+TEST_CASE(request_arena) {
+    RequestArena arena(1024);
+    void* a = arena.allocate(100, 8);
+    void* b = arena.allocate(100, 64);
+    TEST_EXPECT_EQ(static_cast<char*>(b) - static_cast<char*>(a) >= 100, true);
+    TEST_EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 64, 0u);
+    TEST_EXPECT_EQ(arena.allocation_count(), 2u);
+
+    // 超出当前块时申请新块，reset后保留最近的一块
+    TEST_EXPECT_TRUE(arena.allocate(4000, 8) != nullptr);
+    TEST_EXPECT_EQ(arena.block_count(), 2u);
+    arena.reset();
+    TEST_EXPECT_EQ(arena.block_count(), 1u);
+    TEST_EXPECT_EQ(arena.bytes_allocated(), 0u);
+
+    // pmr类型默认使用当前arena
+    {
+        ArenaScope scope(&arena);
+        rpc::pmr::RpcMessage msg = rpc::pmr::RpcMessage::from_json(
+            R"({"id":"7","method":"echo","params":{"text":"a fairly long parameter string"},"is_request":true})");
+        TEST_EXPECT_TRUE(msg.get_allocator().resource() == &arena);
+        TEST_EXPECT_EQ(std::string(msg.method), std::string("echo"));
+
+        db::pmr::SimpleDocument doc("user-1");
+        doc.set("name", "a name that does not fit into the small string buffer");
+        TEST_EXPECT_TRUE(doc.has("name"));
+        TEST_EXPECT_TRUE(doc.fields.get_allocator().resource() == &arena);
+
+        auto response = net::parse_http_response(
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nhello",
+            std::pmr::polymorphic_allocator<char>(current_memory_resource()));
+        TEST_EXPECT_EQ(response.status_code, 200);
+        TEST_EXPECT_EQ(std::string(response.headers.begin()->second), std::string("text/plain"));
+        TEST_EXPECT_EQ(std::string(response.body), std::string("hello"));
+    }
+    TEST_EXPECT_TRUE(current_arena() == nullptr);
+    TEST_EXPECT_TRUE(arena.allocation_count() > 0u);
+
+    // 子协程继承创建时的arena，由调度器恢复后仍然可见
+    auto child = []() -> Task<bool> {
+        auto* before = current_arena();
+        co_await sleep_for(std::chrono::milliseconds(1));
+        co_return before != nullptr && current_arena() == before;
+    };
+    // 协程体内的ArenaScope只作用于其作用域
+    auto inner = []() -> Task<bool> {
+        co_return current_arena() != nullptr;
+    };
+    auto parent = [&inner, &arena]() -> Task<bool> {
+        bool ok = false;
+        {
+            ArenaScope scope(&arena);
+            ok = co_await inner();
+            ok = ok && current_arena() == &arena;
+        }
+        co_return ok && current_arena() == nullptr;
+    };
+
+    Task<bool> task = [&]() {
+        ArenaScope scope(&arena);
+        return child();
+    }();
+    auto& manager = CoroutineManager::get_instance();
+    for (int i = 0; i < 1000 && !task.handle.done(); ++i) {
+        manager.drive();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    TEST_EXPECT_TRUE(task.handle.done());
+    TEST_EXPECT_TRUE(task.get());
+    TEST_EXPECT_TRUE(sync_wait(parent()));
+    TEST_EXPECT_TRUE(current_arena() == nullptr);
+
+    // arena Task中co_await只提供operator co_await的类型
+    auto co_await_only = [&arena]() -> Task<int> {
+        ArenaScope scope(&arena);
+        MemberCoAwait member{20};
+        int total = co_await member;
+        total += co_await FreeCoAwait{11};
+        co_return current_arena() == &arena ? total : -1;
+    };
+    TEST_EXPECT_EQ(sync_wait(co_await_only()), 42);
+    TEST_EXPECT_TRUE(current_arena() == nullptr);
+}
+
+// 测试二进制日志：调用线程只记录参数，写入线程格式化
+TEST_CASE(binary_logger) {
+    std::string path = "/tmp/flowcoro_logger_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(path.c_str());
+    Logger logger;
+    TEST_EXPECT_TRUE(logger.initialize(path, LogLevel::TRACE, LogOutput::FILE));
+
+    static constexpr LogSite typed_site{LogLevel::LOG_INFO, __FILE__, __LINE__,
+        "v=%d u=%zu r=%.2f s=%s w=[%5s] l=[%-3d] x=%#x %%"};
+    static constexpr LogSite long_site{LogLevel::LOG_WARN, __FILE__, __LINE__, "long=%s"};
+    static constexpr LogSite thread_site{LogLevel::LOG_DEBUG, __FILE__, __LINE__, "t%d-%d"};
+
+    logger.log(typed_site, -42, size_t(1) << 40, 0.125, std::string("alice"), "ab", 7, 255u);
+    std::string long_text(2000, 'q');
+    logger.log(long_site, long_text.c_str());
+
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&logger, t]() {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                logger.log(thread_site, t, i);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    logger.flush();
+    logger.shutdown();
+
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    TEST_EXPECT_TRUE(content.find("v=-42 u=1099511627776 r=0.12 s=alice w=[   ab] l=[7  ] x=0xff %") != std::string::npos);
+    TEST_EXPECT_TRUE(content.find("long=" + long_text + "\n") != std::string::npos);
+
+    // 每个线程的日志完整且保持各自的顺序
+    bool ordered = true;
+    size_t lines = 0;
+    for (int t = 0; t < THREADS; ++t) {
+        size_t pos = 0;
+        for (int i = 0; i < PER_THREAD; ++i) {
+            std::string needle = "t" + std::to_string(t) + "-" + std::to_string(i) + "\n";
+            size_t found = content.find(needle, pos);
+            if (found == std::string::npos) {
+                ordered = false;
+                break;
+            }
+            pos = found + needle.size();
+            ++lines;
+        }
+    }
+    TEST_EXPECT_TRUE(ordered);
+    TEST_EXPECT_EQ(lines, static_cast<size_t>(THREADS * PER_THREAD));
+    TEST_EXPECT_EQ(logger.get_stats().dropped_logs, 0u);
+    std::remove(path.c_str());
+}
+
+// 测试各线程缓冲区按时间戳归并，以及按级别的溢出策略
+TEST_CASE(logger_merge_and_policy) {
+    std::string path = "/tmp/flowcoro_logger_policy_" + std::to_string(::getpid()) + ".log";
+    std::remove(path.c_str());
+
+    static constexpr LogSite seq_site{LogLevel::LOG_INFO, __FILE__, __LINE__, "seq=%d"};
+    static constexpr LogSite debug_site{LogLevel::LOG_DEBUG, __FILE__, __LINE__, "noise %d %s"};
+    static constexpr LogSite error_site{LogLevel::LOG_ERROR, __FILE__, __LINE__, "error=%d"};
+
+    {
+        // 写入线程启动前两个线程交替记录，启动后应按时间顺序输出
+        Logger logger;
+        logger.set_level(LogLevel::TRACE);
+        std::atomic<int> turn{0};
+        constexpr int COUNT = 40;
+        auto worker = [&](int parity) {
+            for (int i = parity; i < COUNT; i += 2) {
+                while (turn.load() != i) std::this_thread::yield();
+                logger.log(seq_site, i);
+                turn.store(i + 1);
+            }
+        };
+        std::thread a(worker, 0);
+        std::thread b(worker, 1);
+        a.join();
+        b.join();
+        TEST_EXPECT_TRUE(logger.initialize(path, LogLevel::TRACE, LogOutput::FILE));
+        logger.flush();
+        logger.shutdown();
+
+        std::ifstream in(path);
+        std::string line;
+        int expected = 0;
+        bool ordered = true;
+        while (std::getline(in, line)) {
+            if (line.find("seq=" + std::to_string(expected)) == std::string::npos) {
+                ordered = false;
+                break;
+            }
+            ++expected;
+        }
+        TEST_EXPECT_TRUE(ordered);
+        TEST_EXPECT_EQ(expected, COUNT);
+    }
+    std::remove(path.c_str());
+
+    {
+        // 小缓冲区下大量DEBUG日志被丢弃，ERROR日志阻塞等待，一条不丢
+        Logger logger;
+        logger.set_thread_buffer_size(4096);
+        TEST_EXPECT_TRUE(logger.initialize(path, LogLevel::TRACE, LogOutput::FILE));
+        TEST_EXPECT_TRUE(logger.level_policy(LogLevel::LOG_ERROR).overflow == LogOverflowPolicy::BLOCK);
+        std::string padding(200, 'd');
+        constexpr int ERRORS = 200;
+        std::thread producer([&]() {
+            for (int i = 0; i < ERRORS; ++i) {
+                for (int j = 0; j < 20; ++j) {
+                    logger.log(debug_site, j, padding);
+                }
+                logger.log(error_site, i);
+            }
+        });
+        producer.join();
+        logger.flush();
+        logger.shutdown();
+
+        auto stats = logger.get_stats();
+        TEST_EXPECT_TRUE(stats.dropped_by_level[static_cast<size_t>(LogLevel::LOG_DEBUG)] > 0u);
+        TEST_EXPECT_EQ(stats.dropped_by_level[static_cast<size_t>(LogLevel::LOG_ERROR)], 0u);
+
+        std::ifstream in(path);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bool all_errors = true;
+        for (int i = 0; i < ERRORS; ++i) {
+            if (content.find("error=" + std::to_string(i) + "\n") == std::string::npos) {
+                all_errors = false;
+                break;
+            }
+        }
+        TEST_EXPECT_TRUE(all_errors);
+    }
+    std::remove(path.c_str());
+
+    {
+        // SAMPLE策略：超出份额后按比例保留
+        Logger logger;
+        logger.set_thread_buffer_size(4096);
+        logger.set_level(LogLevel::TRACE);
+        logger.set_level_policy(LogLevel::LOG_DEBUG, {0.25, LogOverflowPolicy::SAMPLE, 4});
+        TEST_EXPECT_EQ(logger.level_policy(LogLevel::LOG_DEBUG).sample_every, 4u);
+        std::string padding(200, 's');
+        for (int i = 0; i < 200; ++i) {
+            logger.log(debug_site, i, padding);
+        }
+        auto stats = logger.get_stats();
+        uint64_t dropped = stats.dropped_by_level[static_cast<size_t>(LogLevel::LOG_DEBUG)];
+        TEST_EXPECT_TRUE(dropped > 0u);
+        TEST_EXPECT_TRUE(stats.total_logs > 4u);
+        TEST_EXPECT_EQ(stats.total_logs + dropped, 200u);
+    }
+}
+
+// 测试LOG_*宏的惰性求值与全局日志器切换
+TEST_CASE(log_macro_lazy_evaluation) {
+    std::string path = "/tmp/flowcoro_logger_macro_" + std::to_string(::getpid()) + ".log";
+    std::remove(path.c_str());
+    TEST_EXPECT_TRUE(GlobalLogger::reinitialize(path, LogLevel::LOG_WARN, LogOutput::FILE));
+
+    int evaluated = 0;
+    auto count = [&evaluated]() { return ++evaluated; };
+
+    // 运行期关闭的级别不对参数求值
+    LOG_INFO("info %d", count());
+    LOG_DEBUG("debug %d", count());
+    TEST_EXPECT_EQ(evaluated, 0);
+
+    LOG_WARN("warn %d", count());
+    TEST_EXPECT_EQ(evaluated, 1);
+
+    // 编译期移除的级别即使运行期打开也不求值
+    GlobalLogger::get().set_level(LogLevel::TRACE);
+    LOG_TRACE("trace %d", count());
+#if FLOWCORO_LOG_ACTIVE_LEVEL <= FLOWCORO_LOG_LEVEL_TRACE
+    TEST_EXPECT_EQ(evaluated, 2);
+#else
+    TEST_EXPECT_EQ(evaluated, 1);
+#endif
+
+    // 重新初始化后其他线程的缓存指针随之更新
+    Logger* before = &GlobalLogger::get();
+    std::thread([]() { LOG_ERROR("from %s", "thread"); }).join();
+    TEST_EXPECT_TRUE(GlobalLogger::reinitialize(path, LogLevel::LOG_ERROR, LogOutput::FILE));
+    Logger* after = nullptr;
+    std::thread([&after]() { after = &GlobalLogger::get(); }).join();
+    TEST_EXPECT_TRUE(after != before);
+    TEST_EXPECT_TRUE(after == &GlobalLogger::get());
+    LOG_WARN("warn %d", count());
+    TEST_EXPECT_TRUE(GlobalLogger::enabled_for(LogLevel::LOG_WARN) == nullptr);
+
+    GlobalLogger::get().flush();
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    TEST_EXPECT_TRUE(content.find("from thread") != std::string::npos);
+
+    GlobalLogger::reinitialize("flowcoro.log", LogLevel::LOG_INFO, LogOutput::FILE);
+    std::remove(path.c_str());
+}
+
+// 测试日志文件的批量写出、轮转与切换
+TEST_CASE(log_file_sink) {
+    std::string path = "/tmp/flowcoro_logger_sink_" + std::to_string(::getpid()) + ".log";
+    auto remove_all = [&path]() {
+        std::remove(path.c_str());
+        for (int i = 1; i <= 4; ++i) {
+            std::remove((path + "." + std::to_string(i)).c_str());
+        }
+    };
+    auto read_file = [](const std::string& file) {
+        std::ifstream in(file);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    remove_all();
+
+    static constexpr LogSite seq_site{LogLevel::LOG_INFO, __FILE__, __LINE__, "seq=%d %s"};
+    std::string padding(40, 'p');
+
+    {
+        // 按大小轮转，只保留2个历史文件；拼接后的记录连续且没有被拆开的行
+        Logger logger;
+        LogFilePolicy policy;
+        policy.buffer_size = 4096;
+        policy.rotate_bytes = 8192;
+        policy.max_files = 2;
+        policy.fsync = LogFsyncPolicy::ALWAYS;
+        logger.set_file_policy(policy);
+        TEST_EXPECT_TRUE(logger.initialize(path, LogLevel::LOG_INFO, LogOutput::FILE));
+        constexpr int COUNT = 600;
+        for (int i = 0; i < COUNT; ++i) {
+            logger.log(seq_site, i, padding);
+        }
+        logger.flush();
+        logger.shutdown();
+
+        auto stats = logger.get_stats();
+        TEST_EXPECT_TRUE(stats.file.rotations >= 2u);
+        TEST_EXPECT_TRUE(stats.file.syncs > 0u);
+        TEST_EXPECT_EQ(stats.file.errors, 0u);
+        TEST_EXPECT_TRUE(stats.file.write_calls < static_cast<uint64_t>(COUNT));
+        TEST_EXPECT_TRUE(read_file(path + ".3").empty());
+
+        std::string content = read_file(path + ".2") + read_file(path + ".1") + read_file(path);
+        std::istringstream lines(content);
+        std::string line;
+        int expected = -1;
+        bool consecutive = true;
+        while (std::getline(lines, line)) {
+            size_t pos = line.find("seq=");
+            if (pos == std::string::npos || line.find(padding) == std::string::npos) {
+                consecutive = false;
+                break;
+            }
+            int seq = std::stoi(line.substr(pos + 4));
+            if (expected >= 0 && seq != expected) {
+                consecutive = false;
+                break;
+            }
+            expected = seq + 1;
+        }
+        TEST_EXPECT_TRUE(consecutive);
+        TEST_EXPECT_EQ(expected, COUNT);
+    }
+    remove_all();
+
+    {
+        // 切换文件：切换前的记录留在原文件，之后的写入新文件
+        std::string other = path + ".4";
+        Logger logger;
+        TEST_EXPECT_TRUE(logger.initialize(path, LogLevel::LOG_INFO, LogOutput::FILE));
+        logger.log(seq_site, 1, "before");
+        TEST_EXPECT_TRUE(logger.set_log_file(other));
+        logger.log(seq_site, 2, "after");
+        logger.flush();
+        std::string first = read_file(path);
+        std::string second = read_file(other);
+        TEST_EXPECT_TRUE(first.find("seq=1 before") != std::string::npos);
+        TEST_EXPECT_TRUE(first.find("after") == std::string::npos);
+        TEST_EXPECT_TRUE(second.find("seq=2 after") != std::string::npos);
+        logger.shutdown();
+    }
+    remove_all();
+}
+
 // 测试对象池
 TEST_CASE(object_pool) {
     struct TestObject {
@@ -109,6 +814,89 @@ TEST_CASE(object_pool) {
     TEST_EXPECT_TRUE(obj3 != nullptr);
 }
 
+// 测试对象池的重置钩子、容量上限与多线程复用
+TEST_CASE(object_pool_thread_cache) {
+    struct RequestContext {
+        std::string body;
+        int resets = 0;
+        void pool_reset() {
+            body.clear();  // 保留容量
+            ++resets;
+        }
+    };
+
+    ObjectPool<RequestContext, 64> pool(0);
+    auto ctx = pool.acquire();
+    ctx->body.assign(1000, 'x');
+    size_t capacity = ctx->body.capacity();
+    RequestContext* raw = ctx.get();
+    pool.release(std::move(ctx));
+
+    auto again = pool.acquire();
+    TEST_EXPECT_TRUE(again.get() == raw);
+    TEST_EXPECT_TRUE(again->body.empty());
+    TEST_EXPECT_EQ(again->body.capacity(), capacity);
+    TEST_EXPECT_EQ(again->resets, 1);
+    pool.release(std::move(again));
+
+    auto stats = pool.get_stats();
+    TEST_EXPECT_EQ(stats.misses, 1u);
+    TEST_EXPECT_EQ(stats.hits, 1u);
+
+    // 多线程反复获取/归还
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool]() {
+            std::vector<std::unique_ptr<RequestContext>> held;
+            for (int round = 0; round < 100; ++round) {
+                for (int i = 0; i < 50; ++i) {
+                    held.push_back(pool.acquire());
+                }
+                for (auto& obj : held) {
+                    pool.release(std::move(obj));
+                }
+                held.clear();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    // 仓库保留数量不超过上限，多余对象被销毁
+    pool.flush_thread_cache();
+    stats = pool.get_stats();
+    TEST_EXPECT_TRUE(stats.retained <= 64u);
+    TEST_EXPECT_TRUE(stats.hits > stats.misses);
+    TEST_EXPECT_TRUE(stats.hit_rate > 0.5);
+
+    // 没有pool_reset()的类型归还时不做处理，智能指针不会被reset()清空
+    ObjectPool<std::unique_ptr<int>, 4> holders(0);
+    auto holder = holders.acquire();
+    *holder = std::make_unique<int>(7);
+    int* payload = holder->get();
+    holders.release(std::move(holder));
+    auto reused = holders.acquire();
+    TEST_EXPECT_TRUE(reused->get() == payload);
+    TEST_EXPECT_EQ(**reused, 7);
+
+    // HttpResponse归还时清空内容，字符串和头部表保留容量
+    ObjectPool<net::HttpResponse, 4> responses(0);
+    auto response = responses.acquire();
+    *response = net::parse_http_response(
+        "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n\r\n" + std::string(500, 'b'));
+    TEST_EXPECT_EQ(response->status_code, 404);
+    size_t body_capacity = response->body.capacity();
+    net::HttpResponse* response_raw = response.get();
+    responses.release(std::move(response));
+    auto recycled = responses.acquire();
+    TEST_EXPECT_TRUE(recycled.get() == response_raw);
+    TEST_EXPECT_EQ(recycled->status_code, 0);
+    TEST_EXPECT_TRUE(recycled->status_text.empty());
+    TEST_EXPECT_TRUE(recycled->headers.empty());
+    TEST_EXPECT_TRUE(recycled->body.empty());
+    TEST_EXPECT_FALSE(recycled->success);
+    TEST_EXPECT_EQ(recycled->body.capacity(), body_capacity);
+}
+
 // 测试无锁队列
 TEST_CASE(lockfree_queue) {
     Queue<int> queue;
@@ -183,7 +971,211 @@ TEST_CASE(lockfree_queue_multithreaded) {
     TEST_EXPECT_EQ(consumed.load(), num_items);
 }
 
-// 测试协程池功能  
+// 测试多生产者多消费者下的无锁队列 - 节点回收不能导致数据丢失或重复
+TEST_CASE(lockfree_queue_mpmc) {
+    Queue<int> queue;
+    const int producers = 4;
+    const int consumers = 4;
+    const int per_producer = 20000;
+    const long long expected_sum =
+        static_cast<long long>(producers) * per_producer * (per_producer - 1) / 2;
+
+    std::atomic<int> consumed{0};
+    std::atomic<long long> sum{0};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < per_producer; ++i) {
+                queue.enqueue(i);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]() {
+            int value;
+            while (consumed.load() < producers * per_producer) {
+                if (queue.dequeue(value)) {
+                    sum.fetch_add(value);
+                    consumed.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    TEST_EXPECT_EQ(consumed.load(), producers * per_producer);
+    TEST_EXPECT_EQ(sum.load(), expected_sum);
+    TEST_EXPECT_TRUE(queue.empty());
+}
+
+// 测试无锁栈并发push/pop以及只可移动的元素类型
+TEST_CASE(lockfree_stack_concurrent) {
+    Stack<std::unique_ptr<int>> stack;
+    const int threads_count = 4;
+    const int per_thread = 10000;
+
+    std::atomic<int> popped{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&]() {
+            std::unique_ptr<int> item;
+            for (int i = 0; i < per_thread; ++i) {
+                stack.push(std::make_unique<int>(i));
+                if (stack.pop(item) && item) {
+                    popped.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::unique_ptr<int> item;
+    while (stack.pop(item)) {
+        popped.fetch_add(1);
+    }
+
+    TEST_EXPECT_EQ(popped.load(), threads_count * per_thread);
+    TEST_EXPECT_TRUE(stack.empty());
+
+    // 队列同样支持只可移动的元素，析构时释放未取走的数据
+    Queue<std::unique_ptr<int>> queue;
+    queue.enqueue(std::make_unique<int>(7));
+    queue.enqueue(std::make_unique<int>(8));
+    std::unique_ptr<int> value;
+    TEST_EXPECT_TRUE(queue.dequeue(value));
+    TEST_EXPECT_EQ(*value, 7);
+}
+
+// 测试有界MPMC队列：容量限制、批量操作和非平凡类型
+TEST_CASE(bounded_queue) {
+    BoundedQueue<std::string, 8> queue;
+
+    for (int i = 0; i < 8; ++i) {
+        TEST_EXPECT_TRUE(queue.try_push(std::string(32, static_cast<char>('a' + i))));
+    }
+    TEST_EXPECT_FALSE(queue.try_push(std::string("overflow")));
+    TEST_EXPECT_EQ(queue.size_approx(), 8u);
+
+    std::string batch[4];
+    TEST_EXPECT_EQ(queue.try_pop_bulk(batch, 4), 4u);
+    TEST_EXPECT_EQ(batch[0], std::string(32, 'a'));
+    TEST_EXPECT_EQ(batch[3], std::string(32, 'd'));
+
+    std::string more[6] = {"1", "2", "3", "4", "5", "6"};
+    TEST_EXPECT_EQ(queue.try_push_bulk(more, 6), 4u);
+    TEST_EXPECT_EQ(queue.try_push_bulk(more, 0), 0u);
+    TEST_EXPECT_EQ(queue.try_pop_bulk(batch, 0), 0u);
+
+    std::string value;
+    TEST_EXPECT_TRUE(queue.try_pop(value));
+    TEST_EXPECT_EQ(value, std::string(32, 'e'));
+
+    // 多生产者多消费者
+    BoundedQueue<int, 1024> mpmc;
+    const int producers = 4;
+    const int per_producer = 20000;
+    std::atomic<int> consumed{0};
+    std::atomic<long long> sum{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < per_producer; ++i) {
+                while (!mpmc.try_push(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            int items[16];
+            while (consumed.load() < producers * per_producer) {
+                size_t n = mpmc.try_pop_bulk(items, 16);
+                for (size_t i = 0; i < n; ++i) {
+                    sum.fetch_add(items[i]);
+                }
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                consumed.fetch_add(static_cast<int>(n));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    TEST_EXPECT_EQ(sum.load(), static_cast<long long>(producers) * per_producer * (per_producer - 1) / 2);
+    TEST_EXPECT_TRUE(mpmc.empty());
+}
+
+// 测试SPSC环形缓冲区：原地预留写入、零拷贝读取和回绕
+TEST_CASE(spsc_ring_reservation) {
+    RingBuffer<std::string, 8> ring;
+
+    for (int i = 0; i < 6; ++i) {
+        TEST_EXPECT_TRUE(ring.push(std::to_string(i)));
+    }
+    std::string value;
+    for (int i = 0; i < 6; ++i) {
+        ring.pop(value);
+    }
+
+    // 写位置为6，预留4个只能拿到到末尾的2个连续槽位
+    auto region = ring.reserve(4);
+    TEST_EXPECT_EQ(region.size(), 2u);
+    region[0] = "a";
+    region[1] = "b";
+    ring.commit(2);
+    region = ring.reserve(2);
+    TEST_EXPECT_EQ(region.size(), 2u);
+    region[0] = "c";
+    ring.commit(1);
+
+    auto readable = ring.peek(8);
+    TEST_EXPECT_EQ(readable.size(), 2u);
+    TEST_EXPECT_EQ(readable[1], std::string("b"));
+    ring.release(2);
+    TEST_EXPECT_TRUE(ring.pop(value));
+    TEST_EXPECT_EQ(value, std::string("c"));
+    TEST_EXPECT_TRUE(ring.empty());
+
+    // 跨线程批量传输
+    RingBuffer<int, 256> stream;
+    const int total = 100000;
+    std::thread producer([&]() {
+        int next = 0;
+        while (next < total) {
+            auto slots = stream.reserve(32);
+            size_t n = std::min<size_t>(slots.size(), total - next);
+            for (size_t i = 0; i < n; ++i) {
+                slots[i] = next++;
+            }
+            stream.commit(n);
+        }
+    });
+    int expected = 0;
+    bool in_order = true;
+    while (expected < total) {
+        auto items = stream.peek(64);
+        for (int item : items) {
+            in_order = in_order && (item == expected);
+            ++expected;
+        }
+        stream.release(items.size());
+    }
+    producer.join();
+    TEST_EXPECT_TRUE(in_order);
+    TEST_EXPECT_EQ(expected, total);
+}
+
+// 测试协程池功能
 TEST_CASE(coroutine_pool) {
     std::atomic<int> counter{0};
     std::vector<Task<void>> tasks;
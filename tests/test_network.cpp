@@ -1,6 +1,13 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <set>
 #include "flowcoro.hpp"
 #include "test_framework.h"
 
@@ -101,6 +108,20 @@ void test_http_response_parsing() {
         
         TEST_EXPECT_EQ(response.status_code, 200);
         TEST_EXPECT_TRUE(response.success);
+
+        // 状态码必须恰好三位，后接空白或行尾
+        auto ok = parse_http_response("HTTP/1.1 201 Created\r\n\r\nbody");
+        TEST_EXPECT_EQ(ok.status_code, 201);
+        TEST_EXPECT_EQ(ok.status_text, std::string("Created"));
+        TEST_EXPECT_TRUE(ok.error_message.empty());
+        auto no_reason = parse_http_response("HTTP/1.1 204\r\n\r\n");
+        TEST_EXPECT_EQ(no_reason.status_code, 204);
+        TEST_EXPECT_TRUE(no_reason.status_text.empty());
+        for (const char* line : {"HTTP/1.1 99999999999 X", "HTTP/1.1 2000 OK", "HTTP/1.1 20 OK", "HTTP/1.1 200OK"}) {
+            auto bad = parse_http_response(std::string(line) + "\r\n\r\n");
+            TEST_EXPECT_EQ(bad.status_code, 0);
+            TEST_EXPECT_FALSE(bad.error_message.empty());
+        }
         
         std::cout << "HTTP响应解析测试通过" << std::endl;
         
@@ -110,6 +131,1230 @@ void test_http_response_parsing() {
     }
 }
 
+// 循环读取，直到读满expected字节或对端关闭
+Task<void> read_rounds(Socket& socket, size_t expected, size_t& received, bool& failed) {
+    try {
+        char buffer[64];
+        while (received < expected) {
+            ssize_t n = co_await socket.read(buffer, sizeof(buffer));
+            if (n == 0) break;
+            received += static_cast<size_t>(n);
+        }
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 带超时循环读取，直到读满expected字节
+Task<void> timed_read_rounds(Socket& socket, size_t expected, size_t& received, bool& failed) {
+    try {
+        char buffer[64];
+        while (received < expected) {
+            ssize_t n = co_await socket.read(buffer, sizeof(buffer), std::chrono::seconds(10));
+            if (n == 0) break;
+            received += static_cast<size_t>(n);
+        }
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 读到EOF为止，记录每次read的返回值
+Task<void> read_until_eof(Socket& socket, std::vector<ssize_t>& results) {
+    try {
+        char buffer[64];
+        while (true) {
+            ssize_t n = co_await socket.read(buffer, sizeof(buffer));
+            results.push_back(n);
+            if (n == 0) break;
+        }
+    } catch (const std::exception&) {
+        results.push_back(-1);
+    }
+}
+
+// 驱动事件循环直到条件满足或超时
+template<typename Pred>
+bool drive_until(EventLoop& loop, Pred pred) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        loop.run_once(10);
+    }
+    return true;
+}
+
+// 测试socket只注册一次，边沿触发下的读等待与关闭取消
+void test_socket_persistent_registration() {
+    std::cout << "测试Socket持久注册..." << std::endl;
+    EventLoop loop(IoBackend::EPOLL);
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket reader(fds[0], &loop);
+    Socket writer(fds[1], &loop);
+
+    constexpr size_t ROUNDS = 50;
+    size_t received = 0;
+    bool failed = false;
+    auto task = read_rounds(reader, ROUNDS * 8, received, failed);
+    bool all_rounds = true;
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        if (::send(writer.fd(), "12345678", 8, 0) != 8 ||
+            !drive_until(loop, [&]() { return received >= (i + 1) * 8; })) {
+            all_rounds = false;
+            break;
+        }
+    }
+    TEST_EXPECT_TRUE(all_rounds);
+    TEST_EXPECT_TRUE(task.handle.done());
+    TEST_EXPECT_FALSE(failed);
+    // 50次挂起等待只注册了一次
+    TEST_EXPECT_EQ(loop.get_stats().ctl_calls, 1u);
+
+    // 关闭时挂起的读以错误结束
+    received = 0;
+    auto pending = read_rounds(reader, 8, received, failed);
+    TEST_EXPECT_FALSE(pending.handle.done());
+    reader.close();
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return pending.handle.done(); }));
+    TEST_EXPECT_TRUE(failed);
+    TEST_EXPECT_EQ(loop.get_stats().ctl_calls, 2u);
+
+    // 数据和FIN在同一个边沿到达：读不满之后下一次读仍然返回0，而不是等待不会再来的边沿
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket half_closed(fds[0], &loop);
+    std::vector<ssize_t> results;
+    auto eof = read_until_eof(half_closed, results);
+    TEST_EXPECT_FALSE(eof.handle.done());
+    TEST_EXPECT_EQ(::send(fds[1], "hello", 5, 0), 5);
+    TEST_EXPECT_EQ(::shutdown(fds[1], SHUT_WR), 0);
+    loop.run_once(100);
+    TEST_EXPECT_TRUE(eof.handle.done());
+    TEST_EXPECT_EQ(results.size(), 2u);
+    TEST_EXPECT_EQ(results[0], 5);
+    TEST_EXPECT_EQ(results[1], 0);
+    ::close(fds[1]);
+
+    // 带超时的读在数据到达后结束，不在事件循环中留下各自的定时器
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket timed(fds[0], &loop);
+    received = 0;
+    failed = false;
+    auto timed_task = timed_read_rounds(timed, ROUNDS * 8, received, failed);
+    bool timed_rounds = true;
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        if (::send(fds[1], "12345678", 8, 0) != 8 ||
+            !drive_until(loop, [&]() { return received >= (i + 1) * 8; })) {
+            timed_rounds = false;
+            break;
+        }
+    }
+    TEST_EXPECT_TRUE(timed_rounds);
+    TEST_EXPECT_TRUE(timed_task.handle.done());
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_TRUE(loop.get_stats().pending_timers <= 1u);
+    ::close(fds[1]);
+}
+
+// 测试按fd索引的处理器表：fd在同一批事件中被关闭并重用时，旧事件不会分发给新处理器
+void test_event_loop_handler_table() {
+    std::cout << "测试事件循环处理器表..." << std::endl;
+    EventLoop loop(IoBackend::EPOLL);
+    int first = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int second = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int reused = -1;
+    int first_reads = 0;
+    int second_reads = 0;
+    int reused_reads = 0;
+
+    auto handler = std::make_unique<IoEventHandler>();
+    handler->on_read = [&]() {
+        uint64_t value;
+        [[maybe_unused]] ssize_t n = ::read(first, &value, sizeof(value));
+        if (++first_reads > 1) return;
+        // 关闭second并立即占用同一个fd号
+        loop.remove_fd(second);
+        ::close(second);
+        reused = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        auto replacement = std::make_unique<IoEventHandler>();
+        replacement->on_read = [&]() { ++reused_reads; };
+        loop.add_fd(reused, EPOLLIN, std::move(replacement));
+    };
+    loop.add_fd(first, EPOLLIN, std::move(handler));
+    auto stale = std::make_unique<IoEventHandler>();
+    stale->on_read = [&]() { ++second_reads; };
+    loop.add_fd(second, EPOLLIN, std::move(stale));
+
+    // 两个fd在同一批中就绪，first的事件先分发
+    uint64_t one = 1;
+    TEST_EXPECT_EQ(::write(first, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+    TEST_EXPECT_EQ(::write(second, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+    TEST_EXPECT_EQ(loop.run_once(0), 2);
+    TEST_EXPECT_EQ(first_reads, 1);
+    TEST_EXPECT_EQ(second_reads, 0);
+    TEST_EXPECT_EQ(reused, second);
+    TEST_EXPECT_EQ(reused_reads, 0);
+
+    // 新处理器照常收到自己的事件
+    TEST_EXPECT_EQ(::write(reused, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+    loop.run_once(0);
+    TEST_EXPECT_EQ(reused_reads, 1);
+
+    // 较大的fd号：表按需扩展
+    int high = ::fcntl(first, F_DUPFD_CLOEXEC, 4096);
+    TEST_EXPECT_TRUE(high >= 4096);
+    int high_reads = 0;
+    auto high_handler = std::make_unique<IoEventHandler>();
+    high_handler->on_read = [&]() { ++high_reads; };
+    loop.remove_fd(first);
+    loop.add_fd(high, EPOLLIN, std::move(high_handler));
+    TEST_EXPECT_EQ(::write(high, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+    loop.run_once(0);
+    TEST_EXPECT_EQ(high_reads, 1);
+
+    loop.remove_fd(high);
+    loop.remove_fd(reused);
+    ::close(high);
+    ::close(first);
+    ::close(reused);
+}
+
+Task<void> accept_one(Socket& listener, std::unique_ptr<Socket>& accepted) {
+    try {
+        accepted = co_await listener.accept();
+    } catch (const std::exception&) {
+    }
+}
+
+Task<void> connect_and_send(Socket& client, uint16_t port, const std::string& message, bool& sent) {
+    try {
+        co_await client.connect("127.0.0.1", port);
+        size_t offset = 0;
+        while (offset < message.size()) {
+            offset += static_cast<size_t>(co_await client.write(message.data() + offset, message.size() - offset));
+        }
+        sent = true;
+    } catch (const std::exception&) {
+    }
+}
+
+// 测试本地回环上的accept/connect/write
+void test_socket_loopback_accept_connect(IoBackend backend) {
+    std::cout << "测试Socket本地回环连接(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    Socket listener(&loop);
+    TEST_EXPECT_TRUE(listener.bind("127.0.0.1", 0));
+    TEST_EXPECT_TRUE(listener.listen());
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    ::getsockname(listener.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+    uint16_t port = ntohs(addr.sin_port);
+
+    std::unique_ptr<Socket> accepted;
+    auto accept_task = accept_one(listener, accepted);
+    Socket client(&loop);
+    std::string message(256 * 1024, 'x');
+    bool sent = false;
+    auto connect_task = connect_and_send(client, port, message, sent);
+
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return accepted != nullptr; }));
+    size_t received = 0;
+    bool failed = false;
+    auto read_task = read_rounds(*accepted, message.size(), received, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return sent && received == message.size(); }));
+    TEST_EXPECT_TRUE(client.is_connected());
+    TEST_EXPECT_FALSE(failed);
+}
+
+uint16_t listen_on_loopback(Socket& listener) {
+    listener.bind("127.0.0.1", 0);
+    listener.listen();
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    ::getsockname(listener.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+    return ntohs(addr.sin_port);
+}
+
+// 读到IOBuf，直到收满expected字节或对端关闭
+Task<void> receive_all(Socket& socket, size_t expected, std::string& out, bool& failed) {
+    try {
+        while (out.size() < expected) {
+            IOBuf chunk = co_await socket.receive();
+            if (chunk.empty()) break;
+            out += chunk.to_string();
+        }
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+Task<void> read_with_timeout(Socket& socket, std::chrono::milliseconds timeout, bool& timed_out) {
+    try {
+        char buffer[16];
+        co_await socket.read(buffer, sizeof(buffer), timeout);
+    } catch (const std::exception& e) {
+        timed_out = std::string(e.what()).find(strerror(ETIMEDOUT)) != std::string::npos;
+    }
+}
+
+// 测试后端选择与两种后端共同的IOBuf接收、读超时
+void test_io_backend_common(IoBackend backend) {
+    std::cout << "测试IO后端(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    IoBackend expected = backend == IoBackend::EPOLL || !IoUring::supported() ? IoBackend::EPOLL : IoBackend::IO_URING;
+    TEST_EXPECT_TRUE(loop.backend() == expected);
+
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket reader(fds[0], &loop);
+    Socket writer(fds[1], &loop);
+
+    // 接收次数超过缓冲区组大小，验证缓冲区随IOBuf释放归还
+    constexpr size_t ROUNDS = EventLoop::RECV_BUFFER_COUNT * 2;
+    std::string received;
+    bool failed = false;
+    auto task = receive_all(reader, ROUNDS * 4, received, failed);
+    bool all_rounds = true;
+    for (size_t i = 0; i < ROUNDS && all_rounds; ++i) {
+        all_rounds = ::send(writer.fd(), "abcd", 4, 0) == 4 &&
+                     drive_until(loop, [&]() { return received.size() >= (i + 1) * 4; });
+    }
+    TEST_EXPECT_TRUE(all_rounds);
+    TEST_EXPECT_TRUE(task.handle.done());
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(received.substr(0, 8), std::string("abcdabcd"));
+
+    // 没有数据时读超时
+    bool timed_out = false;
+    auto start = std::chrono::steady_clock::now();
+    auto timeout_task = read_with_timeout(reader, std::chrono::milliseconds(30), timed_out);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return timeout_task.handle.done(); }));
+    TEST_EXPECT_TRUE(timed_out);
+    TEST_EXPECT_TRUE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(25));
+
+    // 超时之后同一方向可以继续读
+    received.clear();
+    auto again = receive_all(reader, 4, received, failed);
+    ::send(writer.fd(), "wxyz", 4, 0);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return again.handle.done(); }));
+    TEST_EXPECT_EQ(received, std::string("wxyz"));
+
+    // 挂起中的协程被销毁：请求分离，之后到达的数据不会恢复已销毁的协程
+    {
+        std::string dropped;
+        auto abandoned = receive_all(reader, 4, dropped, failed);
+        TEST_EXPECT_FALSE(abandoned.handle.done());
+    }
+    ::send(writer.fd(), "late", 4, 0);
+    loop.run_once(10);
+    loop.run_once(10);
+    TEST_EXPECT_FALSE(failed);
+}
+
+// 测试io_uring的multishot accept与批量提交
+void test_io_uring_batching() {
+    if (!IoUring::supported()) {
+        std::cout << "内核不支持io_uring，跳过" << std::endl;
+        return;
+    }
+    std::cout << "测试io_uring批量提交..." << std::endl;
+
+    // SQ满时get_sqe先提交腾出槽位；不处理CQE使CQ溢出，所有完成事件仍然按数送达
+    {
+        IoUring ring(4);
+        constexpr unsigned NOPS = 256;
+        for (unsigned i = 0; i < NOPS; ++i) {
+            io_uring_sqe* sqe = ring.get_sqe();
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = i + 1;
+        }
+        TEST_EXPECT_TRUE(ring.unsubmitted() <= 4u);
+        unsigned completed = 0;
+        uint64_t user_data_sum = 0;
+        for (int round = 0; round < 100 && completed < NOPS; ++round) {
+            ring.submit_and_wait(10);
+            ring.drain_completions([&](const io_uring_cqe& cqe) {
+                ++completed;
+                user_data_sum += cqe.user_data;
+            });
+        }
+        TEST_EXPECT_EQ(completed, NOPS);
+        TEST_EXPECT_EQ(user_data_sum, uint64_t{NOPS} * (NOPS + 1) / 2);
+    }
+
+    EventLoop loop(IoBackend::IO_URING);
+    Socket listener(&loop);
+    uint16_t port = listen_on_loopback(listener);
+
+    // 先建立连接再accept：multishot accept把连接暂存，之后的accept直接完成
+    constexpr size_t CLIENTS = 8;
+    std::unique_ptr<Socket> first;
+    auto first_task = accept_one(listener, first);
+    std::vector<std::unique_ptr<Socket>> clients;
+    std::vector<Task<void>> connects;
+    std::string message = "ping";
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        clients.push_back(std::make_unique<Socket>(&loop));
+    }
+    bool flags[CLIENTS] = {};
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        connects.push_back(connect_and_send(*clients[i], port, message, flags[i]));
+    }
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() {
+        return first && std::all_of(flags, flags + CLIENTS, [](bool f) { return f; });
+    }));
+
+    std::vector<std::unique_ptr<Socket>> accepted;
+    accepted.push_back(std::move(first));
+    for (size_t i = 1; i < CLIENTS; ++i) {
+        std::unique_ptr<Socket> next;
+        auto task = accept_one(listener, next);
+        drive_until(loop, [&]() { return next != nullptr; });
+        if (next) accepted.push_back(std::move(next));
+    }
+    TEST_EXPECT_EQ(accepted.size(), CLIENTS);
+
+    // 所有连接上的读在同一轮提交：一次io_uring_enter
+    std::vector<size_t> received(CLIENTS);
+    std::vector<Task<void>> reads;
+    bool failed = false;
+    uint64_t before = loop.get_stats().submit_calls;
+    for (size_t i = 0; i < CLIENTS; ++i) {
+        reads.push_back(read_rounds(*accepted[i], message.size(), received[i], failed));
+    }
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() {
+        return std::all_of(received.begin(), received.end(), [&](size_t n) { return n == message.size(); });
+    }));
+    TEST_EXPECT_EQ(loop.get_stats().submit_calls - before, 1u);
+    TEST_EXPECT_FALSE(failed);
+
+    // 关闭时挂起的读以错误结束
+    size_t pending_received = 0;
+    auto pending = read_rounds(*accepted[0], 1, pending_received, failed);
+    loop.run_once(0);
+    accepted[0]->close();
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return pending.handle.done(); }));
+    TEST_EXPECT_TRUE(failed);
+}
+
+// 阻塞客户端：连接、发送、等待回显
+bool blocking_echo(uint16_t port, const std::string& message) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    timeval tv{2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+              ::send(fd, message.data(), message.size(), 0) == static_cast<ssize_t>(message.size());
+    std::string reply(message.size(), '\0');
+    size_t got = 0;
+    while (ok && got < reply.size()) {
+        ssize_t n = ::recv(fd, reply.data() + got, reply.size() - got, 0);
+        if (n < 0 && errno == EINTR) {
+            continue; // 本线程上io_uring的task work在设置了SO_RCVTIMEO时会以EINTR打断recv
+        }
+        ok = n > 0;
+        if (ok) got += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return ok && reply == message;
+}
+
+Task<void> gather_scatter(Socket& writer, Socket& reader, std::string& first, std::string& second, bool& failed) {
+    try {
+        std::string head = "GET / HTTP/1.1\r\n";
+        std::string body = "Host: a\r\n\r\n";
+        iovec out[2] = {{head.data(), head.size()}, {body.data(), body.size()}};
+        ssize_t written = co_await writer.writev(out);
+        if (written != static_cast<ssize_t>(head.size() + body.size())) failed = true;
+
+        first.assign(4, '\0');
+        second.assign(64, '\0');
+        iovec in[2] = {{first.data(), first.size()}, {second.data(), second.size()}};
+        ssize_t n = co_await reader.readv(in);
+        second.resize(static_cast<size_t>(n) - first.size());
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+Task<void> zerocopy_send(Socket& socket, const std::string& head, const std::string& payload, size_t& sent, bool& failed) {
+    try {
+        iovec iov[2] = {{const_cast<char*>(head.data()), head.size()}, {const_cast<char*>(payload.data()), payload.size()}};
+        sent = co_await socket.send_zerocopy(iov);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+Task<void> datagram_batch(Socket& sender, Socket& receiver, int& sent, int& received, std::vector<std::string>& out) {
+    std::string payloads[3] = {"one", "two", "three"};
+    iovec send_iov[3];
+    mmsghdr send_msgs[3]{};
+    for (int i = 0; i < 3; ++i) {
+        send_iov[i] = {payloads[i].data(), payloads[i].size()};
+        send_msgs[i].msg_hdr.msg_iov = &send_iov[i];
+        send_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    sent = co_await sender.send_many(send_msgs);
+
+    char buffers[4][16];
+    iovec recv_iov[4];
+    mmsghdr recv_msgs[4]{};
+    for (int i = 0; i < 4; ++i) {
+        recv_iov[i] = {buffers[i], sizeof(buffers[i])};
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iov[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    received = co_await receiver.recv_many(recv_msgs);
+    for (int i = 0; i < received; ++i) {
+        out.emplace_back(buffers[i], recv_msgs[i].msg_len);
+    }
+}
+
+// 测试分散读/聚集写、TcpConnection的writev刷新、MSG_ZEROCOPY发送与批量数据报收发
+void test_socket_vectored_io(IoBackend backend) {
+    std::cout << "测试向量化与批量IO(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket a(fds[0], &loop);
+    Socket b(fds[1], &loop);
+
+    std::string first, second;
+    bool failed = false;
+    auto task = gather_scatter(a, b, first, second, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return task.handle.done(); }));
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(first + second, std::string("GET / HTTP/1.1\r\nHost: a\r\n\r\n"));
+
+    // 响应头与正文分别入队，flush时不拼接；数据超过发送缓冲区时分多次writev
+    {
+        TcpConnection connection(std::make_unique<Socket>(std::move(a)));
+        std::string received;
+        bool receive_failed = false;
+        auto reader = receive_all(b, 19 + 100000, received, receive_failed);
+        auto queued = connection.write(std::string("HTTP/1.1 200 OK\r\n\r\n"));
+        connection.write(IOBuf::from_string(std::string(100000, 'b')));
+        auto writer = connection.flush();
+        TEST_EXPECT_TRUE(drive_until(loop, [&]() { return writer.handle.done() && reader.handle.done(); }));
+        TEST_EXPECT_FALSE(receive_failed);
+        TEST_EXPECT_EQ(received.size(), size_t{19 + 100000});
+        TEST_EXPECT_EQ(received.substr(0, 19), std::string("HTTP/1.1 200 OK\r\n\r\n"));
+    }
+
+    // TCP回环上的零拷贝发送：返回时全部通知已确认
+    Socket listener(&loop);
+    uint16_t port = listen_on_loopback(listener);
+    int client = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_EXPECT_EQ(::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    int server_fd = ::accept4(listener.fd(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    TEST_EXPECT_TRUE(server_fd >= 0);
+    Socket server(server_fd, &loop);
+
+    std::string head = "header";
+    std::string payload(1 << 20, 'z');
+    std::string zc_received;
+    std::thread drain([&]() {
+        char buffer[65536];
+        while (zc_received.size() < head.size() + payload.size()) {
+            ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            zc_received.append(buffer, static_cast<size_t>(n));
+        }
+    });
+    size_t sent = 0;
+    auto zc = zerocopy_send(server, head, payload, sent, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return zc.handle.done(); }));
+    drain.join();
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(sent, head.size() + payload.size());
+    TEST_EXPECT_TRUE(zc_received == head + payload);
+
+    // 读挂起期间到达的零拷贝完成通知只报告EPOLLERR，不能把socket当作已出错：
+    // 读继续等待，之后照常收到数据和EOF（直接发送不取通知，让它留在错误队列里）
+    std::vector<ssize_t> after_results;
+    auto after = read_until_eof(server, after_results);
+    TEST_EXPECT_EQ(::send(server.fd(), "z", 1, MSG_NOSIGNAL | MSG_ZEROCOPY), 1);
+    for (int i = 0; i < 3; ++i) loop.run_once(0);
+    TEST_EXPECT_FALSE(after.handle.done());
+    TEST_EXPECT_TRUE(after_results.empty());
+    TEST_EXPECT_EQ(::send(client, "pong", 4, 0), 4);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return !after_results.empty(); }));
+    TEST_EXPECT_FALSE(after.handle.done());
+    TEST_EXPECT_EQ(::shutdown(client, SHUT_WR), 0);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return after.handle.done(); }));
+    TEST_EXPECT_TRUE(after_results == (std::vector<ssize_t>{4, 0}));
+    ::close(client);
+
+    // 数据报批量收发
+    int dgram[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, dgram), 0);
+    Socket sender(dgram[0], &loop);
+    Socket receiver(dgram[1], &loop);
+    int sent_messages = 0;
+    int received_messages = 0;
+    std::vector<std::string> messages;
+    auto batch = datagram_batch(sender, receiver, sent_messages, received_messages, messages);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return batch.handle.done(); }));
+    TEST_EXPECT_EQ(sent_messages, 3);
+    TEST_EXPECT_EQ(received_messages, 3);
+    TEST_EXPECT_TRUE(messages == std::vector<std::string>({"one", "two", "three"}));
+}
+
+Task<void> send_file(Socket& socket, int file_fd, off_t offset, size_t count, size_t& sent, bool& failed) {
+    try {
+        sent = co_await socket.sendfile(file_fd, offset, count);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+Task<void> proxy(Socket& source, Socket& dest, size_t& moved, bool& failed) {
+    try {
+        moved = co_await source.splice_to(dest);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 测试sendfile发送文件区间与splice在两个socket之间转发
+void test_socket_file_transfer(IoBackend backend) {
+    std::cout << "测试sendfile/splice(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+
+    // 文件大于socket发送缓冲区，需要多次等待可写；请求长度超过文件末尾时按实际长度返回
+    char path[] = "/tmp/flowcoro_sendfile_XXXXXX";
+    int file_fd = ::mkstemp(path);
+    TEST_EXPECT_TRUE(file_fd >= 0);
+    ::unlink(path);
+    std::string content(1 << 20, '\0');
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    TEST_EXPECT_EQ(::write(file_fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket a(fds[0], &loop);
+    Socket b(fds[1], &loop);
+    size_t sent = 0;
+    bool failed = false;
+    std::string received;
+    bool receive_failed = false;
+    auto reader = receive_all(b, content.size() - 100, received, receive_failed);
+    auto writer = send_file(a, file_fd, 100, content.size(), sent, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return writer.handle.done() && reader.handle.done(); }));
+    ::close(file_fd);
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_FALSE(receive_failed);
+    TEST_EXPECT_EQ(sent, content.size() - 100);
+    TEST_EXPECT_TRUE(received == content.substr(100));
+
+    // client -> [in | out] -> server，由splice_to转发直到client关闭写端
+    int in[2], out[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, in), 0);
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, out), 0);
+    Socket proxy_in(in[1], &loop);
+    Socket proxy_out(out[0], &loop);
+    int client = in[0];
+    int server = out[1];
+    ::fcntl(client, F_SETFL, 0);
+    ::fcntl(server, F_SETFL, 0);
+    std::thread upload([&]() {
+        size_t offset = 0;
+        while (offset < content.size()) {
+            ssize_t n = ::send(client, content.data() + offset, content.size() - offset, 0);
+            if (n <= 0) break;
+            offset += static_cast<size_t>(n);
+        }
+        ::shutdown(client, SHUT_WR);
+    });
+    std::string proxied;
+    std::thread download([&]() {
+        char buffer[65536];
+        while (true) {
+            ssize_t n = ::recv(server, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            proxied.append(buffer, static_cast<size_t>(n));
+        }
+    });
+    size_t moved = 0;
+    auto forward = proxy(proxy_in, proxy_out, moved, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return forward.handle.done(); }));
+    upload.join();
+    proxy_out.close();
+    download.join();
+    ::close(client);
+    ::close(server);
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(moved, content.size());
+    TEST_EXPECT_TRUE(proxied == content);
+}
+
+Task<void> udp_echo(UdpSocket& client, UdpSocket& server, std::string& reply, uint16_t& seen_port, bool& failed) {
+    try {
+        co_await client.send_to("ping", 4, server.local_endpoint());
+        char buffer[64];
+        Endpoint from;
+        ssize_t n = co_await server.recv_from(buffer, sizeof(buffer), from);
+        seen_port = from.port();
+        co_await server.send_to(buffer, static_cast<size_t>(n), from);
+        n = co_await client.recv_from(buffer, sizeof(buffer), from);
+        reply.assign(buffer, static_cast<size_t>(n));
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 批量发送payloads，再批量接收到收齐为止；记录收到的消息数和GRO合并时的分段长度
+Task<void> udp_batch(UdpSocket& sender, UdpSocket& receiver, const std::vector<std::string>& payloads,
+                     int& sent, std::string& received, int& messages, uint16_t& segment_size, bool& failed) {
+    try {
+        std::vector<UdpSocket::Datagram> out(payloads.size());
+        size_t expected = 0;
+        for (size_t i = 0; i < payloads.size(); ++i) {
+            out[i].data = const_cast<char*>(payloads[i].data());
+            out[i].size = payloads[i].size();
+            out[i].peer = receiver.local_endpoint();
+            expected += payloads[i].size();
+        }
+        sent = co_await sender.send_many(out);
+
+        std::vector<char> storage(16 * 65536);
+        std::vector<UdpSocket::Datagram> in(16);
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i].data = storage.data() + i * 65536;
+            in[i].capacity = 65536;
+        }
+        while (received.size() < expected) {
+            int n = co_await receiver.recv_many(in);
+            for (int i = 0; i < n; ++i) {
+                received.append(in[i].data, in[i].size);
+                segment_size = std::max(segment_size, in[i].segment_size);
+            }
+            messages += n;
+        }
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 测试UDP单个数据报收发、sendmmsg/recvmmsg批量收发以及GSO/GRO合并
+void test_udp_socket(IoBackend backend) {
+    std::cout << "测试UDP socket(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    UdpSocket client(&loop);
+    UdpSocket server(&loop);
+    TEST_EXPECT_TRUE(client.bind("127.0.0.1", 0));
+    TEST_EXPECT_TRUE(server.bind("127.0.0.1", 0));
+
+    std::string reply;
+    uint16_t seen_port = 0;
+    bool failed = false;
+    auto echo = udp_echo(client, server, reply, seen_port, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return echo.handle.done(); }));
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(reply, std::string("ping"));
+    TEST_EXPECT_EQ(seen_port, client.local_port());
+
+    // 10个等长数据报加一个短的：GSO下合并成一条消息发送，接收端未开启GRO时仍收到11个数据报
+    std::vector<std::string> payloads;
+    std::string all;
+    for (int i = 0; i < 10; ++i) {
+        payloads.emplace_back(1000, static_cast<char>('a' + i));
+        all += payloads.back();
+    }
+    payloads.emplace_back(300, 'z');
+    all += payloads.back();
+    TEST_EXPECT_TRUE(client.gso_enabled());
+
+    int sent = 0;
+    int messages = 0;
+    uint16_t segment_size = 0;
+    std::string received;
+    auto batch = udp_batch(client, server, payloads, sent, received, messages, segment_size, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return batch.handle.done(); }));
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(sent, 11);
+    TEST_EXPECT_EQ(messages, 11);
+    TEST_EXPECT_EQ(segment_size, uint16_t{0});
+    TEST_EXPECT_TRUE(received == all);
+
+    // 开启GRO后合并的数据报整体交付，按segment_size切分
+    UdpSocket gro_server(&loop);
+    TEST_EXPECT_TRUE(gro_server.bind("127.0.0.1", 0));
+    TEST_EXPECT_TRUE(gro_server.enable_gro());
+    sent = 0;
+    messages = 0;
+    received.clear();
+    auto coalesced = udp_batch(client, gro_server, payloads, sent, received, messages, segment_size, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return coalesced.handle.done(); }));
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(sent, 11);
+    TEST_EXPECT_TRUE(messages < 11);
+    TEST_EXPECT_EQ(segment_size, uint16_t{1000});
+    TEST_EXPECT_TRUE(received == all);
+}
+
+// 依次读取count行，记录每行内容；出错时记录异常信息
+Task<void> read_lines(BufferedReader& reader, int count, std::vector<std::string>& lines, std::string& error) {
+    try {
+        for (int i = 0; i < count; ++i) {
+            std::string_view line = co_await reader.read_line();
+            lines.emplace_back(line);
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+}
+
+Task<void> read_block(BufferedReader& reader, size_t size, std::string& out) {
+    std::string_view data = co_await reader.read_exactly(size);
+    out.assign(data);
+}
+
+Task<void> socket_read_line(Socket& socket, std::string& line) {
+    line = co_await socket.read_line();
+}
+
+Task<void> connection_reads(TcpConnection& connection, std::vector<std::string>& out) {
+    out.push_back(co_await connection.read_line());
+    out.push_back(co_await connection.read(3));
+    out.push_back(co_await connection.read_line());
+}
+
+// 测试BufferedReader：一次读入多行、跨多次读取的行、超长行、定长读取和EOF，以及Socket::read_line不读过行尾
+void test_buffered_reader(IoBackend backend) {
+    std::cout << "测试BufferedReader(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket socket(fds[1], &loop);
+    int peer = fds[0];
+    auto send_text = [peer](const std::string& text) {
+        return ::send(peer, text.data(), text.size(), 0) == static_cast<ssize_t>(text.size());
+    };
+    BufferedReader reader(socket, 256 * 1024);
+
+    // 一次读入的多行逐行返回，视图包含分隔符
+    TEST_EXPECT_TRUE(send_text("*2\r\n$3\r\nGET\r\n$1\r\nk\r\n"));
+    std::vector<std::string> lines;
+    std::string error;
+    auto first = read_lines(reader, 4, lines, error);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return first.handle.done(); }));
+    TEST_EXPECT_TRUE(lines == std::vector<std::string>({"*2\r\n", "$3\r\n", "GET\r\n", "$1\r\n"}));
+    TEST_EXPECT_EQ(reader.buffered(), std::string_view("k\r\n"));
+
+    // 跨多次到达的长行：分隔符到达前不返回，已扫描过的部分不再重复扫描
+    lines.clear();
+    std::string long_line(200 * 1024, 'x');
+    auto second = read_lines(reader, 2, lines, error);
+    TEST_EXPECT_EQ(lines.size(), size_t{1});
+    for (size_t offset = 0; offset < long_line.size(); offset += 50 * 1024) {
+        TEST_EXPECT_TRUE(send_text(long_line.substr(offset, 50 * 1024)));
+        loop.run_once(10);
+        TEST_EXPECT_FALSE(second.handle.done());
+    }
+    TEST_EXPECT_TRUE(send_text("\n"));
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return second.handle.done(); }));
+    TEST_EXPECT_EQ(lines.size(), size_t{2});
+    TEST_EXPECT_TRUE(lines.back() == long_line + "\n");
+    TEST_EXPECT_TRUE(error.empty());
+
+    // 定长读取先取缓冲区中的数据
+    TEST_EXPECT_TRUE(send_text("abcdefgh"));
+    std::string block;
+    auto exact = read_block(reader, 6, block);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return exact.handle.done(); }));
+    TEST_EXPECT_EQ(block, std::string("abcdef"));
+
+    // 超过最大行长度
+    reader.set_max_line(1024);
+    TEST_EXPECT_TRUE(send_text(std::string(4096, 'y')));
+    lines.clear();
+    auto too_long = read_lines(reader, 1, lines, error);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return too_long.handle.done(); }));
+    TEST_EXPECT_TRUE(lines.empty());
+    TEST_EXPECT_TRUE(error.find("Read line failed") != std::string::npos);
+
+    // 超长行和分隔符在同一次写入中到达：分隔符在缓冲区里也不能放过超长行；恰好max_line（含分隔符）的行正常返回
+    int oversize[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, oversize), 0);
+    Socket oversize_socket(oversize[1], &loop);
+    BufferedReader oversize_reader(oversize_socket, 64);
+    std::string fits = std::string(63, 'a') + "\n";
+    std::string exceeds = std::string(64 + 16, 'b') + "\n";
+    std::string both = fits + exceeds;
+    TEST_EXPECT_EQ(::send(oversize[0], both.data(), both.size(), 0), static_cast<ssize_t>(both.size()));
+    lines.clear();
+    error.clear();
+    auto oversized = read_lines(oversize_reader, 2, lines, error);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return oversized.handle.done(); }));
+    TEST_EXPECT_TRUE(lines == std::vector<std::string>({fits}));
+    TEST_EXPECT_TRUE(error.find("Read line failed") != std::string::npos);
+    ::close(oversize[0]);
+
+    // EOF时返回剩余的不完整行，之后返回空
+    int tail[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, tail), 0);
+    Socket tail_socket(tail[1], &loop);
+    BufferedReader tail_reader(tail_socket);
+    TEST_EXPECT_EQ(::send(tail[0], "last\npartial", 12, 0), 12);
+    ::shutdown(tail[0], SHUT_WR);
+    lines.clear();
+    error.clear();
+    auto at_eof = read_lines(tail_reader, 3, lines, error);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return at_eof.handle.done(); }));
+    TEST_EXPECT_TRUE(lines == std::vector<std::string>({"last\n", "partial", ""}));
+    ::close(tail[0]);
+
+    // Socket::read_line只读到行尾，后面的数据留给下一次读取
+    int raw[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, raw), 0);
+    Socket raw_socket(raw[1], &loop);
+    TEST_EXPECT_EQ(::send(raw[0], "HELLO\nrest", 10, 0), 10);
+    std::string line;
+    auto peeked = socket_read_line(raw_socket, line);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return peeked.handle.done(); }));
+    TEST_EXPECT_EQ(line, std::string("HELLO\n"));
+    char rest[16] = {};
+    TEST_EXPECT_EQ(::recv(raw[1], rest, sizeof(rest), 0), 4);
+    TEST_EXPECT_EQ(std::string(rest), std::string("rest"));
+    ::close(raw[0]);
+    ::close(peer);
+
+    // TcpConnection的按行/定长读取共用同一个缓冲区
+    int conn[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, conn), 0);
+    TcpConnection connection(std::make_unique<Socket>(conn[1], &loop));
+    TEST_EXPECT_EQ(::send(conn[0], "PING\nabcQUIT\n", 13, 0), 13);
+    std::vector<std::string> reads;
+    auto connection_task = connection_reads(connection, reads);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return connection_task.handle.done(); }));
+    TEST_EXPECT_TRUE(reads == std::vector<std::string>({"PING\n", "abc", "QUIT\n"}));
+    ::close(conn[0]);
+}
+
+// 把协程交给另一个线程，由它稍后通过CoroutineManager调度恢复
+struct ResumeFromThread {
+    std::thread& thread;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        thread = std::thread([h]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            CoroutineManager::get_instance().schedule_resume(h);
+        });
+    }
+    void await_resume() const noexcept {}
+};
+
+// 依次休眠、读socket、等待其他线程调度，记录每一步所在的线程，最后停止事件循环
+Task<void> sleep_read_resume(EventLoop& loop, Socket& socket, std::thread& resumer,
+                             std::string& steps, std::set<std::thread::id>& threads, bool& nested_rejected) {
+    try {
+        co_await sleep_for(std::chrono::milliseconds(30));
+        threads.insert(std::this_thread::get_id());
+        steps += "slept;";
+
+        char buffer[16];
+        ssize_t n = co_await socket.read(buffer, sizeof(buffer));
+        threads.insert(std::this_thread::get_id());
+        steps += std::string(buffer, static_cast<size_t>(std::max<ssize_t>(n, 0))) + ";";
+
+        co_await ResumeFromThread{resumer};
+        threads.insert(std::this_thread::get_id());
+        steps += "resumed;";
+
+        // 调度器已经由loop驱动
+        EventLoop other(IoBackend::EPOLL);
+        try {
+            other.run();
+        } catch (const std::logic_error&) {
+            nested_rejected = true;
+        }
+    } catch (const std::exception&) {
+    }
+    loop.stop();
+}
+
+// 测试事件循环作为协程调度器的停放点：一个线程上推进定时器、IO和其他线程调度的协程
+void test_event_loop_drives_scheduler(IoBackend backend) {
+    std::cout << "测试事件循环驱动协程调度(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    int fds[2];
+    TEST_EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    Socket reader(fds[0], &loop);
+    Socket writer(fds[1], &loop);
+
+    std::thread resumer;
+    std::string steps;
+    std::set<std::thread::id> threads;
+    bool nested_rejected = false;
+    auto task = sleep_read_resume(loop, reader, resumer, steps, threads, nested_rejected);
+
+    // 数据在休眠结束后到达；看门狗防止调度出错时测试挂住
+    std::atomic<bool> finished{false};
+    std::thread sender([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ::send(writer.fd(), "ping", 4, 0);
+        for (int i = 0; i < 200 && !finished.load(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!finished.load()) {
+            loop.stop();
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    finished = true;
+    sender.join();
+    if (resumer.joinable()) {
+        resumer.join();
+    }
+
+    TEST_EXPECT_TRUE(task.handle.done());
+    TEST_EXPECT_EQ(steps, std::string("slept;ping;resumed;"));
+    TEST_EXPECT_TRUE(threads.size() == 1 && *threads.begin() == std::this_thread::get_id());
+    TEST_EXPECT_TRUE(nested_rejected);
+    TEST_EXPECT_TRUE(elapsed >= std::chrono::milliseconds(65));
+    TEST_EXPECT_TRUE(elapsed < std::chrono::seconds(1));
+    // 空闲时阻塞在epoll/io_uring里直到下一个截止时间或被唤醒，而不是按固定间隔轮询
+    TEST_EXPECT_TRUE(loop.get_stats().iterations < 30);
+}
+
+// 回显一次，记录处理前后所在的线程
+struct EchoRecord {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    bool migrated{false};
+};
+
+Task<void> echo_once(std::unique_ptr<Socket> socket, EchoRecord& record) {
+    auto start = std::this_thread::get_id();
+    try {
+        char buffer[64];
+        ssize_t n = co_await socket->read(buffer, sizeof(buffer));
+        if (n > 0) {
+            co_await socket->write(buffer, static_cast<size_t>(n));
+        }
+    } catch (const std::exception&) {
+    }
+    std::lock_guard<std::mutex> lock(record.mutex);
+    record.threads.insert(start);
+    record.migrated = record.migrated || start != std::this_thread::get_id();
+}
+
+// 测试单事件循环的TcpServer：服务器持有accept协程，由调用者驱动事件循环
+void test_tcp_server_single_loop() {
+    std::cout << "测试TcpServer单事件循环..." << std::endl;
+    EventLoop loop;
+    TcpServer server(&loop);
+    EchoRecord record;
+    server.set_connection_handler([&record](std::unique_ptr<Socket> socket) {
+        return echo_once(std::move(socket), record);
+    });
+    auto listen_task = server.listen("127.0.0.1", 0);
+    TEST_EXPECT_TRUE(server.is_running());
+    TEST_EXPECT_TRUE(server.port() != 0);
+
+    std::atomic<int> echoed{0};
+    std::thread client([&]() {
+        for (int i = 0; i < 4; ++i) {
+            echoed += blocking_echo(server.port(), "hello") ? 1 : 0;
+        }
+    });
+    drive_until(loop, [&]() { return echoed.load() == 4; });
+    client.join();
+    TEST_EXPECT_EQ(echoed.load(), 4);
+    server.stop();
+    TEST_EXPECT_FALSE(server.is_running());
+}
+
+// 测试Endpoint的构造、格式化与解析，不涉及网络
+void test_endpoint() {
+    std::cout << "测试Endpoint..." << std::endl;
+    Endpoint v4 = Endpoint::ipv4("10.1.2.3", 8080);
+    TEST_EXPECT_EQ(v4.family(), AF_INET);
+    TEST_EXPECT_EQ(v4.port(), uint16_t{8080});
+    TEST_EXPECT_EQ(v4.size(), static_cast<socklen_t>(sizeof(sockaddr_in)));
+    TEST_EXPECT_EQ(v4.to_string(), std::string("10.1.2.3:8080"));
+    TEST_EXPECT_EQ(Endpoint::ipv4("", 80).to_string(), std::string("0.0.0.0:80"));
+
+    Endpoint v6 = Endpoint::ip("[::1]", 443);
+    TEST_EXPECT_EQ(v6.family(), AF_INET6);
+    TEST_EXPECT_EQ(v6.to_string(), std::string("[::1]:443"));
+    TEST_EXPECT_EQ(Endpoint::ipv6("fe80::1%2", 53).to_string(), std::string("[fe80::1%2]:53"));
+    v6.set_port(8443);
+    TEST_EXPECT_EQ(v6.port(), uint16_t{8443});
+
+    Endpoint path = Endpoint::unix_path("/run/app.sock");
+    TEST_EXPECT_TRUE(path.is_unix());
+    TEST_EXPECT_FALSE(path.is_abstract());
+    TEST_EXPECT_EQ(path.path(), std::string("/run/app.sock"));
+    TEST_EXPECT_EQ(path.port(), uint16_t{0});
+    TEST_EXPECT_EQ(path.to_string(), std::string("unix:/run/app.sock"));
+
+    Endpoint abstract = Endpoint::unix_abstract("mesh.sidecar");
+    TEST_EXPECT_TRUE(abstract.is_abstract());
+    TEST_EXPECT_EQ(abstract.path(), std::string("mesh.sidecar"));
+    TEST_EXPECT_EQ(abstract.size(), static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + 12));
+    TEST_EXPECT_EQ(abstract.to_string(), std::string("unix:@mesh.sidecar"));
+
+    // to_string与parse互逆
+    for (const char* text : {"127.0.0.1:9000", "[2001:db8::7]:65535", "unix:/tmp/x.sock", "unix:@name"}) {
+        TEST_EXPECT_EQ(Endpoint::parse(text).to_string(), std::string(text));
+    }
+    TEST_EXPECT_TRUE(Endpoint::parse("unix:@mesh.sidecar") == abstract);
+    TEST_EXPECT_FALSE(Endpoint::parse("unix:@name") == Endpoint::parse("unix:/name"));
+    TEST_EXPECT_TRUE(Endpoint::parse("10.1.2.3:8080") == v4);
+
+    int rejected = 0;
+    for (const char* text : {"1.2.3.4", "1.2.3.4:70000", "1.2.3.4:", "::1:80", "[::1:80", "999.1.1.1:80",
+                             "[::1]:x", "unix:", ":80", ":"}) {
+        try {
+            Endpoint::parse(text);
+        } catch (const std::invalid_argument&) {
+            ++rejected;
+        }
+    }
+    TEST_EXPECT_EQ(rejected, 10);
+    try {
+        Endpoint::unix_path(std::string(200, 'p'));
+    } catch (const std::invalid_argument&) {
+        ++rejected;
+    }
+    TEST_EXPECT_EQ(rejected, 11);
+}
+
+Task<void> echo_client(Socket& client, Endpoint endpoint, std::string& reply, bool& failed) {
+    try {
+        co_await client.connect(endpoint);
+        co_await client.write("hello", 5);
+        char buffer[16];
+        ssize_t n = co_await client.read(buffer, sizeof(buffer));
+        reply.assign(buffer, static_cast<size_t>(std::max<ssize_t>(n, 0)));
+    } catch (const std::exception&) {
+        failed = true;
+    }
+}
+
+// 测试IPv6、Unix域（文件路径与抽象命名空间）上的TcpServer与UDP
+void test_endpoint_sockets(IoBackend backend) {
+    std::cout << "测试IPv6与Unix域socket(" << (backend == IoBackend::EPOLL ? "epoll" : "io_uring") << ")..." << std::endl;
+    EventLoop loop(backend);
+    std::string file = "/tmp/flowcoro_test_" + std::to_string(::getpid()) + ".sock";
+    std::vector<Endpoint> endpoints = {
+        Endpoint::ipv6("::1", 0),
+        Endpoint::unix_path(file),
+        Endpoint::unix_abstract("flowcoro_test_" + std::to_string(::getpid())),
+    };
+    for (const Endpoint& endpoint : endpoints) {
+        TcpServer server(&loop);
+        EchoRecord record;
+        server.set_connection_handler([&record](std::unique_ptr<Socket> socket) {
+            return echo_once(std::move(socket), record);
+        });
+        auto listen_task = server.listen(endpoint);
+        TEST_EXPECT_TRUE(server.is_running());
+        TEST_EXPECT_EQ(server.endpoint().family(), endpoint.family());
+        TEST_EXPECT_EQ(server.port() != 0, endpoint.is_ip());
+
+        Socket client(&loop, endpoint.family());
+        std::string reply;
+        bool failed = false;
+        auto task = echo_client(client, server.endpoint(), reply, failed);
+        TEST_EXPECT_TRUE(drive_until(loop, [&]() { return task.handle.done(); }));
+        TEST_EXPECT_FALSE(failed);
+        TEST_EXPECT_EQ(reply, std::string("hello"));
+        TEST_EXPECT_TRUE(client.peer_endpoint() == server.endpoint());
+        server.stop();
+    }
+    // stop()删除了socket文件
+    TEST_EXPECT_NE(::access(file.c_str(), F_OK), 0);
+
+    UdpSocket client(&loop, AF_INET6);
+    UdpSocket server(&loop, AF_INET6);
+    TEST_EXPECT_TRUE(client.bind("::1", 0));
+    TEST_EXPECT_TRUE(server.bind(Endpoint::ipv6("::1", 0)));
+    std::string reply;
+    uint16_t seen_port = 0;
+    bool failed = false;
+    auto echo = udp_echo(client, server, reply, seen_port, failed);
+    TEST_EXPECT_TRUE(drive_until(loop, [&]() { return echo.handle.done(); }));
+    TEST_EXPECT_FALSE(failed);
+    TEST_EXPECT_EQ(reply, std::string("ping"));
+    TEST_EXPECT_EQ(seen_port, client.local_port());
+}
+
+// 测试多reactor：连接分到不同线程并固定在所属事件循环上
+void test_tcp_server_reactors(TcpServerOptions::Balance balance, const char* name) {
+    std::cout << "测试TcpServer多reactor(" << name << ")..." << std::endl;
+    constexpr size_t REACTORS = 4;
+    TcpServerOptions options;
+    options.reactors = REACTORS;
+    options.balance = balance;
+    TcpServer server(nullptr, options);
+    EchoRecord record;
+    server.set_connection_handler([&record](std::unique_ptr<Socket> socket) {
+        return echo_once(std::move(socket), record);
+    });
+    auto listen_task = server.listen("127.0.0.1", 0);
+
+    if (balance == TcpServerOptions::Balance::LEAST_LOADED) {
+        // 保持连接不结束，负载应均匀分布
+        std::vector<int> held;
+        for (size_t i = 0; i < REACTORS * 2; ++i) {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(server.port());
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            held.push_back(fd);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto loads = server.reactor_loads();
+                if (std::accumulate(loads.begin(), loads.end(), size_t{0}) == i + 1) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        TEST_EXPECT_TRUE(server.reactor_loads() == std::vector<size_t>(REACTORS, 2));
+        for (int fd : held) ::close(fd);
+
+        // 同时结束的连接在reactor空闲（run_once阻塞）时也会被计入负载回落
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (std::chrono::steady_clock::now() < deadline &&
+               server.reactor_loads() != std::vector<size_t>(REACTORS, 0)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        TEST_EXPECT_TRUE(server.reactor_loads() == std::vector<size_t>(REACTORS, 0));
+    }
+
+    int echoed = 0;
+    for (size_t i = 0; i < REACTORS * 4; ++i) {
+        echoed += blocking_echo(server.port(), "hello") ? 1 : 0;
+    }
+    TEST_EXPECT_EQ(echoed, static_cast<int>(REACTORS * 4));
+    server.stop();
+
+    std::lock_guard<std::mutex> lock(record.mutex);
+    TEST_EXPECT_FALSE(record.migrated);
+    if (balance == TcpServerOptions::Balance::ROUND_ROBIN) {
+        TEST_EXPECT_EQ(record.threads.size(), REACTORS);
+    } else {
+        TEST_EXPECT_TRUE(record.threads.size() >= 1);
+    }
+}
+
 int main() {
     TEST_SUITE("FlowCoro 网络模块测试");
     
@@ -118,6 +1363,30 @@ int main() {
     test_socket_creation();
     test_network_init();
     test_http_response_parsing();
+    test_socket_persistent_registration();
+    test_event_loop_handler_table();
+    test_socket_loopback_accept_connect(IoBackend::EPOLL);
+    test_socket_loopback_accept_connect(IoBackend::IO_URING);
+    test_io_backend_common(IoBackend::EPOLL);
+    test_io_backend_common(IoBackend::IO_URING);
+    test_io_uring_batching();
+    test_socket_vectored_io(IoBackend::EPOLL);
+    test_socket_vectored_io(IoBackend::IO_URING);
+    test_socket_file_transfer(IoBackend::EPOLL);
+    test_socket_file_transfer(IoBackend::IO_URING);
+    test_udp_socket(IoBackend::EPOLL);
+    test_udp_socket(IoBackend::IO_URING);
+    test_endpoint();
+    test_endpoint_sockets(IoBackend::EPOLL);
+    test_endpoint_sockets(IoBackend::IO_URING);
+    test_buffered_reader(IoBackend::EPOLL);
+    test_buffered_reader(IoBackend::IO_URING);
+    test_event_loop_drives_scheduler(IoBackend::EPOLL);
+    test_event_loop_drives_scheduler(IoBackend::IO_URING);
+    test_tcp_server_single_loop();
+    test_tcp_server_reactors(TcpServerOptions::Balance::REUSE_PORT, "SO_REUSEPORT");
+    test_tcp_server_reactors(TcpServerOptions::Balance::ROUND_ROBIN, "round-robin");
+    test_tcp_server_reactors(TcpServerOptions::Balance::LEAST_LOADED, "least-loaded");
     
     TestRunner::print_summary();
     